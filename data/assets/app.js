@@ -132,8 +132,68 @@
             return response.json();
         }
 
-        // WebSocket (optional): server should expose /ws and send {type:'state', controller:{...}, segments:[...]}
+        // WebSocket (optional): /ws sends a full {type:'state', version, ...} on connect,
+        // then {type:'delta', version, base, ...} with only what changed (see src/network/state_socket.h)
         let ws = null;
+        let wsState = null;     // {version, controller, segments: Map id -> segment}
+
+        function applyWsState() {
+            applyControllerToUI(wsState.controller);
+            // Update the currently active segment, not always segment 0
+            const activeSeg = wsState.segments.get(activeSegmentId);
+            if (activeSeg) applySegmentToUI(activeSeg);
+        }
+
+        // Commands over /ws: one message per change instead of an HTTP request.
+        // Resolves with the state version that includes them.
+        let wsSeq = 0;
+        const wsPending = new Map();    // seq -> {resolve, reject}
+
+        function wsReady() {
+            return ws && ws.readyState === WebSocket.OPEN;
+        }
+
+        function wsCommand(cmds) {
+            return new Promise((resolve, reject) => {
+                const seq = ++wsSeq;
+                wsPending.set(seq, { resolve, reject });
+                ws.send(JSON.stringify({ type: 'cmd', seq, cmds }));
+            });
+        }
+
+        function handleWsAck(msg) {
+            const pending = wsPending.get(msg.seq);
+            if (!pending) return;
+            wsPending.delete(msg.seq);
+            if (msg.error) {
+                pending.reject(new Error(msg.error));
+            } else {
+                pending.resolve(msg.version);
+            }
+        }
+
+        function handleWsDelta(msg) {
+            if (!wsState || msg.base !== wsState.version) {
+                // Missed an update: start over from a full state
+                wsState = null;
+                ws.send(JSON.stringify({ type: 'resync' }));
+                return;
+            }
+            wsState.version = msg.version;
+            if (msg.controller) Object.assign(wsState.controller, msg.controller);
+            (msg.removed || []).forEach(id => wsState.segments.delete(id));
+            (msg.segments || []).forEach(seg => {
+                const prev = wsState.segments.get(seg.id);
+                if (prev && seg.effect === undefined) {
+                    // Params-only change
+                    Object.assign(prev.params = prev.params || {}, seg.params);
+                } else {
+                    wsState.segments.set(seg.id, seg);
+                }
+            });
+            applyWsState();
+        }
+
         function connectWebSocket() {
             try {
                 const proto = location.protocol === 'https:' ? 'wss' : 'ws';
@@ -141,18 +201,25 @@
                 ws.onopen = () => console.log('WS connected');
                 ws.onclose = () => {
                     console.log('WS disconnected, retrying...');
+                    wsState = null;
+                    wsPending.forEach(p => p.reject(new Error('disconnected')));
+                    wsPending.clear();
                     setTimeout(connectWebSocket, 2000);
                 };
                 ws.onmessage = (evt) => {
                     try {
                         const msg = JSON.parse(evt.data);
                         if (msg.type === 'state') {
-                            if (msg.controller) applyControllerToUI(msg.controller);
-                            if (msg.segments) {
-                                // Update the currently active segment, not always segment 0
-                                const activeSeg = msg.segments.find(s => s.id === activeSegmentId);
-                                if (activeSeg) applySegmentToUI(activeSeg);
-                            }
+                            wsState = {
+                                version: msg.version,
+                                controller: msg.controller || {},
+                                segments: new Map((msg.segments || []).map(s => [s.id, s]))
+                            };
+                            applyWsState();
+                        } else if (msg.type === 'delta') {
+                            handleWsDelta(msg);
+                        } else if (msg.type === 'ack') {
+                            handleWsAck(msg);
                         }
                     } catch (e) {
                         console.warn('WS message parse error', e);
@@ -163,6 +230,69 @@
             }
         }
 
+        // Live preview: binary frames from /ws/preview, XOR-delta + RLE coded
+        // against the previous frame (format documented in src/network/preview.h)
+        let previewWs = null;
+        let previewPixels = new Uint8Array(0);
+        function connectPreview() {
+            const proto = location.protocol === 'https:' ? 'wss' : 'ws';
+            const canvas = document.getElementById('previewCanvas');
+            previewWs = new WebSocket(`${proto}://${location.host}/ws/preview`);
+            previewWs.binaryType = 'arraybuffer';
+            previewWs.onopen = () => {
+                previewWs.send(JSON.stringify({ fps: 15, maxPixels: canvas.width }));
+            };
+            previewWs.onclose = () => {
+                if (document.getElementById('previewToggle').checked) {
+                    setTimeout(connectPreview, 2000);
+                }
+            };
+            previewWs.onmessage = (evt) => {
+                if (!(evt.data instanceof ArrayBuffer)) return;
+                const msg = new Uint8Array(evt.data);
+                const key = msg[0] === 0;
+                const pixels = msg[2] | (msg[3] << 8);
+                if (key || previewPixels.length !== pixels * 3) {
+                    previewPixels = new Uint8Array(pixels * 3);
+                }
+                let pos = 0;
+                for (let i = 8; i < msg.length && pos < previewPixels.length;) {
+                    const ctrl = msg[i++];
+                    const count = (ctrl & 0x7f) + 1;
+                    if (ctrl & 0x80) {
+                        pos += count;
+                    } else {
+                        for (let j = 0; j < count; j++) previewPixels[pos++] ^= msg[i++];
+                    }
+                }
+                drawPreview(canvas, pixels);
+            };
+        }
+
+        function drawPreview(canvas, pixels) {
+            if (pixels === 0) return;
+            if (canvas.width !== pixels) canvas.width = pixels;
+            const ctx = canvas.getContext('2d');
+            const image = ctx.createImageData(pixels, 1);
+            for (let i = 0; i < pixels; i++) {
+                image.data[i * 4] = previewPixels[i * 3];
+                image.data[i * 4 + 1] = previewPixels[i * 3 + 1];
+                image.data[i * 4 + 2] = previewPixels[i * 3 + 2];
+                image.data[i * 4 + 3] = 255;
+            }
+            ctx.putImageData(image, 0, 0);
+        }
+
+        document.getElementById('previewToggle').addEventListener('change', function() {
+            document.getElementById('previewCanvas').style.display = this.checked ? 'block' : 'none';
+            if (this.checked) {
+                connectPreview();
+            } else if (previewWs) {
+                previewWs.close();
+                previewWs = null;
+            }
+        });
+
         function selectActiveSegment(segments) {
             // Current UI is single-segment oriented; default to segment 0 if present, else first segment.
             if (!Array.isArray(segments) || segments.length === 0) return null;
@@ -708,12 +838,36 @@
             };
 
             try {
-                await apiV2('/controller', 'PUT', controller);
+                if (wsReady()) {
+                    await wsCommand([
+                        { op: 'power', v: controller.power },
+                        { op: 'brightness', v: controller.brightness }
+                    ]);
+                } else {
+                    await apiV2('/controller', 'PUT', controller);
+                }
             } catch (e) {
                 console.error('Failed to apply controller settings:', e);
             }
         }
         
+        // Same change as a PUT /segments/{id} body, as /ws commands
+        function segmentCommands(seg, segment) {
+            const cmds = [];
+            // Setting the effect resets its params: only when it changes
+            const known = wsState && wsState.segments.get(seg);
+            if (!known || known.effect !== segment.effect) {
+                cmds.push({ op: 'effect', seg, id: segment.effect });
+            }
+            if (segment.palette !== undefined) {
+                cmds.push({ op: 'palette', seg, v: segment.palette });
+            }
+            Object.entries(segment.params || {}).forEach(([id, v]) => {
+                cmds.push({ op: 'param', seg, id, v });
+            });
+            return cmds;
+        }
+
         // v2: Apply only segment state (effect + params)
         async function applySegmentState() {
             const effectId = document.getElementById('effect').value;
@@ -768,7 +922,10 @@
             }
 
             try {
-                if (activeSegmentId >= 0) {
+                if (activeSegmentId >= 0 && wsReady()) {
+                    await wsCommand(segmentCommands(activeSegmentId, segment));
+                    showToast('Settings applied!', 'success');
+                } else if (activeSegmentId >= 0) {
                     await apiV2(`/segments/${activeSegmentId}`, 'PUT', segment);
                     showToast('Settings applied!', 'success');
                 } else {
@@ -1049,6 +1206,8 @@
                 document.getElementById('mqttUsername').value = config.mqttUsername && config.mqttUsername !== '****' ? config.mqttUsername : '';
                 document.getElementById('mqttPassword').value = config.mqttPassword && config.mqttPassword !== '****' ? '' : '';
                 document.getElementById('mqttTopicPrefix').value = config.mqttTopicPrefix || 'lume';
+                document.getElementById('mqttGroups').value = config.mqttGroups || '';
+                document.getElementById('mqttGroupPrefix').value = config.mqttGroupPrefix || 'lume';
                 toggleSettings('mqttSettings', mqttEnabled);
             } catch (e) {
                 console.error('Failed to load config:', e);
@@ -1194,7 +1353,9 @@
                 mqttPort: parseInt(document.getElementById('mqttPort').value),
                 mqttUsername: document.getElementById('mqttUsername').value,
                 mqttPassword: document.getElementById('mqttPassword').value,
-                mqttTopicPrefix: document.getElementById('mqttTopicPrefix').value
+                mqttTopicPrefix: document.getElementById('mqttTopicPrefix').value,
+                mqttGroups: document.getElementById('mqttGroups').value,
+                mqttGroupPrefix: document.getElementById('mqttGroupPrefix').value
             };
             
             // Don't send masked password/key
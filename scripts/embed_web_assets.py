@@ -0,0 +1,121 @@
+#!/usr/bin/env python3
+"""
+Embed the web UI into the firmware image.
+
+Gzips every UI file under data/ and writes them, with a content hash per
+file, to src/network/web_assets_data.h, which web_assets.cpp compiles into
+flash. HTML files get their /assets/ references rewritten to
+/assets/<file>?v=<hash>, so the assets can be cached as immutable and a
+new build still loads fresh ones.
+
+Runs before every build (extra_scripts = pre:...). Can also be run by
+hand: python3 scripts/embed_web_assets.py
+"""
+import gzip
+import hashlib
+import re
+import zlib
+from pathlib import Path
+
+try:
+    Import("env")
+    PROJECT_DIR = Path(env.subst("$PROJECT_DIR"))
+except NameError:
+    PROJECT_DIR = Path(__file__).resolve().parent.parent
+
+DATA_DIR = PROJECT_DIR / "data"
+OUTPUT = PROJECT_DIR / "src" / "network" / "web_assets_data.h"
+
+# Served types; anything else stays LittleFS-only
+CONTENT_TYPES = {
+    ".html": "text/html; charset=utf-8",
+    ".css": "text/css; charset=utf-8",
+    ".js": "application/javascript; charset=utf-8",
+    ".svg": "image/svg+xml",
+    ".json": "application/json; charset=utf-8",
+    ".ico": "image/x-icon",
+    ".png": "image/png",
+}
+
+MAX_ASSETS = 32     # web_assets.cpp keeps override flags in a uint32_t
+
+
+def content_hash(data):
+    return hashlib.sha256(data).hexdigest()[:16]
+
+
+def collect():
+    files = []
+    for path in sorted(DATA_DIR.rglob("*")):
+        if path.is_file() and path.suffix in CONTENT_TYPES:
+            url = "/" + path.relative_to(DATA_DIR).as_posix()
+            files.append((url, path.read_bytes()))
+    return files
+
+
+def rewrite_html(html, hashes):
+    # href="/assets/app.css" -> href="/assets/app.css?v=<hash>"
+    def versioned(match):
+        url = match.group(2).decode()
+        if url not in hashes:
+            return match.group(0)
+        return match.group(1) + f'="{url}?v={hashes[url]}"'.encode()
+    return re.sub(rb'(href|src)="(/assets/[^"?#]+)"', versioned, html)
+
+
+def c_bytes(data):
+    lines = []
+    for i in range(0, len(data), 16):
+        lines.append("    " + ", ".join(f"0x{b:02x}" for b in data[i:i + 16]) + ",")
+    return "\n".join(lines)
+
+
+def generate():
+    files = collect() if DATA_DIR.exists() else []
+    if len(files) > MAX_ASSETS:
+        raise SystemExit(f"embed_web_assets: {len(files)} files, at most {MAX_ASSETS} supported")
+
+    # Hash assets first, so HTML can reference them by hash
+    hashes = {url: content_hash(data) for url, data in files if not url.endswith(".html")}
+
+    assets = []
+    for url, source in files:
+        data = rewrite_html(source, hashes) if url.endswith(".html") else source
+        packed = gzip.compress(data, compresslevel=9, mtime=0)
+        # CRC of the source as uploadfs would store it, to spot LittleFS overrides
+        assets.append((url, CONTENT_TYPES[Path(url).suffix], packed,
+                       zlib.crc32(source), content_hash(data), len(data)))
+
+    out = [
+        "// Generated by scripts/embed_web_assets.py from data/ - do not edit",
+        "#pragma once",
+        "",
+        "#include <Arduino.h>",
+        "",
+    ]
+    for i, (url, _, packed, _, _, _) in enumerate(assets):
+        out.append(f"// {url}")
+        out.append(f"static const uint8_t WEB_ASSET_{i}[] PROGMEM = {{")
+        out.append(c_bytes(packed))
+        out.append("};")
+        out.append("")
+
+    out.append("static const WebAsset WEB_ASSETS[] = {")
+    for i, (url, ctype, packed, crc, digest, _) in enumerate(assets):
+        out.append(f'    {{"{url}", "{ctype}", WEB_ASSET_{i}, {len(packed)}, 0x{crc:08x}, "{digest}"}},')
+    if not assets:
+        out.append('    {nullptr, nullptr, nullptr, 0, 0, ""},')
+    out.append("};")
+    out.append(f"static constexpr uint8_t WEB_ASSET_COUNT = {len(assets)};")
+    out.append("")
+    text = "\n".join(out)
+
+    # Leave the file alone when nothing changed, so it doesn't force a rebuild
+    if OUTPUT.exists() and OUTPUT.read_text() == text:
+        return
+    OUTPUT.write_text(text)
+    for url, _, packed, _, _, size in assets:
+        print(f"Embedded {url}: {size:,} -> {len(packed):,} bytes")
+
+
+generate()
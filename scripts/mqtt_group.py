@@ -0,0 +1,118 @@
+#!/usr/bin/env python3
+"""
+Send a command to an MQTT group of LUME controllers and collect the acks.
+
+Publishes to {prefix}/group/{name}/set with "at" = now + lead, so every
+member applies it at the same moment, then prints each member's ack and
+the aggregated {prefix}/group/{name}/status once a member publishes it.
+
+    pip install paho-mqtt
+    python3 scripts/mqtt_group.py --broker localhost --group kitchen \\
+        --state ON --brightness 200 --effect fire --lead 1.5
+
+Exits with 1 if no status arrived, or if any member was late or failed.
+The "at" time comes from this machine's clock: keep it NTP-synced.
+"""
+import argparse
+import json
+import sys
+import threading
+import time
+
+try:
+    import paho.mqtt.client as mqtt
+except ImportError:
+    raise SystemExit("mqtt_group: needs paho-mqtt (pip install paho-mqtt)")
+
+ACK_WINDOW_S = 2.0      # Members publish the status this long after "at"
+
+
+def build_command(args):
+    command = json.loads(args.json) if args.json else {}
+    for key in ("state", "brightness", "effect", "transition", "speed", "intensity"):
+        value = getattr(args, key)
+        if value is not None:
+            command[key] = value
+    command["id"] = args.id if args.id is not None else int(time.time()) & 0x7FFFFFFF
+    if args.lead > 0:
+        command["at"] = int((time.time() + args.lead) * 1000)
+    return command
+
+
+def make_client():
+    # paho-mqtt 2.x wants the callback API version; 1.x has no such argument
+    if hasattr(mqtt, "CallbackAPIVersion"):
+        return mqtt.Client(mqtt.CallbackAPIVersion.VERSION2)
+    return mqtt.Client()
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n\n")[0])
+    parser.add_argument("--broker", default="localhost")
+    parser.add_argument("--port", type=int, default=1883)
+    parser.add_argument("--username")
+    parser.add_argument("--password")
+    parser.add_argument("--prefix", default="lume", help="group prefix (default: lume)")
+    parser.add_argument("--group", required=True)
+    parser.add_argument("--lead", type=float, default=1.0,
+                        help="seconds from now to apply at; 0 = on arrival (default: 1.0)")
+    parser.add_argument("--id", type=int, help="command id (default: current time)")
+    parser.add_argument("--state", choices=["ON", "OFF"])
+    parser.add_argument("--brightness", type=int)
+    parser.add_argument("--effect")
+    parser.add_argument("--transition", type=float, help="fade time in seconds")
+    parser.add_argument("--speed", type=int)
+    parser.add_argument("--intensity", type=int)
+    parser.add_argument("--json", help="raw command fields, merged with the options above")
+    args = parser.parse_args()
+
+    base = f"{args.prefix}/group/{args.group}"
+    command = build_command(args)
+    status = {}
+    subscribed = threading.Event()
+    done = threading.Event()
+
+    def on_subscribe(client, userdata, mid, *rest):
+        subscribed.set()
+
+    def on_message(client, userdata, msg):
+        try:
+            payload = json.loads(msg.payload)
+        except ValueError:
+            return
+        if payload.get("id") != command["id"]:
+            return
+        if msg.topic.endswith("/ack"):
+            print(f"ack    {payload.get('client', '?'):<24} {payload.get('result', '?'):<9} "
+                  f"{payload.get('lateMs', 0):>6} ms")
+        elif msg.topic.endswith("/status"):
+            status.update(payload)
+            done.set()
+
+    client = make_client()
+    if args.username:
+        client.username_pw_set(args.username, args.password)
+    client.on_subscribe = on_subscribe
+    client.on_message = on_message
+    client.connect(args.broker, args.port)
+    client.loop_start()
+    client.subscribe([(f"{base}/ack", 0), (f"{base}/status", 0)])
+    if not subscribed.wait(5):
+        raise SystemExit(f"mqtt_group: no answer from {args.broker}:{args.port}")
+
+    print(f"send   {base}/set {json.dumps(command)}")
+    client.publish(f"{base}/set", json.dumps(command))
+
+    done.wait(max(args.lead, 0) + ACK_WINDOW_S + 3)
+    client.loop_stop()
+    client.disconnect()
+
+    if not status:
+        print("status none (no members, or none configured for this group)")
+        return 1
+    print(f"status {json.dumps(status)}")
+    return 0 if status.get("acks", 0) == status.get("ok", -1) else 1
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,51 @@
+/**
+ * body.cpp - Request body accumulation implementation
+ */
+
+#include "body.h"
+#include <ESPAsyncWebServer.h>
+
+BodyStatus accumulateBody(AsyncWebServerRequest* request, const uint8_t* data, size_t len,
+                          size_t index, size_t total, size_t maxSize) {
+    if (index == 0) {
+        if (total > maxSize) {
+            return BodyStatus::TooLarge;
+        }
+        // Freed by the server with the request (free(), so malloc it)
+        free(request->_tempObject);
+        request->_tempObject = malloc(total + 1);
+        if (!request->_tempObject) {
+            return BodyStatus::NoMemory;
+        }
+    } else if (!request->_tempObject) {
+        return BodyStatus::Rejected;
+    }
+
+    // Content-Length bounds everything written
+    if (index >= total) {
+        return BodyStatus::Rejected;
+    }
+    len = min(len, total - index);
+
+    char* body = static_cast<char*>(request->_tempObject);
+    memcpy(body + index, data, len);
+
+    if (index + len < total) {
+        return BodyStatus::Partial;
+    }
+    body[total] = '\0';
+    return BodyStatus::Complete;
+}
+
+const char* requestBody(AsyncWebServerRequest* request) {
+    return static_cast<const char*>(request->_tempObject);
+}
+
+DeserializationError parseBody(AsyncWebServerRequest* request, JsonDocument& doc) {
+    const char* body = requestBody(request);
+    size_t size = request->contentLength();
+    if (request->contentType().indexOf("msgpack") >= 0) {
+        return deserializeMsgPack(doc, body, size);
+    }
+    return deserializeJson(doc, body, size);
+}
@@ -0,0 +1,42 @@
+/**
+ * body.h - Request body accumulation for POST/PUT handlers
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <ArduinoJson.h>
+#include "../constants.h"
+
+// Forward declaration
+class AsyncWebServerRequest;
+
+// Result of feeding one body chunk to accumulateBody()
+enum class BodyStatus : uint8_t {
+    Partial,    // More chunks to come
+    Complete,   // Whole body received, requestBody() is valid
+    TooLarge,   // First chunk: total exceeds the limit (answer 413)
+    NoMemory,   // First chunk: no heap for the buffer (answer 503)
+    Rejected    // The first chunk was refused or already answered: ignore
+};
+
+/**
+ * Collect a chunked request body into a buffer owned by the request
+ *
+ * The buffer is allocated once at the first chunk, sized from the
+ * Content-Length, and hung off the request's _tempObject, which the web
+ * server frees together with the request. Each chunk is a single memcpy,
+ * and concurrent requests to the same endpoint never share state.
+ *
+ * Handlers that answer the first chunk themselves (e.g. 401) simply return
+ * without calling this; the later chunks then come back Rejected.
+ */
+BodyStatus accumulateBody(AsyncWebServerRequest* request, const uint8_t* data, size_t len,
+                          size_t index, size_t total, size_t maxSize = MAX_REQUEST_BODY_SIZE);
+
+// The collected body, NUL-terminated; nullptr before the first chunk
+const char* requestBody(AsyncWebServerRequest* request);
+
+// Parse the collected body: MessagePack if the Content-Type says so, else JSON
+DeserializationError parseBody(AsyncWebServerRequest* request, JsonDocument& doc);
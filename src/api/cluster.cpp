@@ -0,0 +1,202 @@
+/**
+ * cluster.cpp - Leader/follower cluster API implementation
+ */
+
+#include "cluster.h"
+#include "../main.h"
+#include "../constants.h"
+#include "../logging.h"
+#include "../core/json_pool.h"
+#include "json_response.h"
+#include "../storage.h"
+#include "../protocols/cluster.h"
+#include "body.h"
+#include "write_limit.h"
+#include <ArduinoJson.h>
+
+namespace {
+
+void configToJson(const lume::ClusterConfig& cfg, JsonDocument& doc) {
+    doc["role"] = lume::clusterRoleToString(cfg.role);
+    doc["nodeId"] = cfg.nodeId;
+    doc["port"] = cfg.port;
+    doc["delayMs"] = cfg.delayMs;
+    doc["conceal"] = lume::clusterConcealToString(cfg.conceal);
+
+    JsonArray followers = doc["followers"].to<JsonArray>();
+    for (uint8_t i = 0; i < cfg.followerCount; i++) {
+        const lume::ClusterFollowerSlice& slice = cfg.followers[i];
+        JsonObject f = followers.add<JsonObject>();
+        f["ip"] = slice.ip.toString();
+        f["port"] = slice.port;
+        f["node"] = slice.node;
+        f["start"] = slice.start;
+        f["count"] = slice.count;
+    }
+}
+
+// Parse a full settings object; returns the offending field, or nullptr
+const char* configFromJson(JsonObjectConst obj, lume::ClusterConfig& cfg) {
+    if (!obj["role"].isNull() && !lume::clusterRoleFromString(obj["role"].as<const char*>(), cfg.role)) {
+        return "role";
+    }
+    if (!obj["nodeId"].isNull()) {
+        if (!obj["nodeId"].is<int>()) return "nodeId";
+        int v = obj["nodeId"].as<int>();
+        if (v < 1 || v > 254) return "nodeId";
+        cfg.nodeId = v;
+    }
+    if (!obj["port"].isNull()) {
+        if (!obj["port"].is<int>()) return "port";
+        int v = obj["port"].as<int>();
+        if (v < 1024 || v > 65535) return "port";
+        cfg.port = v;
+    }
+    if (!obj["delayMs"].isNull()) {
+        if (!obj["delayMs"].is<int>()) return "delayMs";
+        int v = obj["delayMs"].as<int>();
+        if (v < 0 || v > lume::CLUSTER_MAX_DELAY_MS) return "delayMs";
+        cfg.delayMs = v;
+    }
+    if (!obj["conceal"].isNull() && !lume::clusterConcealFromString(obj["conceal"].as<const char*>(), cfg.conceal)) {
+        return "conceal";
+    }
+
+    if (!obj["followers"].isNull()) {
+        JsonArrayConst followers = obj["followers"].as<JsonArrayConst>();
+        if (followers.isNull() || followers.size() > lume::CLUSTER_MAX_FOLLOWERS) return "followers";
+
+        cfg.followerCount = 0;
+        for (JsonObjectConst f : followers) {
+            lume::ClusterFollowerSlice& slice = cfg.followers[cfg.followerCount];
+            if (!slice.ip.fromString(f["ip"].as<const char*>() ? f["ip"].as<const char*>() : "")) return "followers.ip";
+            slice.port = f["port"] | lume::CLUSTER_PORT;
+            int node = f["node"] | 0;
+            int start = f["start"] | -1;
+            int count = f["count"] | 0;
+            if (node < 1 || node > 254) return "followers.node";
+            if (start < 0 || start >= MAX_LED_COUNT) return "followers.start";
+            if (count < 1 || start + count > MAX_LED_COUNT) return "followers.count";
+            slice.node = node;
+            slice.start = start;
+            slice.count = count;
+            cfg.followerCount++;
+        }
+    }
+    return nullptr;
+}
+
+void buildClusterJson(JsonDocument& doc) {
+    configToJson(lume::cluster.getConfig(), doc);
+
+    JsonObject status = doc["status"].to<JsonObject>();
+    if (lume::cluster.getRole() == lume::ClusterRole::Leader) {
+        status["framesSent"] = lume::cluster.getFramesSent();
+        status["packetsSent"] = lume::cluster.getPacketsSent();
+        status["sendErrors"] = lume::cluster.getSendErrors();
+    } else if (lume::cluster.getRole() == lume::ClusterRole::Follower) {
+        const lume::ClusterFollowerStats& stats = lume::clusterProtocol.getStats();
+        status["receiving"] = lume::clusterProtocol.isActive();
+        status["lastFrame"] = lume::clusterProtocol.getLastFrame();
+        status["cadenceUs"] = lume::clusterProtocol.getCadenceUs();
+        status["packets"] = stats.packets;
+        status["frames"] = stats.frames;
+        status["late"] = stats.late;
+        status["lost"] = stats.lost;
+        status["repaired"] = stats.repaired;
+        status["interpolated"] = stats.interpolated;
+        status["overruns"] = stats.overruns;
+        status["resets"] = stats.resets;
+
+        const lume::Histogram& err = lume::clusterProtocol.getPlayoutError();
+        JsonObject playout = status["playoutErrorUs"].to<JsonObject>();
+        playout["count"] = err.count;
+        playout["p50"] = err.percentile(50);
+        playout["p95"] = err.percentile(95);
+        playout["max"] = err.maxValue;
+    }
+}
+
+} // anonymous namespace
+
+void handleApiV2ClusterGet(AsyncWebServerRequest* request) {
+    if (!checkAuth(request)) {
+        sendUnauthorized(request);
+        return;
+    }
+
+    JsonDocument doc(JSON_SITE("v2.cluster.get"));
+    buildClusterJson(doc);
+
+    sendJsonResponse(request, 200, std::move(doc));
+}
+
+void handleApiV2ClusterUpdate(AsyncWebServerRequest* request, uint8_t* data, size_t len, size_t index, size_t total) {
+    // Auth check at start of request
+    if (index == 0 && !checkAuth(request)) {
+        sendUnauthorized(request);
+        return;
+    }
+
+    if (index == 0 && !admitWrite(request, WriteEndpoint::Other, total)) {
+        return;
+    }
+
+    // Accumulate chunks
+    BodyStatus body = accumulateBody(request, data, len, index, total);
+    if (body == BodyStatus::TooLarge) {
+        sendJsonError(request, 413, "payload_too_large", "Request body exceeds MAX_REQUEST_BODY_SIZE");
+        return;
+    }
+    if (body == BodyStatus::NoMemory) {
+        sendJsonError(request, 503, "out_of_memory", "Not enough free heap for the request body");
+        return;
+    }
+
+    if (body != BodyStatus::Complete) {
+        return;
+    }
+
+    JsonDocument doc(JSON_SITE("v2.cluster.update"));
+    DeserializationError error = parseBody(request, doc);
+
+    if (error || !doc.is<JsonObject>()) {
+        sendJsonError(request, 400, "invalid_json", "Unable to parse JSON payload");
+        return;
+    }
+
+    // Omitted fields keep their current value
+    lume::ClusterConfig cfg = lume::cluster.getConfig();
+    const char* badField = configFromJson(doc.as<JsonObjectConst>(), cfg);
+    if (badField) {
+        sendJsonError(request, 400, "invalid_value", "Cluster setting missing or out of range", badField);
+        return;
+    }
+
+    lume::cluster.configure(cfg);
+
+    JsonDocument saved(JSON_SITE("v2.cluster.save"));
+    configToJson(cfg, saved);
+    if (!storage.saveClusterConfig(saved)) {
+        LOG_WARN(LogTag::STORAGE, "Failed to save cluster config");
+    }
+
+    // Report the settings as they will be applied on the next loop
+    JsonDocument response(JSON_SITE("v2.cluster.update.reply"));
+    configToJson(cfg, response);
+    sendJsonResponse(request, 200, std::move(response));
+}
+
+void restoreClusterConfig() {
+    JsonDocument doc(JSON_SITE("v2.cluster.restore"));
+    if (!storage.loadClusterConfig(doc) || !doc.is<JsonObject>()) {
+        return;
+    }
+
+    lume::ClusterConfig cfg;
+    if (configFromJson(doc.as<JsonObjectConst>(), cfg) == nullptr) {
+        lume::cluster.configure(cfg);
+    } else {
+        LOG_WARN(LogTag::CLUSTER, "Stored cluster config is invalid - cluster off");
+    }
+}
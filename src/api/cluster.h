@@ -0,0 +1,20 @@
+/**
+ * cluster.h - Leader/follower cluster API handlers
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Forward declaration
+class AsyncWebServerRequest;
+
+// GET /api/v2/cluster - role, slices and play-out statistics
+void handleApiV2ClusterGet(AsyncWebServerRequest* request);
+
+// PUT /api/v2/cluster - replace (and persist) the cluster settings
+void handleApiV2ClusterUpdate(AsyncWebServerRequest* request, uint8_t* data, size_t len, size_t index, size_t total);
+
+// Apply persisted cluster settings (call after protocols are registered)
+void restoreClusterConfig();
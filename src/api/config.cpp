@@ -2,26 +2,25 @@
 #include "../main.h"
 #include "../constants.h"
 #include "../logging.h"
+#include "../core/json_pool.h"
+#include "json_response.h"
 #include "../storage.h"
 #include "../lume.h"
 #include "../protocols/sacn.h"
 #include "../protocols/mqtt.h"
+#include "body.h"
+#include "write_limit.h"
 
 // External globals
 extern Config config;
 extern Storage storage;
 extern bool wifiConnected;
 
-// Static body buffer for async request handling
-static String configBodyBuffer;
-
 void handleApiConfig(AsyncWebServerRequest* request) {
-    JsonDocument doc;
+    JsonDocument doc(JSON_SITE("api.config.get"));
     storage.configToJson(config, doc, true);
     
-    String response;
-    serializeJson(doc, response);
-    request->send(200, "application/json", response);
+    sendJsonResponse(request, 200, std::move(doc));
 }
 
 void handleApiConfigPost(AsyncWebServerRequest* request, uint8_t* data, size_t len, size_t index, size_t total) {
@@ -30,22 +29,25 @@ void handleApiConfigPost(AsyncWebServerRequest* request, uint8_t* data, size_t l
         sendUnauthorized(request);
         return;
     }
-    
-    if (index == 0) {
-        configBodyBuffer = "";
-        // Validate total size
-        if (total > MAX_REQUEST_BODY_SIZE) {
-            request->send(413, "application/json", "{\"error\":\"Request body too large\"}");
-            return;
-        }
+
+    if (index == 0 && !admitWrite(request, WriteEndpoint::Config, total)) {
+        return;
     }
     
-    configBodyBuffer += String((char*)data).substring(0, len);
+    BodyStatus body = accumulateBody(request, data, len, index, total);
+    if (body == BodyStatus::TooLarge) {
+        request->send(413, "application/json", "{\"error\":\"Request body too large\"}");
+        return;
+    }
+    if (body == BodyStatus::NoMemory) {
+        request->send(503, "application/json", "{\"error\":\"Out of memory\"}");
+        return;
+    }
     
-    if (index + len >= total) {
+    if (body == BodyStatus::Complete) {
         // Body complete, process
-        JsonDocument doc;
-        DeserializationError err = deserializeJson(doc, configBodyBuffer);
+        JsonDocument doc(JSON_SITE("api.config.post"));
+        DeserializationError err = deserializeJson(doc, requestBody(request), total);
         
         if (err) {
             request->send(400, "application/json", "{\"error\":\"Invalid JSON\"}");
@@ -59,16 +61,21 @@ void handleApiConfigPost(AsyncWebServerRequest* request, uint8_t* data, size_t l
         if (storage.saveConfig(config)) {
             // Apply changes that can be applied without restart
             lume::controller.setLedCount(config.ledCount);
+            lume::controller.configureProtocolOutput(config.protocolShowOnArrival,
+                                                     config.protocolJitterMs, config.protocolInterpolate);
             
             // Handle sACN enable/disable (using new protocol system)
             if (config.sacnEnabled && wifiConnected) {
                 lume::sacnProtocol.stop();
                 lume::sacnProtocol.configure(config.sacnUniverse, config.sacnUniverseCount,
                                               config.sacnUnicast, config.sacnStartChannel);
+                lume::sacnProtocol.setMergeMode(static_cast<lume::SacnMergeMode>(config.sacnMergeMode));
                 lume::sacnProtocol.begin();
             } else {
                 lume::sacnProtocol.stop();
             }
+            applySacnOutputConfig();
+            applyClockSyncConfig();
             
             // Handle MQTT enable/disable
             if (config.mqttEnabled && config.mqttBroker.length() > 0 && wifiConnected) {
@@ -79,6 +86,8 @@ void handleApiConfigPost(AsyncWebServerRequest* request, uint8_t* data, size_t l
                 mqttConfig.username = config.mqttUsername;
                 mqttConfig.password = config.mqttPassword;
                 mqttConfig.topicPrefix = config.mqttTopicPrefix;
+                mqttConfig.groups = config.mqttGroups;
+                mqttConfig.groupPrefix = config.mqttGroupPrefix;
                 lume::mqtt.setConfig(mqttConfig);
             } else {
                 lume::MqttConfig disabledConfig;
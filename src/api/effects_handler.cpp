@@ -1,92 +1,203 @@
 #include <ArduinoJson.h>
 #include <ESPAsyncWebServer.h>
+#include "segments.h"
+#include "../constants.h"
 #include "../core/effect_registry.h"
 #include "../core/param_schema.h"
 #include "../logging.h"
+#include "../core/json_pool.h"
+#include "json_response.h"
 
-namespace lume {
+// Effect and palette catalogs (GET /api/v2/effects, /api/v2/palettes).
+//
+// Both only change with the firmware, so each is serialized and gzipped
+// once, on first request, and served from that blob afterwards with an
+// ETag. Clients revalidate every time (no-cache: the URLs don't change
+// across OTA updates) and normally get a bodyless 304.
+
+namespace {
 
 // Serialize ParamType to string
 const char* paramTypeToString(lume::ParamType type) {
     switch (type) {
-        case lume::ParamType:: Int:      return "int";
-        case lume::ParamType::Float:   return "float";
+        case lume::ParamType::Int:      return "int";
+        case lume::ParamType::Float:    return "float";
         case lume::ParamType::Color:    return "color";
-        case lume::ParamType:: Palette: return "palette";
-        case lume::ParamType::Bool:    return "bool";
-        case lume:: ParamType:: Enum:    return "enum";
-        default:                       return "unknown";
+        case lume::ParamType::Palette:  return "palette";
+        case lume::ParamType::Bool:     return "bool";
+        case lume::ParamType::Enum:     return "enum";
+        default:                        return "unknown";
     }
 }
 
 // Serialize schema to JSON
 void schemaToJson(JsonArray& paramsArray, const lume::ParamSchema* schema) {
     if (!schema || schema->count == 0) return;
-    
+
     for (uint8_t i = 0; i < schema->count; i++) {
         const lume::ParamDesc& p = schema->params[i];
         JsonObject param = paramsArray.add<JsonObject>();
-        
-        param["id"] = p. id;
+
+        param["id"] = p.id;
         param["name"] = p.name;
         param["type"] = paramTypeToString(p.type);
-        
+
         switch (p.type) {
             case lume::ParamType::Int:
                 param["default"] = p.defaultInt;
                 param["min"] = p.minInt;
                 param["max"] = p.maxInt;
                 break;
-            case lume::ParamType::Float: 
+            case lume::ParamType::Float:
                 param["default"] = p.defaultFloat;
                 param["min"] = p.minFloat;
                 param["max"] = p.maxFloat;
                 break;
-            case lume::ParamType:: Color:
-                param["default"] = String("#") + 
-                    String(p.defaultColor.r, HEX) + 
-                    String(p.defaultColor.g, HEX) + 
-                    String(p.defaultColor. b, HEX);
+            case lume::ParamType::Color: {
+                char colorHex[8];
+                snprintf(colorHex, sizeof(colorHex), "#%02x%02x%02x",
+                    p.defaultColor.r, p.defaultColor.g, p.defaultColor.b);
+                param["default"] = colorHex;
                 break;
+            }
             case lume::ParamType::Bool:
                 param["default"] = (bool)(p.defaultInt != 0);
                 break;
-            case lume::ParamType::Enum: 
+            case lume::ParamType::Enum:
                 param["default"] = p.defaultInt;
                 param["options"] = p.enumOptions;  // "opt1|opt2|opt3"
                 break;
-            case lume::ParamType::Palette: 
+            case lume::ParamType::Palette:
                 // Palette list could be included or fetched separately
                 break;
         }
     }
 }
 
-// GET /api/effects - Updated to include schema
-void handleGetEffects(AsyncWebServerRequest* request) {
-    JsonDocument doc;
-    JsonArray effects = doc["effects"]. to<JsonArray>();
-    
-    auto& registry = lume::effects();
+void buildEffectsCatalog(JsonDocument& doc) {
+    JsonArray effects = doc["effects"].to<JsonArray>();
+
+    // Iterate through effect registry
+    lume::EffectRegistry& registry = lume::effects();
     for (uint8_t i = 0; i < registry.getCount(); i++) {
-        const lume:: EffectInfo* info = registry.getByIndex(i);
-        if (! info) continue;
-        
+        const lume::EffectInfo* info = registry.getByIndex(i);
+        if (!info) continue;
+
         JsonObject effect = effects.add<JsonObject>();
         effect["id"] = info->id;
         effect["name"] = info->displayName;
         effect["category"] = info->categoryName();
-        
+
         // All effects now have schemas - serialize params from schema
-        JsonArray params = effect["params"]. to<JsonArray>();
+        JsonArray params = effect["params"].to<JsonArray>();
         if (info->hasSchema()) {
             schemaToJson(params, info->schema);
         }
+
+        // Effect metadata (derived from schema)
+        effect["usesPalette"] = info->usesPalette();
+        effect["colorCount"] = info->colorCount();
+        effect["usesSpeed"] = info->hasParam("speed");
+        effect["usesIntensity"] = info->hasParam("intensity");
+    }
+}
+
+void buildPalettesCatalog(JsonDocument& doc) {
+    JsonArray palettes = doc["palettes"].to<JsonArray>();
+
+    // Map palette enum to names
+    const char* paletteNames[] = {
+        "Rainbow", "Lava", "Ocean", "Party", "Forest", "Cloud", "Heat"
+    };
+
+    for (int i = 0; i < 7; i++) {
+        JsonObject pal = palettes.add<JsonObject>();
+        pal["id"] = i;
+        pal["name"] = paletteNames[i];
+    }
+}
+
+struct Catalog {
+    const char* name;
+    void (*build)(JsonDocument&);
+    uint8_t* gzip;          // Kept for the life of the firmware
+    size_t gzipSize;
+    char etag[40];
+};
+
+Catalog effectsCatalog = {"effects", buildEffectsCatalog, nullptr, 0, ""};
+Catalog palettesCatalog = {"palettes", buildPalettesCatalog, nullptr, 0, ""};
+
+// Serialize and compress once; false if the heap couldn't take it (retried next time)
+bool cacheCatalog(Catalog& catalog) {
+    if (catalog.gzip) {
+        return true;
     }
-    
-    String response;
-    serializeJson(doc, response);
-    request->send(200, "application/json", response);
+
+    JsonDocument doc(JSON_SITE("v2.catalog.cache"));
+    catalog.build(doc);
+    size_t jsonSize = measureJson(doc);
+
+    size_t gzipSize = 0;
+    uint32_t crc = 0;
+    uint8_t* blob = gzipJson(doc, jsonSize, gzipSize, &crc);
+    if (!blob) {
+        return false;
+    }
+
+    // Build hash for the firmware, content CRC for dev builds that share "dev"
+    snprintf(catalog.etag, sizeof(catalog.etag), "\"%.20s-%08lx\"", FIRMWARE_BUILD_HASH, (unsigned long)crc);
+    catalog.gzipSize = gzipSize;
+    catalog.gzip = blob;
+    LOG_INFO(LogTag::WEB, "Cached %s catalog: %u bytes JSON, %u gzipped",
+             catalog.name, (unsigned)jsonSize, (unsigned)catalog.gzipSize);
+    return true;
 }
 
-} // namespace lume
\ No newline at end of file
+void sendCatalog(AsyncWebServerRequest* request, Catalog& catalog) {
+    // The cached blob is JSON only; MessagePack is encoded per request
+    if (responseFormat(request) == BodyFormat::MsgPack) {
+        JsonDocument doc(JSON_SITE("v2.catalog"));
+        catalog.build(doc);
+        request->send(beginJsonResponse(200, std::move(doc), BodyFormat::MsgPack, "Accept, Accept-Encoding"));
+        return;
+    }
+
+    bool cached = cacheCatalog(catalog);
+
+    AsyncWebServerResponse* response;
+    if (cached && request->hasHeader("If-None-Match") &&
+        request->header("If-None-Match") == catalog.etag) {
+        response = request->beginResponse(304);
+    } else if (cached && acceptsGzip(request)) {
+        response = request->beginResponse_P(200, "application/json", catalog.gzip, catalog.gzipSize);
+        response->addHeader("Content-Encoding", "gzip");
+    } else {
+        JsonDocument doc(JSON_SITE("v2.catalog"));
+        catalog.build(doc);
+        response = beginJsonResponse(200, std::move(doc), BodyFormat::Json, nullptr);
+    }
+
+    if (cached) {
+        response->addHeader("ETag", catalog.etag);
+        response->addHeader("Cache-Control", "public, no-cache");
+    }
+    response->addHeader("Vary", "Accept, Accept-Encoding");
+    request->send(response);
+}
+
+} // anonymous namespace
+
+// ===========================================================================
+// GET /api/v2/effects - List available effects
+// ===========================================================================
+void handleApiV2EffectsList(AsyncWebServerRequest* request) {
+    sendCatalog(request, effectsCatalog);
+}
+
+// ===========================================================================
+// GET /api/v2/palettes - List available palettes
+// ===========================================================================
+void handleApiV2PalettesList(AsyncWebServerRequest* request) {
+    sendCatalog(request, palettesCatalog);
+}
@@ -0,0 +1,253 @@
+/**
+ * json_response.cpp - Streamed JSON response implementation
+ */
+
+#include "json_response.h"
+#include "../constants.h"
+#include "../core/gzip_stream.h"
+#include "../core/json_pool.h"
+#include <ESPAsyncWebServer.h>
+#include <new>
+
+namespace {
+
+// ArduinoJson writer that keeps only the bytes [skip, skip + capacity)
+class WindowWriter {
+public:
+    WindowWriter(uint8_t* buffer, size_t capacity, size_t skip)
+        : buffer_(buffer), capacity_(capacity), skip_(skip), written_(0) {}
+
+    size_t write(uint8_t c) {
+        return write(&c, 1);
+    }
+
+    size_t write(const uint8_t* data, size_t len) {
+        if (skip_ >= len) {
+            skip_ -= len;
+            return len;
+        }
+        data += skip_;
+        size_t take = min(len - skip_, capacity_ - written_);
+        memcpy(buffer_ + written_, data, take);
+        written_ += take;
+        skip_ = 0;
+        return len;   // Past the window: keep quiet, the serializer runs to the end
+    }
+
+    size_t written() const { return written_; }
+
+private:
+    uint8_t* buffer_;
+    size_t capacity_;
+    size_t skip_;
+    size_t written_;
+};
+
+/**
+ * Serializes the document again for every window, skipping what was
+ * already sent. That costs a few passes over large documents, but JSON
+ * serialization is fast next to the network and needs no state beyond
+ * the offset - ArduinoJson can't pause mid-document.
+ */
+class JsonStreamResponse : public AsyncAbstractResponse {
+public:
+    JsonStreamResponse(int status, JsonDocument&& doc, BodyFormat format)
+        : doc_(std::move(doc))
+        , format_(format)
+        , offset_(0) {
+        _code = status;
+        if (format_ == BodyFormat::MsgPack) {
+            _contentType = "application/msgpack";
+            _contentLength = measureMsgPack(doc_);
+        } else {
+            _contentType = "application/json";
+            _contentLength = measureJson(doc_);
+        }
+    }
+
+    bool _sourceValid() const override {
+        return true;
+    }
+
+    size_t _fillBuffer(uint8_t* buf, size_t maxLen) override {
+        WindowWriter writer(buf, maxLen, offset_);
+        if (format_ == BodyFormat::MsgPack) {
+            serializeMsgPack(doc_, writer);
+        } else {
+            serializeJson(doc_, writer);
+        }
+        offset_ += writer.written();
+        return writer.written();
+    }
+
+private:
+    JsonDocument doc_;
+    BodyFormat format_;
+    size_t offset_;
+};
+
+// Growing heap buffer for compressed output
+class BlobWriter : public Print {
+public:
+    explicit BlobWriter(size_t capacity)
+        : data_(static_cast<uint8_t*>(malloc(capacity)))
+        , capacity_(data_ ? capacity : 0)
+        , size_(0)
+        , failed_(!data_) {}
+
+    ~BlobWriter() { free(data_); }
+
+    size_t write(uint8_t c) override {
+        return write(&c, 1);
+    }
+
+    size_t write(const uint8_t* data, size_t len) override {
+        if (failed_) {
+            return 0;
+        }
+        if (size_ + len > capacity_) {
+            size_t capacity = max(capacity_ * 2, size_ + len);
+            uint8_t* grown = static_cast<uint8_t*>(realloc(data_, capacity));
+            if (!grown) {
+                failed_ = true;
+                return 0;
+            }
+            data_ = grown;
+            capacity_ = capacity;
+        }
+        memcpy(data_ + size_, data, len);
+        size_ += len;
+        return len;
+    }
+
+    bool failed() const { return failed_; }
+    size_t size() const { return size_; }
+
+    // Hand over the buffer, trimmed to size
+    uint8_t* release() {
+        uint8_t* trimmed = static_cast<uint8_t*>(realloc(data_, size_));
+        uint8_t* blob = trimmed ? trimmed : data_;
+        data_ = nullptr;
+        return blob;
+    }
+
+private:
+    uint8_t* data_;
+    size_t capacity_;
+    size_t size_;
+    bool failed_;
+};
+
+// Serves a gzipped body and frees it with the response
+class GzipBlobResponse : public AsyncAbstractResponse {
+public:
+    GzipBlobResponse(int status, uint8_t* blob, size_t size)
+        : blob_(blob)
+        , offset_(0) {
+        _code = status;
+        _contentType = "application/json";
+        _contentLength = size;
+        addHeader("Content-Encoding", "gzip");
+    }
+
+    ~GzipBlobResponse() { free(blob_); }
+
+    bool _sourceValid() const override {
+        return true;
+    }
+
+    size_t _fillBuffer(uint8_t* buf, size_t maxLen) override {
+        size_t n = min(maxLen, _contentLength - offset_);
+        memcpy(buf, blob_ + offset_, n);
+        offset_ += n;
+        return n;
+    }
+
+private:
+    uint8_t* blob_;
+    size_t offset_;
+};
+
+// Compressing needs the encoder in one block, plus room for the output
+bool gzipAffordable(size_t jsonSize) {
+    return ESP.getFreeHeap() >= GZIP_MIN_FREE_HEAP &&
+           ESP.getMaxAllocHeap() >= sizeof(lume::GzipStream) + jsonSize / 4;
+}
+
+} // anonymous namespace
+
+bool acceptsGzip(AsyncWebServerRequest* request) {
+    return request->hasHeader("Accept-Encoding") &&
+           request->header("Accept-Encoding").indexOf("gzip") >= 0;
+}
+
+uint8_t* gzipJson(const JsonDocument& doc, size_t jsonSize, size_t& gzipSize, uint32_t* crc) {
+    BlobWriter blob(jsonSize / 4 + 64);
+    lume::GzipStream* gzip = new (std::nothrow) lume::GzipStream(blob);
+    if (!gzip) {
+        return nullptr;
+    }
+    serializeJson(doc, *gzip);
+    gzip->finish();
+    if (crc) {
+        *crc = gzip->getCrc32();
+    }
+    delete gzip;
+    if (blob.failed()) {
+        return nullptr;
+    }
+    gzipSize = blob.size();
+    return blob.release();
+}
+
+BodyFormat responseFormat(AsyncWebServerRequest* request) {
+    if (request->hasHeader("Accept") && request->header("Accept").indexOf("msgpack") >= 0) {
+        return BodyFormat::MsgPack;
+    }
+    return BodyFormat::Json;
+}
+
+AsyncWebServerResponse* beginJsonResponse(int status, JsonDocument&& doc, BodyFormat format, const char* vary) {
+    AsyncWebServerResponse* response = new JsonStreamResponse(status, std::move(doc), format);
+    if (vary) {
+        response->addHeader("Vary", vary);
+    }
+    return response;
+}
+
+void sendJsonResponse(AsyncWebServerRequest* request, int status, JsonDocument&& doc) {
+    BodyFormat format = responseFormat(request);
+    if (format == BodyFormat::Json) {
+        size_t jsonSize = measureJson(doc);
+        if (jsonSize >= GZIP_MIN_RESPONSE_SIZE) {
+            AsyncWebServerResponse* response = nullptr;
+            if (acceptsGzip(request) && gzipAffordable(jsonSize)) {
+                size_t gzipSize = 0;
+                uint8_t* blob = gzipJson(doc, jsonSize, gzipSize);
+                if (blob) {
+                    // The document is no longer needed: free it before sending
+                    doc.clear();
+                    response = new GzipBlobResponse(status, blob, gzipSize);
+                }
+            }
+            if (!response) {
+                response = beginJsonResponse(status, std::move(doc), format, nullptr);
+            }
+            response->addHeader("Vary", "Accept, Accept-Encoding");
+            request->send(response);
+            return;
+        }
+    }
+    request->send(beginJsonResponse(status, std::move(doc), format));
+}
+
+void sendJsonError(AsyncWebServerRequest* request, int status, const char* code, const char* message, const char* field) {
+    JsonDocument doc(JSON_SITE("v2.error"));
+    doc["error"] = code;
+    doc["message"] = message;
+    if (field && field[0] != '\0') {
+        doc["field"] = field;
+    }
+
+    sendJsonResponse(request, status, std::move(doc));
+}
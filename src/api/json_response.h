@@ -0,0 +1,67 @@
+/**
+ * json_response.h - Stream JsonDocuments into HTTP responses
+ *
+ * Handlers build one JsonDocument; whether it goes out as JSON or
+ * MessagePack is decided here, from the request's Accept header, so the
+ * two encodings can't drift apart.
+ */
+
+#pragma once
+
+#include <ArduinoJson.h>
+
+// Forward declarations
+class AsyncWebServerRequest;
+class AsyncWebServerResponse;
+
+// Wire encodings of a JsonDocument
+enum class BodyFormat : uint8_t {
+    Json,       // application/json
+    MsgPack     // application/msgpack (also x-msgpack, vnd.msgpack)
+};
+
+// MessagePack if the Accept header names it, else JSON
+BodyFormat responseFormat(AsyncWebServerRequest* request);
+
+/**
+ * Send a JsonDocument as a JSON (or negotiated MessagePack) response
+ * without building the text in RAM
+ *
+ * The document moves into the response, which serializes it straight into
+ * the TCP send buffer as the connection drains, one buffer-sized window
+ * per call. Peak memory per request is the document plus one TCP segment,
+ * instead of the document plus its whole serialized String. The length is
+ * measured up front, so the response carries a normal Content-Length.
+ *
+ * JSON of GZIP_MIN_RESPONSE_SIZE or more goes out gzipped when the client
+ * accepts it: compressed once into a heap blob (about a quarter of the
+ * text) with GzipStream's fixed working set, then sent from there. With
+ * less than GZIP_MIN_FREE_HEAP free it is streamed uncompressed as above.
+ * Every response carries Vary: Accept, plus Accept-Encoding where gzip
+ * could have applied, so caches keep the encodings apart.
+ *
+ * Usage: sendJsonResponse(request, 200, std::move(doc));
+ */
+void sendJsonResponse(AsyncWebServerRequest* request, int status, JsonDocument&& doc);
+
+// The same response, for callers that add headers before sending it
+// (never compressed). vary names the request headers that chose the
+// encoding; nullptr if the caller adds its own Vary header.
+AsyncWebServerResponse* beginJsonResponse(int status, JsonDocument&& doc, BodyFormat format = BodyFormat::Json,
+                                          const char* vary = "Accept");
+
+// Send {"error": code, "message": message, "field": field} (field only if
+// given), the v2 API's error body
+void sendJsonError(AsyncWebServerRequest* request, int status, const char* code, const char* message, const char* field = nullptr);
+
+// Whether the request's Accept-Encoding allows gzip
+bool acceptsGzip(AsyncWebServerRequest* request);
+
+/**
+ * Serialize a document as gzipped JSON into a malloc'd blob
+ *
+ * jsonSize (from measureJson) sizes the first allocation. Returns nullptr
+ * if the heap ran out; otherwise the caller owns the blob. crc, if given,
+ * receives the CRC-32 of the uncompressed JSON.
+ */
+uint8_t* gzipJson(const JsonDocument& doc, size_t jsonSize, size_t& gzipSize, uint32_t* crc = nullptr);
@@ -6,20 +6,19 @@
 #include "../main.h"
 #include "../constants.h"
 #include "../logging.h"
+#include "../core/json_pool.h"
+#include "json_response.h"
 #include "../core/controller.h"
+#include "body.h"
+#include "write_limit.h"
 #include <ArduinoJson.h>
 
-// Request body buffer for async handling
-static String nightlightBodyBuffer;
-
 void handleApiNightlightGet(AsyncWebServerRequest* request) {
-    JsonDocument doc;
+    JsonDocument doc(JSON_SITE("api.nightlight.get"));
     doc["active"] = lume::controller.isNightlightActive();
     doc["progress"] = lume::controller.getNightlightProgress();
     
-    String response;
-    serializeJson(doc, response);
-    request->send(200, "application/json", response);
+    sendJsonResponse(request, 200, std::move(doc));
 }
 
 void handleApiNightlightPost(AsyncWebServerRequest* request, uint8_t* data, size_t len, size_t index, size_t total) {
@@ -28,29 +27,31 @@ void handleApiNightlightPost(AsyncWebServerRequest* request, uint8_t* data, size
         sendUnauthorized(request);
         return;
     }
-    
-    // Body size validation
-    if (index == 0) {
-        if (total > MAX_REQUEST_BODY_SIZE) {
-            request->send(413, "application/json", "{\"error\":\"Request too large\"}");
-            return;
-        }
-        nightlightBodyBuffer = "";
-        nightlightBodyBuffer.reserve(total);
+
+    if (index == 0 && !admitWrite(request, WriteEndpoint::Other, total)) {
+        return;
     }
     
     // Accumulate body chunks
-    nightlightBodyBuffer += String((char*)data, len);
+    BodyStatus body = accumulateBody(request, data, len, index, total);
+    if (body == BodyStatus::TooLarge) {
+        request->send(413, "application/json", "{\"error\":\"Request too large\"}");
+        return;
+    }
+    if (body == BodyStatus::NoMemory) {
+        request->send(503, "application/json", "{\"error\":\"Out of memory\"}");
+        return;
+    }
     
     // Only process when complete
-    if (index + len < total) {
+    if (body != BodyStatus::Complete) {
         return;
     }
     
-    LOG_DEBUG(LogTag::WEB, "Nightlight request: %s", nightlightBodyBuffer.c_str());
+    LOG_DEBUG(LogTag::WEB, "Nightlight request: %s", requestBody(request));
     
-    JsonDocument doc;
-    DeserializationError error = deserializeJson(doc, nightlightBodyBuffer);
+    JsonDocument doc(JSON_SITE("api.nightlight.post"));
+    DeserializationError error = deserializeJson(doc, requestBody(request), total);
     
     if (error) {
         request->send(400, "application/json", "{\"error\":\"Invalid JSON\"}");
@@ -62,11 +63,9 @@ void handleApiNightlightPost(AsyncWebServerRequest* request, uint8_t* data, size
     
     // Validate duration (between 1 second and max)
     if (duration < 1 || duration > NIGHTLIGHT_MAX_DURATION) {
-        JsonDocument response;
+        JsonDocument response(JSON_SITE("api.nightlight.error"));
         response["error"] = "Duration must be between 1 and " + String(NIGHTLIGHT_MAX_DURATION) + " seconds";
-        String responseStr;
-        serializeJson(response, responseStr);
-        request->send(400, "application/json", responseStr);
+        sendJsonResponse(request, 400, std::move(response));
         return;
     }
     
@@ -77,15 +76,13 @@ void handleApiNightlightPost(AsyncWebServerRequest* request, uint8_t* data, size
     lume::controller.startNightlight(duration, targetBrightness);
     
     // Return status
-    JsonDocument response;
+    JsonDocument response(JSON_SITE("api.nightlight.reply"));
     response["success"] = true;
     response["duration"] = duration;
     response["targetBrightness"] = targetBrightness;
     response["startBrightness"] = lume::controller.getBrightness();
     
-    String responseStr;
-    serializeJson(response, responseStr);
-    request->send(200, "application/json", responseStr);
+    sendJsonResponse(request, 200, std::move(response));
     
     LOG_INFO(LogTag::WEB, "Nightlight started: %ds fade to %d", duration, targetBrightness);
 }
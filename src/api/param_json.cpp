@@ -0,0 +1,41 @@
+/**
+ * param_json.cpp - Effect param values from JSON
+ */
+
+#include "param_json.h"
+
+bool paramFromJson(const lume::ParamDesc& desc, JsonVariantConst value, lume::ParamValues::Slot& out) {
+    switch (desc.type) {
+        case lume::ParamType::Int:
+            if (!value.is<int>()) return false;
+            out.intVal = constrain(value.as<int>(), desc.minInt, desc.maxInt);
+            return true;
+        case lume::ParamType::Float:
+            if (!value.is<float>()) return false;
+            out.floatVal = constrain(value.as<float>(), desc.minFloat, desc.maxFloat);
+            return true;
+        case lume::ParamType::Color:
+            if (value.is<const char*>()) {
+                const char* hex = value.as<const char*>();
+                if (hex[0] != '#' || strlen(hex) != 7) return false;
+                uint32_t rgb = strtoul(hex + 1, nullptr, 16);
+                out.colorVal = CRGB((rgb >> 16) & 0xFF, (rgb >> 8) & 0xFF, rgb & 0xFF);
+                return true;
+            }
+            if (value.is<JsonArrayConst>() && value.size() == 3) {
+                out.colorVal = CRGB(value[0].as<uint8_t>(), value[1].as<uint8_t>(), value[2].as<uint8_t>());
+                return true;
+            }
+            return false;
+        case lume::ParamType::Bool:
+            if (!value.is<bool>()) return false;
+            out.boolVal = value.as<bool>();
+            return true;
+        case lume::ParamType::Enum:
+            if (!value.is<int>()) return false;
+            out.enumVal = value.as<uint8_t>();
+            return true;
+        default:
+            return false;   // Palettes are set by preset, not as a slot
+    }
+}
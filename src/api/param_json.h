@@ -0,0 +1,17 @@
+/**
+ * param_json.h - Effect param values from JSON
+ */
+
+#pragma once
+
+#include <ArduinoJson.h>
+#include "../core/param_schema.h"
+
+/**
+ * Read one effect param value as typed by its schema entry
+ *
+ * Int and Float are clamped to the schema's range; colors are "#rrggbb"
+ * or [r, g, b]. Returns false if the value has the wrong type. Palette
+ * params have no slot value and are always refused.
+ */
+bool paramFromJson(const lume::ParamDesc& desc, JsonVariantConst value, lume::ParamValues::Slot& out);
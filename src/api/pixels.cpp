@@ -2,37 +2,132 @@
 #include "../main.h"
 #include "../constants.h"
 #include "../logging.h"
+#include "../core/json_pool.h"
+#include "json_response.h"
 #include "../lume.h"
+#include "../protocols/realtime.h"
+#include "body.h"
+#include "write_limit.h"
 
-// Static body buffer for async request handling
-static String pixelsBodyBuffer;
+static void sendPixelsSet(AsyncWebServerRequest* request, uint16_t count) {
+    JsonDocument response(JSON_SITE("api.pixels.reply"));
+    response["success"] = true;
+    response["pixelsSet"] = count;
+    sendJsonResponse(request, 200, std::move(response));
+}
+
+// Raw uploads write into the one staging buffer chunk by chunk, so only
+// one may be in progress; this is it. Handlers all run on the AsyncTCP
+// task, so no lock is needed. An owner that went quiet without a
+// disconnect is taken over after PIXEL_UPLOAD_TIMEOUT_MS.
+static AsyncWebServerRequest* uploadOwner = nullptr;
+static uint32_t uploadActivityMs = 0;
+
+static bool uploadInProgress(AsyncWebServerRequest* request) {
+    return uploadOwner && uploadOwner != request &&
+           millis() - uploadActivityMs < PIXEL_UPLOAD_TIMEOUT_MS;
+}
+
+static void sendUploadConflict(AsyncWebServerRequest* request) {
+    request->send(409, "application/json", "{\"error\":\"Another pixel upload is in progress\"}");
+}
+
+// Raw RGB body: chunks go straight into the protocol's staging buffer.
+// The offset and the size check are derived from the request again for
+// every chunk; chunks of any request but the owner's are dropped.
+static void handlePixelsOctetStream(AsyncWebServerRequest* request, uint8_t* data, size_t len, size_t index, size_t total) {
+    long offset = 0;
+    if (request->hasParam("offset")) {
+        offset = request->getParam("offset")->value().toInt();
+    }
+    if (offset < 0) {
+        if (index == 0) {
+            request->send(400, "application/json", "{\"error\":\"offset must not be negative\"}");
+        }
+        return;
+    }
+    // 64-bit, so a huge offset can't wrap into range
+    if ((uint64_t)offset * 3 + total > (uint64_t)MAX_LED_COUNT * 3) {
+        if (index == 0) {
+            request->send(413, "application/json", "{\"error\":\"More pixels than MAX_LED_COUNT\"}");
+        }
+        return;
+    }
+    if (index == 0) {
+        if (uploadInProgress(request)) {
+            sendUploadConflict(request);
+            return;
+        }
+        if (!admitWrite(request, WriteEndpoint::Pixels, total)) {
+            return;
+        }
+        uploadOwner = request;
+        request->onDisconnect([request]() {
+            if (uploadOwner == request) {
+                uploadOwner = nullptr;
+            }
+        });
+        lume::httpPixelProtocol.notePacket();
+    } else if (uploadOwner != request) {
+        return;     // First chunk was refused, or the upload was taken over
+    }
+    uploadActivityMs = millis();
+    
+    uint32_t byteOffset = (uint32_t)offset * 3;
+    lume::httpPixelProtocol.writeBytes(byteOffset + index, data, len);
+    
+    if (index + len >= total) {
+        uploadOwner = nullptr;
+        lume::httpPixelProtocol.commit();
+        sendPixelsSet(request, total / 3);
+    }
+}
 
 // Direct pixel control handler
 // Accepts: { "pixels": [[r,g,b], [r,g,b], ...], "brightness": 255 }
 // Or compact: { "rgb": [r,g,b,r,g,b,...], "brightness": 255 }
+// Or raw bytes r,g,b,r,g,b,... as application/octet-stream (?offset=first pixel)
+//
+// All forms are written into the "HTTP" protocol's frame buffer and shown
+// by the controller, never from this (AsyncTCP) task.
 void handleApiPixels(AsyncWebServerRequest* request, uint8_t* data, size_t len, size_t index, size_t total) {
-    // Auth check at start of request
-    if (index == 0 && !checkAuth(request)) {
-        sendUnauthorized(request);
+    // Auth check at start of request; the other chunks are then dropped
+    // (no body buffer, and checkAuth() fails again for raw bodies)
+    if (!checkAuth(request)) {
+        if (index == 0) {
+            sendUnauthorized(request);
+        }
         return;
     }
     
-    if (index == 0) {
-        pixelsBodyBuffer = "";
-        if (total > MAX_REQUEST_BODY_SIZE) {
-            request->send(413, "application/json", "{\"error\":\"Request body too large\"}");
-            return;
-        }
+    if (request->contentType().startsWith("application/octet-stream")) {
+        handlePixelsOctetStream(request, data, len, index, total);
+        return;
     }
     
-    // Append data safely
-    for (size_t i = 0; i < len; i++) {
-        pixelsBodyBuffer += (char)data[i];
+    if (index == 0 && !admitWrite(request, WriteEndpoint::Pixels, total)) {
+        return;
     }
     
-    if (index + len >= total) {
-        JsonDocument doc;
-        DeserializationError err = deserializeJson(doc, pixelsBodyBuffer);
+    BodyStatus body = accumulateBody(request, data, len, index, total);
+    if (body == BodyStatus::TooLarge) {
+        request->send(413, "application/json", "{\"error\":\"Request body too large\"}");
+        return;
+    }
+    if (body == BodyStatus::NoMemory) {
+        request->send(503, "application/json", "{\"error\":\"Out of memory\"}");
+        return;
+    }
+    
+    if (body == BodyStatus::Complete) {
+        // Writes the same staging buffer as a raw upload
+        if (uploadInProgress(request)) {
+            sendUploadConflict(request);
+            return;
+        }
+        
+        JsonDocument doc(JSON_SITE("api.pixels"));
+        DeserializationError err = deserializeJson(doc, requestBody(request), total);
         
         if (err) {
             LOG_WARN(LogTag::WEB, "Pixels JSON parse error: %s", err.c_str());
@@ -40,12 +135,14 @@ void handleApiPixels(AsyncWebServerRequest* request, uint8_t* data, size_t len,
             return;
         }
         
-        CRGB* leds = lume::controller.getLeds();
+        lume::RealtimeProtocol& out = lume::httpPixelProtocol;
+        CRGB* leds = out.staging();
         uint16_t ledCount = lume::controller.getLedCount();
         
         // Handle brightness if provided
         if (doc["brightness"].is<int>()) {
-            lume::controller.setBrightness(constrain(doc["brightness"].as<int>(), 0, 255));
+            lume::controller.enqueueCommand(
+                lume::Command::setGlobalBrightness(constrain(doc["brightness"].as<int>(), 0, 255)));
         }
         
         // Method 1: Array of [r,g,b] arrays
@@ -62,14 +159,10 @@ void handleApiPixels(AsyncWebServerRequest* request, uint8_t* data, size_t len,
                 }
             }
             
-            FastLED.show();
-            
-            JsonDocument response;
-            response["success"] = true;
-            response["pixelsSet"] = count;
-            String responseStr;
-            serializeJson(response, responseStr);
-            request->send(200, "application/json", responseStr);
+            out.notePacket();
+            out.markWritten(count);
+            out.commit();
+            sendPixelsSet(request, count);
             return;
         }
         
@@ -84,14 +177,10 @@ void handleApiPixels(AsyncWebServerRequest* request, uint8_t* data, size_t len,
                 leds[i].b = rgb[i * 3 + 2].as<uint8_t>();
             }
             
-            FastLED.show();
-            
-            JsonDocument response;
-            response["success"] = true;
-            response["pixelsSet"] = count;
-            String responseStr;
-            serializeJson(response, responseStr);
-            request->send(200, "application/json", responseStr);
+            out.notePacket();
+            out.markWritten(count);
+            out.commit();
+            sendPixelsSet(request, count);
             return;
         }
         
@@ -104,8 +193,10 @@ void handleApiPixels(AsyncWebServerRequest* request, uint8_t* data, size_t len,
             }
             CRGB color(fill[0].as<uint8_t>(), fill[1].as<uint8_t>(), fill[2].as<uint8_t>());
             fill_solid(leds, ledCount, color);
-            FastLED.show();
             
+            out.notePacket();
+            out.markWritten(ledCount);
+            out.commit();
             request->send(200, "application/json", "{\"success\":true,\"filled\":true}");
             return;
         }
@@ -125,8 +216,10 @@ void handleApiPixels(AsyncWebServerRequest* request, uint8_t* data, size_t len,
             CRGB endColor(to[0].as<uint8_t>(), to[1].as<uint8_t>(), to[2].as<uint8_t>());
             
             fill_gradient_RGB(leds, 0, startColor, ledCount - 1, endColor);
-            FastLED.show();
             
+            out.notePacket();
+            out.markWritten(ledCount);
+            out.commit();
             request->send(200, "application/json", "{\"success\":true,\"gradient\":true}");
             return;
         }
@@ -6,16 +6,17 @@
 #include "../main.h"
 #include "../constants.h"
 #include "../logging.h"
+#include "../core/json_pool.h"
+#include "json_response.h"
 #include "../storage.h"
 #include "../core/controller.h"
 #include "../core/effect_registry.h"
+#include "body.h"
+#include "write_limit.h"
 #include <ArduinoJson.h>
 #include <HTTPClient.h>
 #include <WiFiClientSecure.h>
 
-// Request body buffer for async handling
-static String promptBodyBuffer;
-
 extern Config config;
 extern bool checkAuth(AsyncWebServerRequest* request);
 extern void sendUnauthorized(AsyncWebServerRequest* request);
@@ -71,7 +72,7 @@ bool callAnthropicAPI(const String& userPrompt, String& response, String& error)
     http.setTimeout(30000); // 30 second timeout
     
     // Build request
-    JsonDocument requestDoc;
+    JsonDocument requestDoc(JSON_SITE("prompt.request"));
     requestDoc["model"] = config.aiModel;
     requestDoc["max_tokens"] = 1024;
     
@@ -93,7 +94,7 @@ bool callAnthropicAPI(const String& userPrompt, String& response, String& error)
     if (httpCode == 200) {
         String payload = http.getString();
         
-        JsonDocument responseDoc;
+        JsonDocument responseDoc(JSON_SITE("prompt.response"));
         DeserializationError parseError = deserializeJson(responseDoc, payload);
         
         if (parseError) {
@@ -121,7 +122,7 @@ bool callAnthropicAPI(const String& userPrompt, String& response, String& error)
             LOG_ERROR(LogTag::WEB, "Anthropic API error %d: %s", httpCode, payload.c_str());
             
             // Try to parse error details from response
-            JsonDocument errorDoc;
+            JsonDocument errorDoc(JSON_SITE("prompt.error"));
             if (deserializeJson(errorDoc, payload) == DeserializationError::Ok) {
                 if (errorDoc["error"]["message"].is<const char*>()) {
                     String errorMsg = errorDoc["error"]["message"].as<String>();
@@ -198,27 +199,29 @@ void handleApiPromptPost(AsyncWebServerRequest* request, uint8_t* data, size_t l
         sendUnauthorized(request);
         return;
     }
-    
-    // Body size validation
-    if (index == 0) {
-        if (total > MAX_REQUEST_BODY_SIZE) {
-            request->send(413, "application/json", "{\"error\":\"Request too large\"}");
-            return;
-        }
-        promptBodyBuffer = "";
-        promptBodyBuffer.reserve(total);
+
+    if (index == 0 && !admitWrite(request, WriteEndpoint::Other, total)) {
+        return;
     }
     
     // Accumulate body chunks
-    promptBodyBuffer += String((char*)data, len);
+    BodyStatus body = accumulateBody(request, data, len, index, total);
+    if (body == BodyStatus::TooLarge) {
+        request->send(413, "application/json", "{\"error\":\"Request too large\"}");
+        return;
+    }
+    if (body == BodyStatus::NoMemory) {
+        request->send(503, "application/json", "{\"error\":\"Out of memory\"}");
+        return;
+    }
     
     // Only process when complete
-    if (index + len < total) {
+    if (body != BodyStatus::Complete) {
         return;
     }
     
-    JsonDocument doc;
-    DeserializationError error = deserializeJson(doc, promptBodyBuffer);
+    JsonDocument doc(JSON_SITE("api.prompt"));
+    DeserializationError error = deserializeJson(doc, requestBody(request), total);
     
     if (error) {
         request->send(400, "application/json", "{\"error\":\"Invalid JSON\"}");
@@ -238,55 +241,47 @@ void handleApiPromptPost(AsyncWebServerRequest* request, uint8_t* data, size_t l
     String apiError;
     
     if (!callAnthropicAPI(userPrompt, aiResponse, apiError)) {
-        JsonDocument response;
+        JsonDocument response(JSON_SITE("api.prompt.api_error"));
         response["success"] = false;
         response["error"] = apiError;
         
-        String output;
-        serializeJson(response, output);
-        request->send(500, "application/json", output);
+        sendJsonResponse(request, 500, std::move(response));
         return;
     }
     
     LOG_DEBUG(LogTag::WEB, "AI Response: %s", aiResponse.c_str());
     
     // Parse AI response as JSON spec
-    JsonDocument specDoc;
+    JsonDocument specDoc(JSON_SITE("prompt.spec"));
     DeserializationError specError = deserializeJson(specDoc, aiResponse);
     
     if (specError) {
-        JsonDocument response;
+        JsonDocument response(JSON_SITE("api.prompt.spec_error"));
         response["success"] = false;
         response["error"] = "AI returned invalid format";
         
-        String output;
-        serializeJson(response, output);
-        request->send(500, "application/json", output);
+        sendJsonResponse(request, 500, std::move(response));
         return;
     }
     
     // Apply the spec
     String applyError;
     if (!applySpec(specDoc, applyError)) {
-        JsonDocument response;
+        JsonDocument response(JSON_SITE("api.prompt.apply_error"));
         response["success"] = false;
         response["error"] = applyError;
         
-        String output;
-        serializeJson(response, output);
-        request->send(500, "application/json", output);
+        sendJsonResponse(request, 500, std::move(response));
         return;
     }
     
     // Success
-    JsonDocument response;
+    JsonDocument response(JSON_SITE("api.prompt.reply"));
     response["success"] = true;
     response["message"] = "Lights updated successfully!";
     response["spec"] = specDoc;
     
-    String output;
-    serializeJson(response, output);
-    request->send(200, "application/json", output);
+    sendJsonResponse(request, 200, std::move(response));
     
     LOG_INFO(LogTag::WEB, "AI prompt applied successfully");
 }
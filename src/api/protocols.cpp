@@ -0,0 +1,231 @@
+/**
+ * protocols.cpp - Protocol arbitration API implementation
+ */
+
+#include "protocols.h"
+#include "../main.h"
+#include "../constants.h"
+#include "../logging.h"
+#include "../core/json_pool.h"
+#include "json_response.h"
+#include "../storage.h"
+#include "../core/controller.h"
+#include "../protocols/protocol.h"
+#include "body.h"
+#include "write_limit.h"
+#include <ArduinoJson.h>
+
+namespace {
+
+void policyToJson(const lume::ProtocolPolicy& policy, JsonObject obj) {
+    obj["priority"] = policy.priority;
+    obj["holdMs"] = policy.holdMs;
+    obj["fadeMs"] = policy.fadeMs;
+    obj["takeover"] = lume::takeoverRuleToString(policy.takeover);
+}
+
+// Validate one policy object against the current policy; fills `out`.
+// Returns the offending field name, or nullptr when valid.
+const char* policyFromJson(JsonObjectConst obj, lume::ProtocolPolicy& out) {
+    if (!obj["priority"].isNull()) {
+        if (!obj["priority"].is<int>()) return "priority";
+        int v = obj["priority"].as<int>();
+        if (v < 0 || v > 255) return "priority";
+        out.priority = v;
+    }
+    if (!obj["holdMs"].isNull()) {
+        if (!obj["holdMs"].is<int>()) return "holdMs";
+        int v = obj["holdMs"].as<int>();
+        if (v < 100 || v > lume::PROTOCOL_MAX_HOLD_MS) return "holdMs";
+        out.holdMs = v;
+    }
+    if (!obj["fadeMs"].isNull()) {
+        if (!obj["fadeMs"].is<int>()) return "fadeMs";
+        int v = obj["fadeMs"].as<int>();
+        if (v < 0 || v > lume::PROTOCOL_MAX_FADE_MS) return "fadeMs";
+        out.fadeMs = v;
+    }
+    if (!obj["takeover"].isNull()) {
+        if (!lume::takeoverRuleFromString(obj["takeover"].as<const char*>(), out.takeover)) {
+            return "takeover";
+        }
+    }
+    return nullptr;
+}
+
+void buildProtocolsJson(JsonDocument& doc) {
+    const lume::ProtocolArbiter& arbiter = lume::controller.getArbiter();
+    uint32_t now = millis();
+    uint16_t ledCount = lume::controller.getLedCount();
+    lume::IProtocol* owner = arbiter.getOwner();
+
+    doc["state"] = lume::arbiterStateToString(arbiter.getState());
+    if (owner) {
+        doc["owner"] = owner->name();
+    } else {
+        doc["owner"] = nullptr;
+    }
+    doc["handovers"] = arbiter.getHandoverCount();
+
+    JsonArray list = doc["protocols"].to<JsonArray>();
+    for (uint8_t i = 0; i < arbiter.count(); i++) {
+        lume::IProtocol* proto = arbiter.get(i);
+        JsonObject p = list.add<JsonObject>();
+        p["name"] = proto->name();
+        p["enabled"] = proto->isEnabled();
+        p["live"] = arbiter.isLive(i, now);
+        p["owner"] = (proto == owner);
+        if (arbiter.getLastFrameTime(i) != 0) {
+            p["lastFrameMs"] = now - arbiter.getLastFrameTime(i);
+        }
+        policyToJson(arbiter.getPolicy(i), p);
+    }
+
+    // Who drives which LEDs. The owner covers the start of the strip up to
+    // its frame size; LEDs past that keep their last value.
+    JsonArray leds = doc["leds"].to<JsonArray>();
+    if (owner) {
+        uint16_t covered = min(owner->getBufferSize(), ledCount);
+        JsonObject range = leds.add<JsonObject>();
+        range["start"] = 0;
+        range["count"] = covered;
+        range["owner"] = owner->name();
+        if (covered < ledCount) {
+            JsonObject rest = leds.add<JsonObject>();
+            rest["start"] = covered;
+            rest["count"] = ledCount - covered;
+            rest["owner"] = "held";
+        }
+    } else {
+        JsonObject range = leds.add<JsonObject>();
+        range["start"] = 0;
+        range["count"] = ledCount;
+        range["owner"] = "effects";
+    }
+}
+
+void savePolicies() {
+    const lume::ProtocolArbiter& arbiter = lume::controller.getArbiter();
+    JsonDocument doc(JSON_SITE("v2.protocols.save"));
+    JsonArray arr = doc.to<JsonArray>();
+    for (uint8_t i = 0; i < arbiter.count(); i++) {
+        JsonObject p = arr.add<JsonObject>();
+        p["name"] = arbiter.get(i)->name();
+        policyToJson(arbiter.getPolicy(i), p);
+    }
+    if (!storage.saveProtocolPolicies(doc)) {
+        LOG_WARN(LogTag::STORAGE, "Failed to save protocol policies");
+    }
+}
+
+} // anonymous namespace
+
+void handleApiV2ProtocolsGet(AsyncWebServerRequest* request) {
+    if (!checkAuth(request)) {
+        sendUnauthorized(request);
+        return;
+    }
+
+    JsonDocument doc(JSON_SITE("v2.protocols.get"));
+    buildProtocolsJson(doc);
+
+    sendJsonResponse(request, 200, std::move(doc));
+}
+
+void handleApiV2ProtocolsUpdate(AsyncWebServerRequest* request, uint8_t* data, size_t len, size_t index, size_t total) {
+    // Auth check at start of request
+    if (index == 0 && !checkAuth(request)) {
+        sendUnauthorized(request);
+        return;
+    }
+
+    if (index == 0 && !admitWrite(request, WriteEndpoint::Other, total)) {
+        return;
+    }
+
+    // Accumulate chunks
+    BodyStatus body = accumulateBody(request, data, len, index, total);
+    if (body == BodyStatus::TooLarge) {
+        sendJsonError(request, 413, "payload_too_large", "Request body exceeds MAX_REQUEST_BODY_SIZE");
+        return;
+    }
+    if (body == BodyStatus::NoMemory) {
+        sendJsonError(request, 503, "out_of_memory", "Not enough free heap for the request body");
+        return;
+    }
+
+    if (body != BodyStatus::Complete) {
+        return;
+    }
+
+    JsonDocument doc(JSON_SITE("v2.protocols.update"));
+    DeserializationError error = parseBody(request, doc);
+
+    if (error) {
+        sendJsonError(request, 400, "invalid_json", "Unable to parse JSON payload");
+        return;
+    }
+
+    JsonArrayConst entries = doc["protocols"].as<JsonArrayConst>();
+    if (entries.isNull()) {
+        sendJsonError(request, 400, "invalid_payload", "Expected a 'protocols' array", "protocols");
+        return;
+    }
+
+    // Validate everything before applying anything
+    lume::ProtocolArbiter& arbiter = lume::controller.getArbiter();
+    lume::ProtocolPolicy updated[lume::MAX_PROTOCOLS];
+    bool touched[lume::MAX_PROTOCOLS] = {false};
+    for (uint8_t i = 0; i < arbiter.count(); i++) {
+        updated[i] = arbiter.getPolicy(i);
+    }
+
+    for (JsonObjectConst entry : entries) {
+        const char* name = entry["name"].as<const char*>();
+        int idx = name ? arbiter.find(name) : -1;
+        if (idx < 0) {
+            sendJsonError(request, 404, "unknown_protocol", "No registered protocol with that name", "name");
+            return;
+        }
+
+        const char* badField = policyFromJson(entry, updated[idx]);
+        if (badField) {
+            sendJsonError(request, 400, "invalid_value", "Policy value missing or out of range", badField);
+            return;
+        }
+        touched[idx] = true;
+    }
+
+    for (uint8_t i = 0; i < arbiter.count(); i++) {
+        if (touched[i]) {
+            arbiter.setPolicy(i, updated[i]);
+            LOG_INFO(LogTag::LED, "Protocol %s: priority %d, hold %dms, fade %dms, takeover %s",
+                     arbiter.get(i)->name(), updated[i].priority, updated[i].holdMs,
+                     updated[i].fadeMs, lume::takeoverRuleToString(updated[i].takeover));
+        }
+    }
+    savePolicies();
+
+    JsonDocument response(JSON_SITE("v2.protocols.update.reply"));
+    buildProtocolsJson(response);
+    sendJsonResponse(request, 200, std::move(response));
+}
+
+void restoreProtocolPolicies() {
+    JsonDocument doc(JSON_SITE("v2.protocols.restore"));
+    if (!storage.loadProtocolPolicies(doc)) {
+        return;
+    }
+
+    lume::ProtocolArbiter& arbiter = lume::controller.getArbiter();
+    for (JsonObjectConst entry : doc.as<JsonArrayConst>()) {
+        const char* name = entry["name"].as<const char*>();
+        int idx = name ? arbiter.find(name) : -1;
+        if (idx < 0) continue;  // Protocol no longer built in
+
+        lume::ProtocolPolicy policy = arbiter.getPolicy(idx);
+        if (policyFromJson(entry, policy) == nullptr) {
+            arbiter.setPolicy(idx, policy);
+        }
+    }
+}
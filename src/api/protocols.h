@@ -0,0 +1,20 @@
+/**
+ * protocols.h - Protocol arbitration API handlers
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Forward declaration
+class AsyncWebServerRequest;
+
+// GET /api/v2/protocols - ownership state, policies, LED ranges
+void handleApiV2ProtocolsGet(AsyncWebServerRequest* request);
+
+// PUT /api/v2/protocols - update (and persist) arbitration policies
+void handleApiV2ProtocolsUpdate(AsyncWebServerRequest* request, uint8_t* data, size_t len, size_t index, size_t total);
+
+// Apply persisted policies (call after protocols are registered)
+void restoreProtocolPolicies();
@@ -2,10 +2,14 @@
 #include "../main.h"
 #include "../storage.h"
 #include "../logging.h"
+#include "../core/json_pool.h"
+#include "json_response.h"
 #include "../constants.h"
 #include "../core/controller.h"
 #include "../core/effect_registry.h"
 #include "../core/param_schema.h"
+#include "body.h"
+#include "write_limit.h"
 #include <ArduinoJson.h>
 
 // External globals
@@ -13,85 +17,6 @@ extern Config config;
 extern bool checkAuth(AsyncWebServerRequest* request);
 extern void sendUnauthorized(AsyncWebServerRequest* request);
 
-// Request body buffers
-static String segmentCreateBuffer;
-static String segmentUpdateBuffer;
-static String controllerUpdateBuffer;
-
-namespace {
-
-// Serialize ParamType to string
-const char* paramTypeToString(lume::ParamType type) {
-    switch (type) {
-        case lume::ParamType::Int:      return "int";
-        case lume::ParamType::Float:    return "float";
-        case lume::ParamType::Color:    return "color";
-        case lume::ParamType::Palette:  return "palette";
-        case lume::ParamType::Bool:     return "bool";
-        case lume::ParamType::Enum:     return "enum";
-        default:                        return "unknown";
-    }
-}
-
-// Serialize schema to JSON
-void schemaToJson(JsonArray& paramsArray, const lume::ParamSchema* schema) {
-    if (!schema || schema->count == 0) return;
-    
-    for (uint8_t i = 0; i < schema->count; i++) {
-        const lume::ParamDesc& p = schema->params[i];
-        JsonObject param = paramsArray.add<JsonObject>();
-        
-        param["id"] = p.id;
-        param["name"] = p.name;
-        param["type"] = paramTypeToString(p.type);
-        
-        switch (p.type) {
-            case lume::ParamType::Int:
-                param["default"] = p.defaultInt;
-                param["min"] = p.minInt;
-                param["max"] = p.maxInt;
-                break;
-            case lume::ParamType::Float:
-                param["default"] = p.defaultFloat;
-                param["min"] = p.minFloat;
-                param["max"] = p.maxFloat;
-                break;
-            case lume::ParamType::Color: {
-                char colorHex[8];
-                snprintf(colorHex, sizeof(colorHex), "#%02x%02x%02x", 
-                    p.defaultColor.r, p.defaultColor.g, p.defaultColor.b);
-                param["default"] = colorHex;
-                break;
-            }
-            case lume::ParamType::Bool:
-                param["default"] = (bool)(p.defaultInt != 0);
-                break;
-            case lume::ParamType::Enum:
-                param["default"] = p.defaultInt;
-                param["options"] = p.enumOptions;  // "opt1|opt2|opt3"
-                break;
-            case lume::ParamType::Palette:
-                // Palette list could be included or fetched separately
-                break;
-        }
-    }
-}
-
-void sendJsonError(AsyncWebServerRequest* request, int status, const char* code, const char* message, const char* field = nullptr) {
-    JsonDocument doc;
-    doc["error"] = code;
-    doc["message"] = message;
-    if (field && field[0] != '\0') {
-        doc["field"] = field;
-    }
-
-    String output;
-    serializeJson(doc, output);
-    request->send(status, "application/json", output);
-}
-
-}  // namespace
-
 // ===========================================================================
 // Helper: Serialize segment to JSON
 // ===========================================================================
@@ -152,7 +77,7 @@ void handleApiV2SegmentsList(AsyncWebServerRequest* request) {
         return;
     }
     
-    JsonDocument doc;
+    JsonDocument doc(JSON_SITE("v2.segments.list"));
     
     // Controller state
     doc["power"] = lume::controller.getPower();
@@ -169,9 +94,7 @@ void handleApiV2SegmentsList(AsyncWebServerRequest* request) {
         }
     }
     
-    String output;
-    serializeJson(doc, output);
-    request->send(200, "application/json", output);
+    sendJsonResponse(request, 200, std::move(doc));
 }
 
 // ===========================================================================
@@ -199,42 +122,41 @@ void handleApiV2SegmentGet(AsyncWebServerRequest* request) {
         return;
     }
     
-    JsonDocument doc;
+    JsonDocument doc(JSON_SITE("v2.segments.get"));
     JsonObject obj = doc.to<JsonObject>();
     segmentToJson(obj, seg, id);
     
-    String output;
-    serializeJson(doc, output);
-    request->send(200, "application/json", output);
+    sendJsonResponse(request, 200, std::move(doc));
 }
 
 // ===========================================================================
 // POST /api/v2/segments - Create new segment
 // ===========================================================================
 void handleApiV2SegmentCreate(AsyncWebServerRequest* request, uint8_t* data, size_t len, size_t index, size_t total) {
-    if (!checkAuth(request)) {
+    if (index == 0 && !checkAuth(request)) {
         sendUnauthorized(request);
         return;
     }
-    
-    // Validate size at first chunk
-    if (index == 0) {
-        segmentCreateBuffer = "";
-        if (total > MAX_REQUEST_BODY_SIZE) {
-            sendJsonError(request, 413, "payload_too_large", "Request body exceeds MAX_REQUEST_BODY_SIZE");
-            return;
-        }
+
+    if (index == 0 && !admitWrite(request, WriteEndpoint::Segments, total)) {
+        return;
     }
     
     // Accumulate chunks
-    for (size_t i = 0; i < len; i++) {
-        segmentCreateBuffer += (char)data[i];
+    BodyStatus body = accumulateBody(request, data, len, index, total);
+    if (body == BodyStatus::TooLarge) {
+        sendJsonError(request, 413, "payload_too_large", "Request body exceeds MAX_REQUEST_BODY_SIZE");
+        return;
+    }
+    if (body == BodyStatus::NoMemory) {
+        sendJsonError(request, 503, "out_of_memory", "Not enough free heap for the request body");
+        return;
     }
     
     // Process when complete
-    if (index + len >= total) {
-        JsonDocument doc;
-        DeserializationError error = deserializeJson(doc, segmentCreateBuffer);
+    if (body == BodyStatus::Complete) {
+        JsonDocument doc(JSON_SITE("v2.segments.create"));
+        DeserializationError error = parseBody(request, doc);
         
         if (error) {
             LOG_ERROR(LogTag::WEB, "JSON parse error: %s", error.c_str());
@@ -340,13 +262,11 @@ void handleApiV2SegmentCreate(AsyncWebServerRequest* request, uint8_t* data, siz
         }
         
         // Return created segment
-        JsonDocument responseDoc;
+        JsonDocument responseDoc(JSON_SITE("v2.segments.create.reply"));
         JsonObject obj = responseDoc.to<JsonObject>();
         segmentToJson(obj, seg, segmentId);
         
-        String output;
-        serializeJson(responseDoc, output);
-        request->send(201, "application/json", output);
+        sendJsonResponse(request, 201, std::move(responseDoc));
         
         LOG_INFO(LogTag::LED, "Created segment %d: start=%d length=%d", segmentId, start, length);
     }
@@ -356,10 +276,14 @@ void handleApiV2SegmentCreate(AsyncWebServerRequest* request, uint8_t* data, siz
 // PUT /api/v2/segments/{id} - Update segment
 // ===========================================================================
 void handleApiV2SegmentUpdate(AsyncWebServerRequest* request, uint8_t* data, size_t len, size_t index, size_t total) {
-    if (!checkAuth(request)) {
+    if (index == 0 && !checkAuth(request)) {
         sendUnauthorized(request);
         return;
     }
+
+    if (index == 0 && !admitWrite(request, WriteEndpoint::Segments, total)) {
+        return;
+    }
     
     // Parse segment ID from URL path
     String path = request->url();
@@ -367,34 +291,33 @@ void handleApiV2SegmentUpdate(AsyncWebServerRequest* request, uint8_t* data, siz
     uint8_t id = path.substring(lastSlash + 1).toInt();
     
     if (id > 7) {
-        sendJsonError(request, 400, "validation_error", "Segment ID must be between 0 and 7", "id");
-        return;
-    }
-    
-    // Validate size at first chunk
-    if (index == 0) {
-        segmentUpdateBuffer = "";
-        if (total > MAX_REQUEST_BODY_SIZE) {
-            sendJsonError(request, 413, "payload_too_large", "Request body exceeds MAX_REQUEST_BODY_SIZE");
-            return;
+        if (index == 0) {
+            sendJsonError(request, 400, "validation_error", "Segment ID must be between 0 and 7", "id");
         }
+        return;
     }
     
     // Accumulate chunks
-    for (size_t i = 0; i < len; i++) {
-        segmentUpdateBuffer += (char)data[i];
+    BodyStatus body = accumulateBody(request, data, len, index, total);
+    if (body == BodyStatus::TooLarge) {
+        sendJsonError(request, 413, "payload_too_large", "Request body exceeds MAX_REQUEST_BODY_SIZE");
+        return;
+    }
+    if (body == BodyStatus::NoMemory) {
+        sendJsonError(request, 503, "out_of_memory", "Not enough free heap for the request body");
+        return;
     }
     
     // Process when complete
-    if (index + len >= total) {
+    if (body == BodyStatus::Complete) {
         lume::Segment* seg = lume::controller.getSegment(id);
         if (!seg) {
             sendJsonError(request, 404, "not_found", "Segment not found", "id");
             return;
         }
         
-        JsonDocument doc;
-        DeserializationError error = deserializeJson(doc, segmentUpdateBuffer);
+        JsonDocument doc(JSON_SITE("v2.segments.update"));
+        DeserializationError error = parseBody(request, doc);
         
         if (error) {
             sendJsonError(request, 400, "invalid_json", "Unable to parse JSON payload");
@@ -476,13 +399,11 @@ void handleApiV2SegmentUpdate(AsyncWebServerRequest* request, uint8_t* data, siz
         }
         
         // Return updated segment
-        JsonDocument responseDoc;
+        JsonDocument responseDoc(JSON_SITE("v2.segments.update.reply"));
         JsonObject obj = responseDoc.to<JsonObject>();
         segmentToJson(obj, seg, id);
         
-        String output;
-        serializeJson(responseDoc, output);
-        request->send(200, "application/json", output);
+        sendJsonResponse(request, 200, std::move(responseDoc));
         
         LOG_INFO(LogTag::LED, "Updated segment %d", id);
     }
@@ -496,6 +417,9 @@ void handleApiV2SegmentDelete(AsyncWebServerRequest* request) {
         sendUnauthorized(request);
         return;
     }
+    if (!admitWrite(request, WriteEndpoint::Segments)) {
+        return;
+    }
     
     // Parse segment ID from URL path
     String path = request->url();
@@ -517,65 +441,6 @@ void handleApiV2SegmentDelete(AsyncWebServerRequest* request) {
     LOG_INFO(LogTag::LED, "Deleted segment %d", id);
 }
 
-// ===========================================================================
-// GET /api/v2/effects - List available effects
-// ===========================================================================
-void handleApiV2EffectsList(AsyncWebServerRequest* request) {
-    JsonDocument doc;
-    JsonArray effects = doc["effects"].to<JsonArray>();
-    
-    // Iterate through effect registry
-    lume::EffectRegistry& registry = lume::effects();
-    for (uint8_t i = 0; i < registry.getCount(); i++) {
-        const lume::EffectInfo* info = registry.getByIndex(i);
-        if (!info) continue;
-        
-        JsonObject effect = effects.add<JsonObject>();
-        effect["id"] = info->id;
-        effect["name"] = info->displayName;
-        effect["category"] = info->categoryName();
-        
-        // All effects now have schemas - serialize params from schema
-        JsonArray params = effect["params"].to<JsonArray>();
-        if (info->hasSchema()) {
-            schemaToJson(params, info->schema);
-        }
-        
-        // Effect metadata (derived from schema)
-        effect["usesPalette"] = info->usesPalette();
-        effect["colorCount"] = info->colorCount();
-        effect["usesSpeed"] = info->hasParam("speed");
-        effect["usesIntensity"] = info->hasParam("intensity");
-    }
-    
-    String output;
-    serializeJson(doc, output);
-    request->send(200, "application/json", output);
-}
-
-// ===========================================================================
-// GET /api/v2/palettes - List available palettes
-// ===========================================================================
-void handleApiV2PalettesList(AsyncWebServerRequest* request) {
-    JsonDocument doc;
-    JsonArray palettes = doc["palettes"].to<JsonArray>();
-    
-    // Map palette enum to names
-    const char* paletteNames[] = {
-        "Rainbow", "Lava", "Ocean", "Party", "Forest", "Cloud", "Heat"
-    };
-    
-    for (int i = 0; i < 7; i++) {
-        JsonObject pal = palettes.add<JsonObject>();
-        pal["id"] = i;
-        pal["name"] = paletteNames[i];
-    }
-    
-    String output;
-    serializeJson(doc, output);
-    request->send(200, "application/json", output);
-}
-
 // ===========================================================================
 // GET /api/v2/info - Firmware & capability metadata
 // ===========================================================================
@@ -585,7 +450,7 @@ void handleApiV2Info(AsyncWebServerRequest* request) {
         return;
     }
     
-    JsonDocument doc;
+    JsonDocument doc(JSON_SITE("v2.info"));
     JsonObject firmware = doc["firmware"].to<JsonObject>();
     firmware["name"] = FIRMWARE_NAME;
     firmware["version"] = FIRMWARE_VERSION;
@@ -609,9 +474,7 @@ void handleApiV2Info(AsyncWebServerRequest* request) {
     controllerInfo["ledCount"] = lume::controller.getLedCount();
     controllerInfo["power"] = lume::controller.getPower();
     
-    String output;
-    serializeJson(doc, output);
-    request->send(200, "application/json", output);
+    sendJsonResponse(request, 200, std::move(doc));
 }
 
 // ===========================================================================
@@ -623,43 +486,42 @@ void handleApiV2ControllerGet(AsyncWebServerRequest* request) {
         return;
     }
     
-    JsonDocument doc;
+    JsonDocument doc(JSON_SITE("v2.controller.get"));
     doc["power"] = lume::controller.getPower();
     doc["brightness"] = lume::controller.getBrightness();
     doc["ledCount"] = lume::controller.getLedCount();
     
-    String output;
-    serializeJson(doc, output);
-    request->send(200, "application/json", output);
+    sendJsonResponse(request, 200, std::move(doc));
 }
 
 // ===========================================================================
 // PUT /api/v2/controller - Update controller state
 // ===========================================================================
 void handleApiV2ControllerUpdate(AsyncWebServerRequest* request, uint8_t* data, size_t len, size_t index, size_t total) {
-    if (!checkAuth(request)) {
+    if (index == 0 && !checkAuth(request)) {
         sendUnauthorized(request);
         return;
     }
-    
-    // Validate size at first chunk
-    if (index == 0) {
-        controllerUpdateBuffer = "";
-        if (total > MAX_REQUEST_BODY_SIZE) {
-            sendJsonError(request, 413, "payload_too_large", "Request body exceeds MAX_REQUEST_BODY_SIZE");
-            return;
-        }
+
+    if (index == 0 && !admitWrite(request, WriteEndpoint::Controller, total)) {
+        return;
     }
     
     // Accumulate chunks
-    for (size_t i = 0; i < len; i++) {
-        controllerUpdateBuffer += (char)data[i];
+    BodyStatus body = accumulateBody(request, data, len, index, total);
+    if (body == BodyStatus::TooLarge) {
+        sendJsonError(request, 413, "payload_too_large", "Request body exceeds MAX_REQUEST_BODY_SIZE");
+        return;
+    }
+    if (body == BodyStatus::NoMemory) {
+        sendJsonError(request, 503, "out_of_memory", "Not enough free heap for the request body");
+        return;
     }
     
     // Process when complete
-    if (index + len >= total) {
-        JsonDocument doc;
-        DeserializationError error = deserializeJson(doc, controllerUpdateBuffer);
+    if (body == BodyStatus::Complete) {
+        JsonDocument doc(JSON_SITE("v2.controller.update"));
+        DeserializationError error = parseBody(request, doc);
         
         if (error) {
             sendJsonError(request, 400, "invalid_json", "Unable to parse JSON payload");
@@ -680,13 +542,11 @@ void handleApiV2ControllerUpdate(AsyncWebServerRequest* request, uint8_t* data,
         }
         
         // Return updated state
-        JsonDocument responseDoc;
+        JsonDocument responseDoc(JSON_SITE("v2.controller.update.reply"));
         responseDoc["power"] = lume::controller.getPower();
         responseDoc["brightness"] = lume::controller.getBrightness();
         responseDoc["ledCount"] = lume::controller.getLedCount();
         
-        String output;
-        serializeJson(responseDoc, output);
-        request->send(200, "application/json", output);
+        sendJsonResponse(request, 200, std::move(responseDoc));
     }
 }
@@ -0,0 +1,319 @@
+/**
+ * state.cpp - Bulk state API implementation
+ *
+ * The handler validates the whole document on the AsyncTCP task, queues
+ * the resulting StatePatch for the main loop and answers 202 with a ticket
+ * right away: waiting would hold up every other connection on that task.
+ * The main loop applies queued patches in ticket order between two frames
+ * and records the state version each one produced, which
+ * GET /api/v2/state/patches/{ticket} reports.
+ */
+
+#include "state.h"
+#include "../main.h"
+#include "../constants.h"
+#include "../logging.h"
+#include "../core/json_pool.h"
+#include "json_response.h"
+#include "../storage.h"
+#include "../lume.h"
+#include "../network/state_socket.h"
+#include "param_json.h"
+#include "body.h"
+#include "write_limit.h"
+#include <ArduinoJson.h>
+
+namespace {
+
+enum class PatchState : uint8_t {
+    Free,
+    Filling,    // A handler is validating into it
+    Pending,    // Waiting for the main loop
+    Applying    // Main loop is applying it
+};
+
+struct QueuedPatch {
+    lume::StatePatch patch;
+    uint32_t ticket;
+    volatile PatchState state;
+};
+
+struct PatchResult {
+    uint32_t ticket;
+    uint32_t version;
+};
+
+// Requests only get 503 when every slot is taken, i.e. several arrive
+// within one loop iteration. Slots and results are guarded by patchLock
+QueuedPatch queue[STATE_PATCH_QUEUE];
+uint32_t nextTicket = 1;
+PatchResult results[STATE_PATCH_RESULTS];
+uint8_t nextResult = 0;
+portMUX_TYPE patchLock = portMUX_INITIALIZER_UNLOCKED;
+
+QueuedPatch* reserveSlot() {
+    QueuedPatch* slot = nullptr;
+    portENTER_CRITICAL(&patchLock);
+    for (QueuedPatch& q : queue) {
+        if (q.state == PatchState::Free) {
+            q.state = PatchState::Filling;
+            slot = &q;
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&patchLock);
+    return slot;
+}
+
+// Oldest pending patch, marked Applying
+QueuedPatch* takeOldestPending() {
+    QueuedPatch* oldest = nullptr;
+    portENTER_CRITICAL(&patchLock);
+    for (QueuedPatch& q : queue) {
+        if (q.state == PatchState::Pending &&
+            (!oldest || (int32_t)(q.ticket - oldest->ticket) < 0)) {
+            oldest = &q;
+        }
+    }
+    if (oldest) {
+        oldest->state = PatchState::Applying;
+    }
+    portEXIT_CRITICAL(&patchLock);
+    return oldest;
+}
+
+// Parse one segment entry; returns the offending field, or nullptr
+const char* segmentPatchFromJson(JsonObjectConst obj, lume::SegmentPatch& sp) {
+    int id = obj["id"] | -1;
+    if (id < 0 || id >= lume::MAX_SEGMENTS) return "segments.id";
+    sp.id = id;
+
+    lume::Segment* seg = lume::controller.getSegment(id);
+    if (!obj["start"].isNull() || !obj["length"].isNull() || !obj["reverse"].isNull()) {
+        int start = obj["start"] | (seg ? (int)seg->getStart() : -1);
+        int length = obj["length"] | (seg ? (int)seg->getLength() : 0);
+        if (start < 0 || start >= lume::controller.getLedCount()) return "segments.start";
+        if (length < 1 || length > MAX_LED_COUNT) return "segments.length";
+        sp.setRange = true;
+        sp.start = start;
+        sp.length = length;
+        sp.reversed = obj["reverse"] | (seg ? seg->isReversed() : false);
+    } else if (!seg) {
+        return "segments.start";    // New segments need a range
+    }
+
+    if (!obj["effect"].isNull()) {
+        sp.effect = lume::effects().getInfo(obj["effect"].as<const char*>());
+        if (!sp.effect) return "segments.effect";
+    }
+
+    if (!obj["palette"].isNull()) {
+        int palette = obj["palette"] | -1;
+        if (palette < 0 || palette >= static_cast<int>(lume::PalettePreset::COUNT)) return "segments.palette";
+        sp.setPalette = true;
+        sp.palette = palette;
+    }
+
+    if (!obj["params"].isNull()) {
+        JsonObjectConst params = obj["params"].as<JsonObjectConst>();
+        if (params.isNull()) return "segments.params";
+
+        // Params belong to the effect the segment will have
+        const lume::EffectInfo* effect = sp.effect ? sp.effect : (seg ? seg->getEffect() : nullptr);
+        for (JsonPairConst kv : params) {
+            const lume::ParamDesc* desc = effect && effect->hasSchema() ? effect->schema->find(kv.key().c_str()) : nullptr;
+            if (!desc || sp.paramCount >= lume::MAX_EFFECT_PARAMS) return "segments.params";
+            lume::ParamData& param = sp.params[sp.paramCount++];
+            param.id = desc->id;
+            param.type = desc->type;
+            if (!paramFromJson(*desc, kv.value(), param.value)) return "segments.params";
+        }
+    }
+    return nullptr;
+}
+
+// Parse the whole document; returns the offending field, or nullptr
+const char* statePatchFromJson(JsonObjectConst obj, lume::StatePatch& sp) {
+    sp = lume::StatePatch();
+
+    if (!obj["controller"].isNull()) {
+        JsonObjectConst controllerJson = obj["controller"].as<JsonObjectConst>();
+        if (controllerJson.isNull()) return "controller";
+        if (!controllerJson["power"].isNull()) {
+            if (!controllerJson["power"].is<bool>()) return "controller.power";
+            sp.setPower = true;
+            sp.power = controllerJson["power"].as<bool>();
+        }
+        if (!controllerJson["brightness"].isNull()) {
+            int brightness = controllerJson["brightness"] | -1;
+            if (brightness < 0 || brightness > 255) return "controller.brightness";
+            sp.setBrightness = true;
+            sp.brightness = brightness;
+        }
+    }
+
+    if (!obj["replace"].isNull()) {
+        if (!obj["replace"].is<bool>()) return "replace";
+        sp.replaceSegments = obj["replace"].as<bool>();
+    }
+
+    if (!obj["segments"].isNull()) {
+        JsonArrayConst segments = obj["segments"].as<JsonArrayConst>();
+        if (segments.isNull() || segments.size() > lume::MAX_SEGMENTS) return "segments";
+
+        for (JsonObjectConst segJson : segments) {
+            lume::SegmentPatch& segPatch = sp.segments[sp.segmentCount];
+            const char* badField = segmentPatchFromJson(segJson, segPatch);
+            if (badField) return badField;
+            for (uint8_t i = 0; i < sp.segmentCount; i++) {
+                if (sp.segments[i].id == segPatch.id) return "segments.id";
+            }
+            sp.segmentCount++;
+        }
+    }
+
+    // Segments after the patch: the listed ones plus any others kept
+    uint8_t resulting = sp.segmentCount;
+    if (!sp.replaceSegments) {
+        for (uint8_t id = 0; id < lume::MAX_SEGMENTS; id++) {
+            bool listed = false;
+            for (uint8_t i = 0; i < sp.segmentCount && !listed; i++) {
+                listed = sp.segments[i].id == id;
+            }
+            if (!listed && lume::controller.getSegment(id)) {
+                resulting++;
+            }
+        }
+    }
+    if (resulting > lume::MAX_SEGMENTS) return "segments";
+    return nullptr;
+}
+
+} // anonymous namespace
+
+void handleApiV2StatePatch(AsyncWebServerRequest* request, uint8_t* data, size_t len, size_t index, size_t total) {
+    // Auth check at start of request
+    if (index == 0 && !checkAuth(request)) {
+        sendUnauthorized(request);
+        return;
+    }
+
+    if (index == 0 && !admitWrite(request, WriteEndpoint::State, total)) {
+        return;
+    }
+
+    // Accumulate chunks
+    BodyStatus body = accumulateBody(request, data, len, index, total);
+    if (body == BodyStatus::TooLarge) {
+        sendJsonError(request, 413, "payload_too_large", "Request body exceeds MAX_REQUEST_BODY_SIZE");
+        return;
+    }
+    if (body == BodyStatus::NoMemory) {
+        sendJsonError(request, 503, "out_of_memory", "Not enough free heap for the request body");
+        return;
+    }
+
+    if (body != BodyStatus::Complete) {
+        return;
+    }
+
+    JsonDocument doc(JSON_SITE("v2.state.patch"));
+    DeserializationError error = parseBody(request, doc);
+
+    if (error || !doc.is<JsonObject>()) {
+        sendJsonError(request, 400, "invalid_json", "Unable to parse JSON payload");
+        return;
+    }
+
+    QueuedPatch* slot = reserveSlot();
+    if (!slot) {
+        sendJsonError(request, 503, "busy", "Too many state changes waiting to be applied");
+        return;
+    }
+
+    // Nothing is applied unless the whole document is valid
+    lume::StatePatch& patch = slot->patch;
+    const char* badField = statePatchFromJson(doc.as<JsonObjectConst>(), patch);
+    if (badField) {
+        slot->state = PatchState::Free;
+        sendJsonError(request, 400, "invalid_value", "State field missing or out of range", badField);
+        return;
+    }
+
+    for (uint8_t i = patch.segmentCount; i-- > 0;) {
+        if (patch.segments[i].effect) {
+            storage.saveLastEffect(patch.segments[i].effect->id);
+            break;
+        }
+    }
+
+    // Tickets follow the order patches become ready, which is the order
+    // they are applied in
+    portENTER_CRITICAL(&patchLock);
+    uint32_t ticket = nextTicket++;
+    slot->ticket = ticket;
+    slot->state = PatchState::Pending;
+    portEXIT_CRITICAL(&patchLock);
+
+    char location[48];
+    snprintf(location, sizeof(location), "/api/v2/state/patches/%u", (unsigned)ticket);
+    JsonDocument response(JSON_SITE("v2.state.patch.reply"));
+    response["ticket"] = ticket;
+    AsyncWebServerResponse* reply = beginJsonResponse(202, std::move(response), responseFormat(request));
+    reply->addHeader("Location", location);
+    request->send(reply);
+}
+
+void handleApiV2StatePatchGet(AsyncWebServerRequest* request) {
+    String path = request->url();
+    const char* prefix = "/api/v2/state/patches/";
+    long ticket = path.startsWith(prefix) ? path.substring(strlen(prefix)).toInt() : 0;
+    if (ticket <= 0) {
+        sendJsonError(request, 400, "invalid_value", "Ticket must be a positive number", "ticket");
+        return;
+    }
+
+    bool pending = false;
+    bool applied = false;
+    uint32_t version = 0;
+    portENTER_CRITICAL(&patchLock);
+    for (const QueuedPatch& q : queue) {
+        if (q.state != PatchState::Free && q.state != PatchState::Filling && q.ticket == (uint32_t)ticket) {
+            pending = true;
+        }
+    }
+    for (const PatchResult& r : results) {
+        if (r.ticket == (uint32_t)ticket) {
+            applied = true;
+            version = r.version;
+        }
+    }
+    portEXIT_CRITICAL(&patchLock);
+
+    if (!pending && !applied) {
+        sendJsonError(request, 404, "unknown_ticket", "Ticket not issued, or too old to be remembered", "ticket");
+        return;
+    }
+
+    JsonDocument doc(JSON_SITE("v2.state.patch.status"));
+    doc["ticket"] = ticket;
+    doc["status"] = applied ? "applied" : "pending";
+    if (applied) {
+        doc["version"] = version;
+    }
+    sendJsonResponse(request, 200, std::move(doc));
+}
+
+void applyPendingStatePatch() {
+    QueuedPatch* q;
+    while ((q = takeOldestPending()) != nullptr) {
+        lume::controller.applyStatePatch(q->patch);
+        uint32_t version = refreshStateVersion();
+
+        portENTER_CRITICAL(&patchLock);
+        results[nextResult] = {q->ticket, version};
+        nextResult = (nextResult + 1) % STATE_PATCH_RESULTS;
+        q->state = PatchState::Free;
+        portEXIT_CRITICAL(&patchLock);
+    }
+}
@@ -0,0 +1,20 @@
+/**
+ * state.h - Bulk state API (PATCH /api/v2/state, GET /api/v2/state/patches/{ticket})
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Forward declaration
+class AsyncWebServerRequest;
+
+// PATCH /api/v2/state - validate and apply controller and segment changes in one frame
+void handleApiV2StatePatch(AsyncWebServerRequest* request, uint8_t* data, size_t len, size_t index, size_t total);
+
+// GET /api/v2/state/patches/{ticket} - whether a patch was applied, and the state version it produced
+void handleApiV2StatePatchGet(AsyncWebServerRequest* request);
+
+// Apply the patches waiting for the main loop, oldest first (call from main loop)
+void applyPendingStatePatch();
@@ -1,9 +1,16 @@
 #include "status.h"
 #include "../constants.h"
 #include "../logging.h"
+#include "../core/json_pool.h"
+#include "json_response.h"
 #include "../storage.h"
 #include "../lume.h"
 #include "../protocols/sacn.h"
+#include "../protocols/sacn_sender.h"
+#include "../protocols/clock_sync.h"
+#include "../network/preview.h"
+#include "../network/web_assets.h"
+#include "write_limit.h"
 #include "../protocols/mqtt.h"
 #include <LittleFS.h>
 #include <WiFi.h>
@@ -13,7 +20,45 @@ extern Config config;
 extern bool wifiConnected;
 extern bool webUiAvailable;
 
+namespace {
+
+void countersToJson(const lume::SacnCounters& c, JsonObject obj) {
+    obj["received"] = c.received;
+    obj["outOfOrder"] = c.outOfOrder;
+    obj["lost"] = c.lost;
+    obj["preview"] = c.preview;
+    obj["terminated"] = c.terminated;
+}
+
+void histogramToJson(const lume::Histogram& h, JsonObject obj) {
+    obj["count"] = h.count;
+    obj["min"] = h.minValue;
+    obj["mean"] = h.mean();
+    obj["p50"] = h.percentile(50);
+    obj["p95"] = h.percentile(95);
+    obj["p99"] = h.percentile(99);
+    obj["max"] = h.maxValue;
+    
+    // Sparse log2 buckets: {"le": upper bound in us, "n": count}
+    JsonArray buckets = obj["buckets"].to<JsonArray>();
+    for (uint8_t i = 0; i < lume::Histogram::BUCKETS; i++) {
+        if (h.buckets[i] == 0) continue;
+        JsonObject b = buckets.add<JsonObject>();
+        if (i + 1 < lume::Histogram::BUCKETS) {
+            b["le"] = lume::Histogram::upperBound(i);
+        } else {
+            b["le"] = "inf";
+        }
+        b["n"] = h.buckets[i];
+    }
+}
+
+} // anonymous namespace
+
 void handleRoot(AsyncWebServerRequest* request) {
+    if (serveWebAsset(request, "/index.html")) {
+        return;
+    }
     if (webUiAvailable && LittleFS.exists("/index.html")) {
         request->send(LittleFS, "/index.html", "text/html; charset=utf-8");
         return;
@@ -22,7 +67,7 @@ void handleRoot(AsyncWebServerRequest* request) {
 }
 
 void handleApiStatus(AsyncWebServerRequest* request) {
-    JsonDocument doc;
+    JsonDocument doc(JSON_SITE("api.status"));
     
     doc["uptime"] = millis() / 1000;
     doc["wifi"] = wifiConnected ? "Connected" : "AP Mode";
@@ -31,6 +76,25 @@ void handleApiStatus(AsyncWebServerRequest* request) {
     doc["ledCount"] = lume::controller.getLedCount();
     doc["power"] = lume::controller.getPower();
     
+    // Protocol output timing
+    JsonObject output = doc["output"].to<JsonObject>();
+    output["showOnArrival"] = lume::controller.getShowOnArrival();
+    output["minShowIntervalUs"] = lume::controller.getMinShowIntervalUs();
+    histogramToJson(lume::controller.getLatchLatency(), output["latchLatencyUs"].to<JsonObject>());
+    
+    const lume::JitterBuffer& jitter = lume::controller.getJitterBuffer();
+    JsonObject jb = output["jitterBuffer"].to<JsonObject>();
+    jb["enabled"] = jitter.isEnabled();
+    if (jitter.isEnabled()) {
+        jb["delayMs"] = jitter.getDelayMs();
+        jb["interpolate"] = jitter.getInterpolate();
+        jb["depth"] = jitter.getDepth();
+        jb["cadenceUs"] = jitter.getCadenceUs();
+        jb["underruns"] = jitter.getUnderruns();
+        jb["overruns"] = jitter.getOverruns();
+        jb["resyncs"] = jitter.getResyncs();
+    }
+    
     // sACN status (using new protocol system)
     JsonObject sacn = doc["sacn"].to<JsonObject>();
     sacn["enabled"] = config.sacnEnabled;
@@ -38,6 +102,9 @@ void handleApiStatus(AsyncWebServerRequest* request) {
     sacn["universeCount"] = config.sacnUniverseCount;
     sacn["startChannel"] = config.sacnStartChannel;
     sacn["unicast"] = config.sacnUnicast;
+    sacn["mergeMode"] = lume::sacnMergeModeToString(lume::sacnProtocol.getMergeMode());
+    sacn["syncAddress"] = lume::sacnProtocol.getSyncAddress();
+    sacn["syncPackets"] = lume::sacnProtocol.getSyncPacketCount();
     sacn["receiving"] = lume::sacnProtocol.isActive();
     sacn["packets"] = lume::sacnProtocol.getPacketCount();
     sacn["source"] = lume::sacnProtocol.getActiveSourceName();
@@ -46,13 +113,101 @@ void handleApiStatus(AsyncWebServerRequest* request) {
         sacn["lastPacketMs"] = millis() - lume::sacnProtocol.getLastPacketTime();
     }
     
+    // Per-universe reception statistics (times in microseconds)
+    JsonArray universes = sacn["universes"].to<JsonArray>();
+    for (uint8_t i = 0; i < lume::sacnProtocol.getUniverseCount(); i++) {
+        const lume::SacnUniverse& uni = lume::sacnProtocol.getUniverse(i);
+        JsonObject u = universes.add<JsonObject>();
+        u["universe"] = uni.universe;
+        u["priority"] = uni.activePriority;
+        
+        // Sources whose data is on the universe now (several when HTP-merging)
+        JsonArray owners = u["owners"].to<JsonArray>();
+        for (uint8_t s = 0; s < lume::SACN_MAX_SOURCES; s++) {
+            if (uni.ownerMask & (1 << s)) {
+                owners.add(lume::sacnProtocol.getSource(s).name);
+            }
+        }
+        
+        u["accepted"] = uni.packetCount;
+        countersToJson(uni.stats, u);
+        u["jitterUs"] = uni.jitterUs;
+        histogramToJson(uni.interArrival, u["interArrivalUs"].to<JsonObject>());
+        histogramToJson(uni.showLatency, u["showLatencyUs"].to<JsonObject>());
+    }
+    
+    JsonArray sources = sacn["sources"].to<JsonArray>();
+    for (uint8_t i = 0; i < lume::SACN_MAX_SOURCES; i++) {
+        const lume::SacnSource& src = lume::sacnProtocol.getSource(i);
+        if (!src.active) continue;
+        JsonObject o = sources.add<JsonObject>();
+        o["name"] = src.name;
+        o["priority"] = src.priority;
+        JsonArray srcUniverses = o["universes"].to<JsonArray>();
+        for (uint8_t u = 0; u < lume::sacnProtocol.getUniverseCount(); u++) {
+            if (src.universeMask & (1 << u)) {
+                srcUniverses.add(lume::sacnProtocol.getUniverse(u).universe);
+            }
+        }
+        o["lastSeenMs"] = millis() - src.lastSeen;
+        countersToJson(src.stats, o);
+    }
+    
+    // sACN output status
+    JsonObject sacnOut = doc["sacnOutput"].to<JsonObject>();
+    sacnOut["enabled"] = config.sacnOutEnabled;
+    sacnOut["running"] = lume::sacnSender.isRunning();
+    sacnOut["universe"] = config.sacnOutUniverse;
+    sacnOut["universeCount"] = lume::sacnSender.getUniverseCount();
+    sacnOut["destination"] = config.sacnOutDestination.length() > 0 ? config.sacnOutDestination : "multicast";
+    sacnOut["priority"] = config.sacnOutPriority;
+    sacnOut["syncUniverse"] = config.sacnOutSync;
+    sacnOut["framesSent"] = lume::sacnSender.getFramesSent();
+    sacnOut["packetsSent"] = lume::sacnSender.getPacketsSent();
+    sacnOut["sendErrors"] = lume::sacnSender.getSendErrors();
+    
+    // Shared clock status
+    JsonObject clock = doc["clockSync"].to<JsonObject>();
+    clock["role"] = lume::clockSyncRoleToString(lume::clockSync.getRole());
+    clock["locked"] = lume::clockSync.isLocked();
+    clock["lockstep"] = lume::controller.getLockstep();
+    clock["nowUs"] = lume::clockSync.now();
+    if (lume::clockSync.getRole() == lume::ClockSyncRole::Client) {
+        clock["master"] = lume::clockSync.getMasterIP().toString();
+        clock["offsetUs"] = lume::clockSync.getOffsetUs();
+        clock["driftPpb"] = lume::clockSync.getDriftPpb();
+        clock["roundTripUs"] = lume::clockSync.getRoundTripUs();
+        clock["samples"] = lume::clockSync.getSamples();
+        clock["steps"] = lume::clockSync.getSteps();
+        clock["lastSyncMs"] = lume::clockSync.isLocked() ? millis() - lume::clockSync.getLastSyncMs() : 0;
+    } else if (lume::clockSync.getRole() == lume::ClockSyncRole::Master) {
+        clock["requestsServed"] = lume::clockSync.getRequestsServed();
+    }
+    
+    // Live preview stream
+    JsonObject previewJson = doc["preview"].to<JsonObject>();
+    previewJson["clients"] = lume::preview.getClientCount();
+    previewJson["framesSent"] = lume::preview.getFramesSent();
+    previewJson["framesDropped"] = lume::preview.getFramesDropped();
+    previewJson["bytesSent"] = lume::preview.getBytesSent();
+
+    // Web UI files in the firmware, and how many LittleFS replaces
+    JsonObject ui = doc["ui"].to<JsonObject>();
+    ui["embedded"] = getWebAssetCount();
+    ui["overridden"] = getWebAssetOverrideCount();
+
+    // Write requests admitted and refused (429), per endpoint
+    writeLimitsToJson(doc["writes"].to<JsonObject>());
+    
     // MQTT status
     JsonObject mqtt = doc["mqtt"].to<JsonObject>();
     mqtt["enabled"] = config.mqttEnabled;
     mqtt["broker"] = config.mqttBroker;
     mqtt["connected"] = lume::mqtt.isConnected();
+    mqtt["reconnects"] = lume::mqtt.getReconnectCount();
+    mqtt["retryDelayMs"] = lume::mqtt.getRetryDelay();
+    mqtt["outboxDropped"] = lume::mqtt.getOutboxDropped();
+    mqtt["groups"] = lume::mqtt.getGroupCount();
     
-    String response;
-    serializeJson(doc, response);
-    request->send(200, "application/json", response);
+    sendJsonResponse(request, 200, std::move(doc));
 }
@@ -0,0 +1,143 @@
+/**
+ * write_limit.cpp - Admission control implementation
+ *
+ * Everything here runs on the AsyncTCP task (web handlers), so the tables
+ * need no locking.
+ */
+
+#include "write_limit.h"
+#include "../constants.h"
+#include "../logging.h"
+#include "../lume.h"
+#include <ESPAsyncWebServer.h>
+
+namespace {
+
+struct EndpointLimit {
+    const char* name;
+    uint16_t ratePerSec;    // Sustained requests per client
+    uint16_t burst;         // Requests a client may make back to back
+};
+
+const EndpointLimit LIMITS[static_cast<uint8_t>(WriteEndpoint::COUNT)] = {
+    {"pixels",     60, 30},
+    {"segments",   20, 20},
+    {"controller", 20, 20},
+    {"state",       5,  5},
+    {"config",      2,  4},
+    {"other",       5,  5},
+};
+
+struct EndpointCounters {
+    uint32_t admitted;
+    uint32_t rate;      // Client over its rate
+    uint32_t queue;     // Command queue nearly full
+    uint32_t heap;      // Not enough heap
+};
+
+EndpointCounters counters[static_cast<uint8_t>(WriteEndpoint::COUNT)] = {};
+
+// Token bucket per client and endpoint; least recently used is replaced
+struct ClientBucket {
+    uint32_t ip;
+    WriteEndpoint endpoint;
+    uint32_t milliTokens;
+    uint32_t lastMs;
+};
+
+ClientBucket buckets[WRITE_LIMIT_CLIENTS] = {};
+
+ClientBucket& bucketFor(uint32_t ip, WriteEndpoint endpoint, uint32_t now) {
+    for (ClientBucket& b : buckets) {
+        if (b.lastMs != 0 && b.ip == ip && b.endpoint == endpoint) {
+            return b;
+        }
+    }
+
+    ClientBucket* slot = &buckets[0];
+    for (ClientBucket& b : buckets) {
+        if (b.lastMs == 0) {
+            slot = &b;
+            break;
+        }
+        if (now - b.lastMs > now - slot->lastMs) {
+            slot = &b;
+        }
+    }
+    // New client (or one not seen for a while) starts with a full burst
+    slot->ip = ip;
+    slot->endpoint = endpoint;
+    slot->milliTokens = LIMITS[static_cast<uint8_t>(endpoint)].burst * 1000;
+    slot->lastMs = now;
+    return *slot;
+}
+
+// Take one request from the client's bucket; 0 if allowed, else seconds to wait
+uint32_t takeToken(uint32_t ip, WriteEndpoint endpoint) {
+    const EndpointLimit& limit = LIMITS[static_cast<uint8_t>(endpoint)];
+    uint32_t now = millis() | 1;    // lastMs 0 marks a free slot
+    ClientBucket& b = bucketFor(ip, endpoint, now);
+
+    // Tokens per second = milli-tokens per millisecond
+    uint32_t refill = min(now - b.lastMs, (uint32_t)60000) * limit.ratePerSec;
+    b.milliTokens = min(b.milliTokens + refill, (uint32_t)limit.burst * 1000);
+    b.lastMs = now;
+
+    if (b.milliTokens >= 1000) {
+        b.milliTokens -= 1000;
+        return 0;
+    }
+    uint32_t waitMs = (1000 - b.milliTokens) / limit.ratePerSec + 1;
+    return (waitMs + 999) / 1000;
+}
+
+void refuse(AsyncWebServerRequest* request, const char* reason, uint32_t retryAfter) {
+    char body[96];
+    snprintf(body, sizeof(body), "{\"error\":\"too_many_requests\",\"reason\":\"%s\",\"retryAfter\":%lu}",
+             reason, (unsigned long)retryAfter);
+    AsyncWebServerResponse* response = request->beginResponse(429, "application/json", body);
+    response->addHeader("Retry-After", String(retryAfter));
+    request->send(response);
+}
+
+} // anonymous namespace
+
+bool admitWrite(AsyncWebServerRequest* request, WriteEndpoint endpoint, size_t bodySize) {
+    EndpointCounters& c = counters[static_cast<uint8_t>(endpoint)];
+
+    // Device-wide pressure first: no client's tokens are spent on these
+    if (ESP.getFreeHeap() < WRITE_MIN_FREE_HEAP ||
+        ESP.getMaxAllocHeap() < bodySize + WRITE_MIN_FREE_BLOCK) {
+        c.heap++;
+        refuse(request, "low_memory", 2);
+        return false;
+    }
+    if (lume::controller.getCommandQueueSpace() < WRITE_MIN_QUEUE_SPACE) {
+        c.queue++;
+        refuse(request, "busy", 1);
+        return false;
+    }
+
+    uint32_t retryAfter = takeToken((uint32_t)request->client()->remoteIP(), endpoint);
+    if (retryAfter > 0) {
+        if (c.rate++ % 100 == 0) {
+            LOG_WARN(LogTag::WEB, "Rate limiting %s writes from %s",
+                     LIMITS[static_cast<uint8_t>(endpoint)].name, request->client()->remoteIP().toString().c_str());
+        }
+        refuse(request, "rate", retryAfter);
+        return false;
+    }
+
+    c.admitted++;
+    return true;
+}
+
+void writeLimitsToJson(JsonObject obj) {
+    for (uint8_t i = 0; i < static_cast<uint8_t>(WriteEndpoint::COUNT); i++) {
+        JsonObject e = obj[LIMITS[i].name].to<JsonObject>();
+        e["admitted"] = counters[i].admitted;
+        e["rateLimited"] = counters[i].rate;
+        e["queueFull"] = counters[i].queue;
+        e["lowMemory"] = counters[i].heap;
+    }
+}
@@ -0,0 +1,38 @@
+/**
+ * write_limit.h - Admission control for write endpoints
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <ArduinoJson.h>
+
+// Forward declaration
+class AsyncWebServerRequest;
+
+// Write endpoints, each with its own per-client rate and counters
+enum class WriteEndpoint : uint8_t {
+    Pixels,         // POST /api/pixels
+    Segments,       // POST/PUT/DELETE /api/v2/segments
+    Controller,     // PUT /api/v2/controller
+    State,          // PATCH /api/v2/state
+    Config,         // POST /api/config
+    Other,          // Nightlight, protocols, cluster, prompt
+    COUNT
+};
+
+/**
+ * Decide whether to take a write request, before its body is read
+ *
+ * Call on the first body chunk, after the auth check. Refuses the request
+ * when the device is short on heap (including a block for `bodySize`),
+ * when the controller's command queue is nearly full, or when the client
+ * (by IP) is over the endpoint's rate. Refused requests are answered with
+ * 429 and Retry-After here; the handler just returns, and its later chunks
+ * come back from accumulateBody() as Rejected.
+ */
+bool admitWrite(AsyncWebServerRequest* request, WriteEndpoint endpoint, size_t bodySize = 0);
+
+// Per-endpoint admitted/refused counters (for /api/status)
+void writeLimitsToJson(JsonObject obj);
@@ -25,6 +25,10 @@
 constexpr uint16_t MAX_LED_COUNT            = 1000;
 constexpr uint16_t LEDS_PER_UNIVERSE        = 170;   // 512 DMX channels ÷ 3 bytes/LED
 
+// Strip Timing (WS2812B: 24 bits at 800 kHz, then >280 us low to latch)
+constexpr uint16_t LED_US_PER_PIXEL         = 30;
+constexpr uint16_t LED_LATCH_US             = 300;
+
 // Power Management
 constexpr uint8_t  LED_VOLTAGE              = 5;     // LED strip voltage
 constexpr uint16_t LED_MAX_MILLIAMPS        = 2000;  // Max current (adjust for PSU)
@@ -38,6 +42,10 @@ constexpr uint16_t WEB_SERVER_PORT          = 80;
 constexpr uint16_t OTA_PORT                 = 3232;
 constexpr uint16_t SACN_PORT                = 5568;
 
+// LittleFS files replace the built-in UI only while this file exists, so a
+// copy left over from an old uploadfs can't shadow newer firmware
+#define WEB_UI_OVERRIDE_MARKER "/ui-override"
+
 // mDNS Hostname (Access via http://lume.local)
 #define MDNS_HOSTNAME "lume"
 
@@ -55,11 +63,29 @@ constexpr uint32_t HTTP_CLIENT_TIMEOUT_MS   = 30000;
 constexpr size_t MAX_REQUEST_BODY_SIZE      = 16384;  // 16KB max POST body
 constexpr size_t MAX_JSON_STATE_SIZE        = 4000;   // NVS storage limit
 constexpr size_t SYSTEM_PROMPT_BUFFER_SIZE  = 2048;
+constexpr size_t JSON_ARENA_SIZE            = 8192;   // Per-task JsonDocument arena
+constexpr size_t JSON_ARENA_COUNT           = 3;      // Tasks with an arena (web, loop, mqtt)
+
+// Write request admission (see api/write_limit.h)
+constexpr uint32_t WRITE_MIN_FREE_HEAP      = 24576;  // Refuse writes below this free heap
+constexpr uint32_t WRITE_MIN_FREE_BLOCK     = 8192;   // Largest block needed beyond the body
+constexpr size_t   WRITE_MIN_QUEUE_SPACE    = 4;      // Free command queue slots needed
+constexpr uint8_t  WRITE_LIMIT_CLIENTS      = 16;     // Rate-tracked client/endpoint pairs
+constexpr uint32_t PIXEL_UPLOAD_TIMEOUT_MS  = 2000;   // Stalled raw pixel upload loses the buffer
+constexpr uint8_t  STATE_PATCH_QUEUE        = 3;      // State patches waiting for the main loop (~1.2KB each)
+constexpr uint8_t  STATE_PATCH_RESULTS      = 8;      // Applied state patch tickets kept for polling
+
+// Dynamic response compression (see api/json_response.h)
+constexpr size_t   GZIP_MIN_RESPONSE_SIZE   = 1460;   // One TCP segment: smaller gains nothing
+constexpr uint32_t GZIP_MIN_FREE_HEAP       = 40960;  // Send uncompressed below this free heap
 
 // Task Configuration
 constexpr size_t   ANTHROPIC_TASK_STACK_SIZE = 16384;
 constexpr uint8_t  ANTHROPIC_TASK_PRIORITY   = 1;
 constexpr uint8_t  ANTHROPIC_TASK_CORE       = 0;
+constexpr size_t   MQTT_TASK_STACK_SIZE      = 6144;
+constexpr uint8_t  MQTT_TASK_PRIORITY        = 1;
+constexpr uint8_t  MQTT_TASK_CORE            = 0;      // Off the render loop's core
 
 // System Timing
 constexpr uint32_t WATCHDOG_TIMEOUT_SEC     = 30;     // Auto-reset timeout
@@ -75,6 +101,9 @@ constexpr uint16_t NIGHTLIGHT_MAX_DURATION      = 3600;  // Maximum (1 hour)
 constexpr uint16_t NIGHTLIGHT_DEFAULT_DURATION  = 900;   // Default (15 min)
 constexpr uint8_t  NIGHTLIGHT_DEFAULT_TARGET    = 0;     // Target brightness (off)
 
+// Wall clock (SNTP), for MQTT group commands scheduled by Unix time
+#define NTP_SERVER "pool.ntp.org"
+
 // ═══════════════════════════════════════════════════════════════════════════
 // FIRMWARE METADATA
 // ═══════════════════════════════════════════════════════════════════════════
@@ -25,6 +25,7 @@ enum class CommandType : uint8_t {
     SetIntensity,       // Set effect intensity
     SetColor,           // Set primary/secondary color
     SetPalette,         // Set palette preset
+    SetParam,           // Set one schema param of the segment's effect
     
     // Segment management
     CreateSegment,      // Create new segment
@@ -33,6 +34,7 @@ enum class CommandType : uint8_t {
     // Global control
     SetPower,           // Power on/off
     SetGlobalBrightness,// Global brightness
+    Transition,         // Fade to a power/brightness state over time
     
     // Advanced
     ApplyEffectSpec,    // Apply AI-generated effect spec
@@ -59,6 +61,27 @@ struct SegmentData {
     bool reversed;
 };
 
+/**
+ * Schema param value for commands
+ *
+ * Applied only if the segment's effect still has a param with this id and
+ * type when the command runs (the effect may change in between).
+ */
+struct ParamData {
+    const char* id;             // ParamDesc::id of the effect's schema (static)
+    ParamType type;
+    ParamValues::Slot value;
+};
+
+/**
+ * Power/brightness transition for commands
+ */
+struct TransitionData {
+    bool power;             // State at the end of the fade
+    int16_t brightness;     // Target brightness, -1 = keep the current target
+    uint16_t durationMs;
+};
+
 /**
  * Command - Discriminated union for state mutations
  * 
@@ -82,9 +105,15 @@ struct Command {
         // CreateSegment
         SegmentData segment;
         
+        // SetParam
+        ParamData param;
+        
         // SetPower
         bool power;
         
+        // Transition
+        TransitionData transition;
+        
         // Generic 32-bit value
         uint32_t value32;
     } data;
@@ -138,6 +167,14 @@ struct Command {
         return cmd;
     }
     
+    static Command setParam(uint8_t segId, const ParamDesc& desc, ParamValues::Slot value) {
+        Command cmd;
+        cmd.type = CommandType::SetParam;
+        cmd.segmentId = segId;
+        cmd.data.param = {desc.id, desc.type, value};
+        return cmd;
+    }
+    
     static Command setPower(bool on) {
         Command cmd;
         cmd.type = CommandType::SetPower;
@@ -154,6 +191,14 @@ struct Command {
         return cmd;
     }
     
+    static Command transition(bool power, int16_t brightness, uint16_t durationMs) {
+        Command cmd;
+        cmd.type = CommandType::Transition;
+        cmd.segmentId = 255;  // Global
+        cmd.data.transition = {power, brightness, durationMs};
+        return cmd;
+    }
+    
     static Command createSegment(uint16_t start, uint16_t length, bool reversed = false) {
         Command cmd;
         cmd.type = CommandType::CreateSegment;
@@ -5,6 +5,7 @@
 #include "controller.h"
 #include "../protocols/protocol.h"
 #include "../logging.h"
+#include <esp_timer.h>
 
 namespace lume {
 
@@ -22,18 +23,36 @@ LumeController::LumeController()
     , nightlightDuration(0)
     , nightlightStartBrightness(0)
     , nightlightTargetBrightness(0)
-    , protocolCount_(0)
-    , protocolActive_(false)
-    , activeProtocol_(nullptr)
+    , transitionActive_(false)
+    , transitionPowerOff_(false)
+    , transitionStartMs_(0)
+    , transitionMs_(0)
+    , transitionFrom_(0)
+    , transitionTo_(0)
+    , transitionRestore_(0)
+    , protocolFrameFresh_(false)
+    , showOnArrival_(false)
+    , frameArrivalUs_(0)
+    , lastShowUs_(0)
+    , pendingShowOnArrival_(false)
+    , pendingJitterMs_(0)
+    , pendingInterpolate_(false)
+    , protocolOutputPending_(false)
     , targetFps(DEFAULT_FPS)
     , frameCounter(0)
     , lastFrameTime(0)
     , actualFps(0)
     , fpsUpdateTime(0)
-    , fpsFrameCount(0) {
+    , fpsFrameCount(0)
+    , commandPasses_(0)
+    , timeSource_(nullptr)
+    , lockstep_(false)
+    , lockstepFrame_(0)
+    , effectMs_(0) {
     
     memset(leds, 0, sizeof(leds));
-    memset(protocols_, 0, sizeof(protocols_));
+    arbiter_.attachOutput(leds);
+    latchLatency_.reset();
 }
 
 void LumeController::begin(uint16_t count) {
@@ -73,11 +92,39 @@ void LumeController::setLedCount(uint16_t count) {
 }
 
 void LumeController::update() {
+    if (protocolOutputPending_) {
+        applyProtocolOutput();
+    }
+    
+    // Drain protocol sockets every call, not just on frame boundaries,
+    // so packet arrival timestamps aren't quantized to the frame interval
+    pollProtocols();
+    
+    if (power) {
+        if (jitter_.isEnabled()) {
+            bufferArrivedFrame();
+        } else if (showOnArrival_) {
+            showArrivedFrame();
+        }
+    }
+    
     // Frame rate limiting
     uint32_t now = millis();
     uint32_t frameInterval = 1000 / targetFps;
     
-    if (now - lastFrameTime < frameInterval) {
+    if (lockstep_) {
+        // Frame boundaries come from the shared clock, so every node
+        // starts frame N at the same moment regardless of when it booted
+        int64_t intervalUs = 1000000 / targetFps;
+        int64_t frame = (timeSource_ ? timeSource_() : esp_timer_get_time()) / intervalUs;
+        int32_t ahead = (int32_t)((uint32_t)frame - lockstepFrame_);
+        // A slewed clock can step back a little: hold rather than replay
+        if (ahead == 0 || (ahead < 0 && ahead > -(int32_t)targetFps)) {
+            return;
+        }
+        lockstepFrame_ = (uint32_t)frame;
+        effectMs_ = (uint32_t)(frame * intervalUs / 1000);
+    } else if (now - lastFrameTime < frameInterval) {
         return;  // Not time for next frame yet
     }
     lastFrameTime = now;
@@ -114,6 +161,10 @@ void LumeController::update() {
         }
     }
     
+    if (transitionActive_) {
+        updateTransition(now);
+    }
+    
     // Clear or handle power off
     if (!power) {
         FastLED.clear();
@@ -124,10 +175,18 @@ void LumeController::update() {
     // Check protocols for incoming data
     processProtocols();
     
-    // If a protocol is active, it has already written to LEDs - just show
-    if (protocolActive_) {
-        FastLED.show();
-        frameCounter++;
+    // If a protocol is active, it has already written to LEDs - just show.
+    // With show-on-arrival, frames were latched as they came in; only refresh
+    // here if nothing arrived for a whole interval (brightness, nightlight).
+    if (isProtocolActive()) {
+        if (jitter_.isEnabled()) {
+            // Steady playout: a new (possibly interpolated) frame every tick
+            jitter_.render(leds, ledCount, micros());
+            showProtocolFrame();
+        } else if (!showOnArrival_ || protocolFrameFresh_ || arbiter_.isFading() ||
+            micros() - lastShowUs_ >= frameInterval * 1000) {
+            showProtocolFrame();
+        }
         return;
     }
     
@@ -138,7 +197,13 @@ void LumeController::update() {
     // Update all active segments
     for (uint8_t i = 0; i < segmentCount; i++) {
         if (segments[i].isActive()) {
-            segments[i].update(frameCounter);
+            if (lockstep_) {
+                // Same random sequence on every node for this frame and segment
+                random16_set_seed((uint16_t)((lockstepFrame_ * 2654435761u) >> 16) ^ segments[i].getId());
+                segments[i].update(lockstepFrame_);
+            } else {
+                segments[i].update(frameCounter);
+            }
             
             // Handle blending if not Replace mode
             if (segments[i].getBlendMode() != BlendMode::Replace) {
@@ -147,6 +212,9 @@ void LumeController::update() {
         }
     }
     
+    // Handing back from a protocol: fade its last frame out over effects
+    arbiter_.applyFade(leds, ledCount, now);
+    
     // Show the result
     FastLED.show();
     frameCounter++;
@@ -154,6 +222,7 @@ void LumeController::update() {
 
 void LumeController::processCommands() {
     Command cmd;
+    commandPasses_ = commandPasses_ + 1;
     // Process all pending commands this frame
     while (commandQueue.dequeue(cmd)) {
         executeCommand(cmd);
@@ -214,6 +283,12 @@ void LumeController::executeCommand(const Command& cmd) {
             }
             break;
             
+        case CommandType::SetParam:
+            if (seg) {
+                applyParam(seg, cmd.data.param);
+            }
+            break;
+            
         case CommandType::CreateSegment:
             createSegment(cmd.data.segment.start, cmd.data.segment.length, cmd.data.segment.reversed);
             break;
@@ -231,6 +306,11 @@ void LumeController::executeCommand(const Command& cmd) {
             setBrightness(cmd.data.value8);
             break;
             
+        case CommandType::Transition:
+            startTransition(cmd.data.transition.power, cmd.data.transition.brightness,
+                            cmd.data.transition.durationMs);
+            break;
+            
         case CommandType::ApplyEffectSpec:
         case CommandType::SaveScene:
         case CommandType::LoadScene:
@@ -244,21 +324,62 @@ void LumeController::show() {
     FastLED.show();
 }
 
-Segment* LumeController::createSegment(uint16_t start, uint16_t length, bool reversed) {
-    if (segmentCount >= MAX_SEGMENTS) {
-        return nullptr;
+void LumeController::applyParam(Segment* seg, const ParamData& param) {
+    const EffectInfo* info = seg->getEffect();
+    int8_t slot = info && info->hasSchema() ? info->schema->indexOf(param.id) : -1;
+    if (slot >= 0 && slot < MAX_EFFECT_PARAMS && info->schema->params[slot].type == param.type) {
+        seg->getParamValues().slots[slot] = param.value;
     }
-    
-    // Bounds check
-    if (start >= ledCount) {
-        return nullptr;
+}
+
+void LumeController::applyStatePatch(const StatePatch& patch) {
+    if (patch.replaceSegments) {
+        for (uint8_t i = segmentCount; i-- > 0;) {
+            uint8_t id = segments[i].getId();
+            bool listed = false;
+            for (uint8_t j = 0; j < patch.segmentCount && !listed; j++) {
+                listed = patch.segments[j].id == id;
+            }
+            if (!listed) {
+                removeSegment(id);
+            }
+        }
     }
     
-    uint16_t actualLength = min(length, (uint16_t)(ledCount - start));
-    if (actualLength == 0) {
-        return nullptr;
+    for (uint8_t i = 0; i < patch.segmentCount; i++) {
+        const SegmentPatch& sp = patch.segments[i];
+        Segment* seg = getSegment(sp.id);
+        if (sp.setRange) {
+            if (!seg) {
+                seg = createSegment(sp.start, sp.length, sp.reversed, sp.id);
+            } else if (sp.start < ledCount) {
+                seg->setRange(leds, sp.start, min(sp.length, (uint16_t)(ledCount - sp.start)), sp.reversed);
+            }
+        }
+        if (!seg) {
+            continue;   // Removed or out of range since the patch was checked
+        }
+        if (sp.effect) {
+            seg->setEffect(sp.effect);
+        }
+        if (sp.setPalette) {
+            seg->setPalette(static_cast<PalettePreset>(sp.palette));
+        }
+        for (uint8_t p = 0; p < sp.paramCount; p++) {
+            applyParam(seg, sp.params[p]);
+        }
     }
     
+    if (patch.setBrightness) {
+        setBrightness(patch.brightness);
+    }
+    if (patch.setPower) {
+        setPower(patch.power);
+    }
+    LOG_INFO(LogTag::LED, "Applied state patch (%d segments)", patch.segmentCount);
+}
+
+Segment* LumeController::createSegment(uint16_t start, uint16_t length, bool reversed) {
     // Find lowest available ID (reuse deleted IDs)
     bool usedIds[MAX_SEGMENTS] = {false};
     for (uint8_t i = 0; i < segmentCount; i++) {
@@ -276,6 +397,24 @@ Segment* LumeController::createSegment(uint16_t start, uint16_t length, bool rev
         }
     }
     
+    return createSegment(start, length, reversed, newId);
+}
+
+Segment* LumeController::createSegment(uint16_t start, uint16_t length, bool reversed, uint8_t newId) {
+    if (segmentCount >= MAX_SEGMENTS || newId >= MAX_SEGMENTS || getSegment(newId)) {
+        return nullptr;
+    }
+    
+    // Bounds check
+    if (start >= ledCount) {
+        return nullptr;
+    }
+    
+    uint16_t actualLength = min(length, (uint16_t)(ledCount - start));
+    if (actualLength == 0) {
+        return nullptr;
+    }
+    
     // Add segment to next available slot
     Segment* seg = &segments[segmentCount];
     seg->setRange(leds, start, actualLength, reversed);
@@ -351,61 +490,185 @@ void LumeController::blendSegment(Segment& seg) {
 
 // --- Protocol management ---
 
-void LumeController::registerProtocol(IProtocol* protocol) {
+void LumeController::registerProtocol(IProtocol* protocol, const ProtocolPolicy& policy) {
     if (!protocol) return;
     
-    if (protocolCount_ >= MAX_PROTOCOLS) {
+    if (!arbiter_.add(protocol, policy)) {
         LOG_WARN(LogTag::LED, "Max protocols reached, cannot register %s", protocol->name());
         return;
     }
     
-    protocols_[protocolCount_++] = protocol;
-    LOG_INFO(LogTag::LED, "Registered protocol: %s", protocol->name());
+    LOG_INFO(LogTag::LED, "Registered protocol: %s (priority %d)", protocol->name(), policy.priority);
 }
 
 const char* LumeController::getActiveProtocolName() const {
-    if (activeProtocol_) {
-        return activeProtocol_->name();
+    IProtocol* owner = arbiter_.getOwner();
+    if (owner) {
+        return owner->name();
     }
     return nullptr;
 }
 
+void LumeController::pollProtocols() {
+    for (uint8_t i = 0; i < arbiter_.count(); i++) {
+        IProtocol* proto = arbiter_.get(i);
+        if (proto && proto->isEnabled()) {
+            proto->loop();  // Processes incoming packets
+        }
+    }
+}
+
 void LumeController::processProtocols() {
-    // Check each registered protocol for incoming data
-    for (uint8_t i = 0; i < protocolCount_; i++) {
-        IProtocol* proto = protocols_[i];
+    // Offer every protocol's new frame to the arbiter (whole frames only
+    // when frames are taken on arrival, so a partial frame never tears)
+    for (uint8_t i = 0; i < arbiter_.count(); i++) {
+        IProtocol* proto = arbiter_.get(i);
         if (!proto || !proto->isEnabled()) continue;
         
-        // Update protocol (processes incoming packets)
-        proto->loop();
+        bool ready = wholeFramesOnly() ? proto->hasCompleteFrame() : proto->hasData();
+        if (ready) {
+            offerProtocolFrame(i);
+        }
+    }
+    
+    // Release the owner once its hold expires
+    IProtocol* previous = arbiter_.getOwner();
+    if (arbiter_.update(millis())) {
+        // Handed to another live protocol: show its last frame right away
+        jitter_.clear();
+        takeProtocolFrame(arbiter_.getOwner());
+        frameArrivalUs_ = 0;  // Not a new arrival
+    } else if (previous && !arbiter_.getOwner()) {
+        jitter_.clear();
+    }
+}
+
+bool LumeController::offerProtocolFrame(uint8_t index) {
+    IProtocol* proto = arbiter_.get(index);
+    IProtocol* previous = arbiter_.getOwner();
+    
+    if (!arbiter_.offer(index, millis())) {
+        proto->clearData();  // Lost arbitration; consume so it doesn't linger
+        return false;
+    }
+    
+    if (previous != proto) {
+        jitter_.clear();  // Don't play out the old owner's frames
+    }
+    takeProtocolFrame(proto);
+    return true;
+}
+
+void LumeController::showArrivedFrame() {
+    // Strip still clocking out / latching the previous frame: the frame
+    // stays buffered and the next update() call retries
+    if (micros() - lastShowUs_ < getMinShowIntervalUs()) {
+        return;
+    }
+    
+    for (uint8_t i = 0; i < arbiter_.count(); i++) {
+        IProtocol* proto = arbiter_.get(i);
+        if (!proto || !proto->isEnabled()) continue;
         
-        // Check if this protocol has a frame ready
-        if (proto->hasData()) {
-            // Copy protocol buffer to LED array
-            const CRGB* buffer = proto->getBuffer();
-            uint16_t count = min(proto->getBufferSize(), ledCount);
-            
-            memcpy(leds, buffer, count * sizeof(CRGB));
-            proto->clearData();
-            
-            protocolActive_ = true;
-            activeProtocol_ = proto;
-            return;  // Only one protocol can be active at a time
+        if (proto->hasCompleteFrame() && offerProtocolFrame(i)) {
+            showProtocolFrame();
+            return;
         }
     }
+}
+
+void LumeController::bufferArrivedFrame() {
+    // The protocol buffer holds one frame; a burst would overwrite frames
+    // before the next tick, so hand them to the jitter buffer immediately
+    for (uint8_t i = 0; i < arbiter_.count(); i++) {
+        IProtocol* proto = arbiter_.get(i);
+        if (!proto || !proto->isEnabled()) continue;
+        
+        if (proto->hasCompleteFrame()) {
+            offerProtocolFrame(i);
+        }
+    }
+}
+
+void LumeController::copyProtocolBuffer(IProtocol* proto) {
+    uint16_t count = min(proto->getBufferSize(), ledCount);
+    memcpy(leds, proto->getBuffer(), count * sizeof(CRGB));
+}
+
+void LumeController::takeProtocolFrame(IProtocol* proto) {
+    frameArrivalUs_ = proto->frameArrivalUs();
+    if (jitter_.isEnabled()) {
+        uint16_t count = min(proto->getBufferSize(), ledCount);
+        jitter_.push(proto->getBuffer(), count, frameArrivalUs_ != 0 ? frameArrivalUs_ : micros());
+    } else {
+        copyProtocolBuffer(proto);
+    }
+    proto->clearData();
     
-    // Check if active protocol has timed out (no longer active)
-    if (protocolActive_ && activeProtocol_) {
-        if (!activeProtocol_->isActive()) {
-            LOG_INFO(LogTag::LED, "Protocol %s timeout - returning to effects", 
-                     activeProtocol_->name());
-            protocolActive_ = false;
-            activeProtocol_ = nullptr;
+    protocolFrameFresh_ = true;
+}
+
+void LumeController::showProtocolFrame() {
+    IProtocol* owner = arbiter_.getOwner();
+    
+    // Crossfading: rebuild from the owner's buffer so the blend isn't
+    // applied on top of last tick's blend
+    if (arbiter_.isFading()) {
+        if (!jitter_.isEnabled() && !protocolFrameFresh_ && owner) {
+            copyProtocolBuffer(owner);
         }
+        arbiter_.applyFade(leds, ledCount, millis());
+    }
+    
+    FastLED.show();
+    lastShowUs_ = micros();
+    frameCounter++;
+    
+    if (protocolFrameFresh_ && owner) {
+        owner->notifyShown(lastShowUs_);
+        // With a jitter buffer the latency is the configured delay by design
+        if (frameArrivalUs_ != 0 && !jitter_.isEnabled()) {
+            latchLatency_.record(lastShowUs_ - frameArrivalUs_);
+        }
+        protocolFrameFresh_ = false;
+    }
+}
+
+void LumeController::setShowOnArrival(bool enabled) {
+    if (enabled != showOnArrival_) {
+        showOnArrival_ = enabled;
+        latchLatency_.reset();  // Keep stats comparable per mode
+        LOG_INFO(LogTag::LED, "Show-on-arrival %s", enabled ? "enabled" : "disabled");
     }
 }
 
+void LumeController::configureProtocolOutput(bool showOnArrival, uint16_t jitterMs, bool interpolate) {
+    pendingShowOnArrival_ = showOnArrival;
+    pendingJitterMs_ = jitterMs;
+    pendingInterpolate_ = interpolate;
+    protocolOutputPending_ = true;
+}
+
+void LumeController::applyProtocolOutput() {
+    protocolOutputPending_ = false;
+    setShowOnArrival(pendingShowOnArrival_);
+    setJitterBuffer(pendingJitterMs_, pendingInterpolate_);
+}
+
+void LumeController::setLockstep(bool enabled) {
+    if (enabled != lockstep_) {
+        lockstepFrame_ = 0;
+        lockstep_ = enabled;
+        LOG_INFO(LogTag::LED, "Lockstep rendering %s", enabled ? "enabled" : "disabled");
+    }
+}
+
+uint32_t effectMillis() {
+    return controller.getEffectMillis();
+}
+
 void LumeController::startNightlight(uint16_t durationSeconds, uint8_t targetBrightness) {
+    cancelTransition();
     nightlightActive = true;
     nightlightStartTime = millis();
     nightlightDuration = durationSeconds;
@@ -416,6 +679,80 @@ void LumeController::startNightlight(uint16_t durationSeconds, uint8_t targetBri
              durationSeconds, nightlightStartBrightness, targetBrightness);
 }
 
+void LumeController::startTransition(bool on, int16_t brightness, uint16_t durationMs) {
+    uint8_t level = brightness >= 0 ? (uint8_t)min(brightness, (int16_t)255) : getTargetBrightness();
+    stopNightlight();
+    
+    if (!on && !power) {
+        // Already off: only remember the level for the next power on
+        transitionActive_ = false;
+        setBrightness(level);
+        return;
+    }
+    if (on && !power) {
+        setBrightness(0);
+        setPower(true);
+    }
+    
+    transitionActive_ = true;
+    transitionPowerOff_ = !on;
+    transitionStartMs_ = millis();
+    transitionMs_ = durationMs;
+    transitionFrom_ = globalBrightness;
+    transitionTo_ = on ? level : 0;
+    transitionRestore_ = level;
+    updateTransition(transitionStartMs_);
+    
+    LOG_DEBUG(LogTag::LED, "Transition to %s %d over %dms", on ? "on" : "off", level, durationMs);
+}
+
+void LumeController::updateTransition(uint32_t now) {
+    uint32_t elapsed = now - transitionStartMs_;
+    if (elapsed >= transitionMs_) {
+        transitionActive_ = false;
+        if (transitionPowerOff_) {
+            power = false;
+            applyBrightness(transitionRestore_);
+        } else {
+            applyBrightness(transitionTo_);
+        }
+        return;
+    }
+    int32_t diff = (int32_t)transitionTo_ - (int32_t)transitionFrom_;
+    applyBrightness(transitionFrom_ + diff * (int32_t)elapsed / (int32_t)transitionMs_);
+}
+
+// A fade-out left halfway would otherwise become the brightness for the
+// next power on
+void LumeController::cancelTransition() {
+    if (transitionActive_) {
+        applyBrightness(getTargetBrightness());
+        transitionActive_ = false;
+    }
+}
+
+void LumeController::applyBrightness(uint8_t bri) {
+    globalBrightness = bri;
+    FastLED.setBrightness(bri);
+}
+
+void LumeController::setPower(bool on) {
+    cancelTransition();
+    power = on;
+}
+
+void LumeController::setBrightness(uint8_t bri) {
+    cancelTransition();
+    applyBrightness(bri);
+}
+
+uint8_t LumeController::getTargetBrightness() const {
+    if (!transitionActive_) {
+        return globalBrightness;
+    }
+    return transitionPowerOff_ ? transitionRestore_ : transitionTo_;
+}
+
 void LumeController::stopNightlight() {
     if (nightlightActive) {
         nightlightActive = false;
@@ -5,6 +5,9 @@
 #include <atomic>
 #include "segment.h"
 #include "command_queue.h"
+#include "histogram.h"
+#include "jitter_buffer.h"
+#include "protocol_arbiter.h"
 #include "../constants.h"
 
 // Forward declare IProtocol interface
@@ -18,6 +21,38 @@ constexpr uint8_t MAX_SEGMENTS = 8;
 // Default frame rate target
 constexpr uint16_t DEFAULT_FPS = 60;
 
+/**
+ * Changes to one segment within a StatePatch
+ */
+struct SegmentPatch {
+    uint8_t id;
+    bool setRange;              // Creates the segment if it doesn't exist
+    bool reversed;
+    uint16_t start;
+    uint16_t length;
+    const EffectInfo* effect;   // nullptr = keep (params follow the new effect)
+    bool setPalette;
+    uint8_t palette;
+    uint8_t paramCount;
+    ParamData params[MAX_EFFECT_PARAMS];
+};
+
+/**
+ * StatePatch - Validated state changes applied as a unit
+ *
+ * Too large for the command queue, so it is handed to the main loop and
+ * applied there between two frames: the strip never shows half of it.
+ */
+struct StatePatch {
+    bool setPower;
+    bool power;
+    bool setBrightness;
+    uint8_t brightness;
+    bool replaceSegments;       // Remove segments that aren't listed
+    uint8_t segmentCount;
+    SegmentPatch segments[MAX_SEGMENTS];
+};
+
 /**
  * LumeController - The main orchestrator
  * 
@@ -58,6 +93,9 @@ public:
     // Create a new segment (returns nullptr if max segments reached)
     Segment* createSegment(uint16_t start, uint16_t length, bool reversed = false);
     
+    // Create a segment with a given ID (nullptr if the ID is taken)
+    Segment* createSegment(uint16_t start, uint16_t length, bool reversed, uint8_t id);
+    
     // Get segment by ID
     Segment* getSegment(uint8_t id);
     
@@ -77,15 +115,26 @@ public:
     
     // --- Global controls ---
     
-    void setPower(bool on) { power = on; }
+    // Both cancel a running transition (see startTransition)
+    void setPower(bool on);
     bool getPower() const { return power; }
     
-    void setBrightness(uint8_t bri) { 
-        globalBrightness = bri; 
-        FastLED.setBrightness(bri);
-    }
+    void setBrightness(uint8_t bri);
     uint8_t getBrightness() const { return globalBrightness; }
     
+    // Fade to a power/brightness state over durationMs (0 = at once).
+    // Turning on from off fades up from black; turning off fades to black,
+    // then powers off and restores the brightness for the next power on.
+    // brightness < 0 keeps the current target. setPower, setBrightness and
+    // startNightlight cancel a running transition, jumping to its target
+    // brightness first.
+    void startTransition(bool on, int16_t brightness, uint16_t durationMs);
+    bool isTransitionActive() const { return transitionActive_; }
+    
+    // Power and brightness a running transition ends at (else the current ones)
+    bool getTargetPower() const { return power && !(transitionActive_ && transitionPowerOff_); }
+    uint8_t getTargetBrightness() const;
+    
     void setTargetFps(uint16_t fps) { targetFps = fps; }
     uint16_t getTargetFps() const { return targetFps; }
     
@@ -108,15 +157,45 @@ public:
     
     // --- Protocol management ---
     
-    // Register a protocol (called at startup)
-    void registerProtocol(IProtocol* protocol);
+    // Register a protocol with its arbitration policy (called at startup)
+    void registerProtocol(IProtocol* protocol,
+                          const ProtocolPolicy& policy = DEFAULT_PROTOCOL_POLICY);
+    
+    // Check if any protocol currently owns the output
+    bool isProtocolActive() const { return arbiter_.getOwner() != nullptr; }
     
-    // Check if any protocol is currently active (receiving data)
-    bool isProtocolActive() const { return protocolActive_; }
+    // Ownership state, policies and per-protocol liveness
+    ProtocolArbiter& getArbiter() { return arbiter_; }
+    const ProtocolArbiter& getArbiter() const { return arbiter_; }
     
     // Get active protocol name (or nullptr if none)
     const char* getActiveProtocolName() const;
     
+    // Show-on-arrival: latch complete protocol frames as soon as they arrive
+    // instead of waiting for the next frame tick (bounded by strip refresh)
+    void setShowOnArrival(bool enabled);
+    bool getShowOnArrival() const { return showOnArrival_; }
+    
+    // Shortest interval between show() calls the strip can take
+    uint32_t getMinShowIntervalUs() const {
+        return (uint32_t)ledCount * LED_US_PER_PIXEL + LED_LATCH_US;
+    }
+    
+    // Protocol frame arrival -> show() complete, in microseconds
+    const Histogram& getLatchLatency() const { return latchLatency_; }
+    
+    // Jitter buffer: play protocol frames at a steady cadence delayMs behind
+    // arrival, optionally blending between frames (0 = off). Takes precedence
+    // over show-on-arrival. Main loop only: the jitter buffer is reallocated.
+    bool setJitterBuffer(uint16_t delayMs, bool interpolate) {
+        return jitter_.configure(delayMs, interpolate);
+    }
+    const JitterBuffer& getJitterBuffer() const { return jitter_; }
+    
+    // Show-on-arrival and jitter buffer from any task: update() applies
+    // them before its next frame
+    void configureProtocolOutput(bool showOnArrival, uint16_t jitterMs, bool interpolate);
+    
     // --- Direct LED access (for protocols like sACN) ---
     
     CRGB* getLeds() { return leds; }
@@ -126,6 +205,20 @@ public:
     // Get frame counter (for effects)
     uint32_t getFrame() const { return frameCounter; }
     
+    // --- Lockstep rendering ---
+    
+    // Shared clock in microseconds (nullptr = local clock)
+    void setTimeSource(int64_t (*source)()) { timeSource_ = source; }
+    
+    // Render effects on frame boundaries of the shared clock: the frame
+    // number, effectMillis() and the random seed are derived from it, so
+    // nodes with the same effects and FPS render identical frames
+    void setLockstep(bool enabled);
+    bool getLockstep() const { return lockstep_; }
+    
+    // Milliseconds effects animate against (see effectMillis())
+    uint32_t getEffectMillis() const { return lockstep_ ? effectMs_ : millis(); }
+    
     // Get actual FPS (for diagnostics)
     uint16_t getActualFps() const { return actualFps; }
     
@@ -136,6 +229,19 @@ public:
         return commandQueue.enqueue(cmd);
     }
     
+    // Apply a whole patch at once (main loop only, between frames)
+    void applyStatePatch(const StatePatch& patch);
+    
+    // Free queue slots (enqueueing past this drops the oldest commands)
+    size_t getCommandQueueSpace() const {
+        return CommandQueue::QUEUE_SIZE - commandQueue.pendingCount();
+    }
+    
+    // Passes over the command queue so far. A command enqueued before this
+    // was read has run once the count moves past the value read (compare
+    // from the main loop, between frames).
+    uint32_t getCommandPasses() const { return commandPasses_; }
+    
 private:
     // Process pending commands (called at start of each frame)
     void processCommands();
@@ -143,9 +249,34 @@ private:
     // Execute a single command
     void executeCommand(const Command& cmd);
     
+    // Set a param if the segment's effect has it with the same type
+    void applyParam(Segment* seg, const ParamData& param);
+    
+    // Let registered protocols read their sockets (every update() call)
+    void pollProtocols();
+    
     // Process registered protocols (check for incoming data)
     void processProtocols();
     
+    // Latch a complete protocol frame immediately if the strip is ready
+    void showArrivedFrame();
+    
+    // Move complete protocol frames into the jitter buffer as they arrive
+    void bufferArrivedFrame();
+    
+    // Offer a protocol's new frame to the arbiter; takes it if accepted
+    bool offerProtocolFrame(uint8_t index);
+    
+    // Consume a protocol's new frame into the LED array (or jitter buffer)
+    void takeProtocolFrame(IProtocol* proto);
+    void copyProtocolBuffer(IProtocol* proto);
+    
+    // Show the LED array while a protocol is active (records latency)
+    void showProtocolFrame();
+    
+    // Frames are taken as they arrive, so only whole frames qualify
+    bool wholeFramesOnly() const { return showOnArrival_ || jitter_.isEnabled(); }
+    
     // LED array
     CRGB leds[MAX_LED_COUNT];
     uint16_t ledCount;
@@ -169,13 +300,33 @@ private:
     uint8_t nightlightStartBrightness;
     uint8_t nightlightTargetBrightness;
     
+    // Power/brightness transition
+    void updateTransition(uint32_t now);
+    void cancelTransition();
+    void applyBrightness(uint8_t bri);   // Leaves a running transition alone
+    bool transitionActive_;
+    bool transitionPowerOff_;        // Power off when done
+    uint32_t transitionStartMs_;
+    uint16_t transitionMs_;
+    uint8_t transitionFrom_;
+    uint8_t transitionTo_;
+    uint8_t transitionRestore_;      // Brightness after a fade-out
+    
     // Protocol handling
-    static constexpr uint8_t MAX_PROTOCOLS = 4;
-    IProtocol* protocols_[MAX_PROTOCOLS];
-    uint8_t protocolCount_;
-    bool protocolActive_;
-    IProtocol* activeProtocol_;
-    static constexpr uint32_t PROTOCOL_TIMEOUT_MS = 5000;
+    ProtocolArbiter arbiter_;
+    bool protocolFrameFresh_;    // Copied a new protocol frame, not yet shown
+    bool showOnArrival_;
+    uint32_t frameArrivalUs_;    // Arrival of the copied frame (0 = unknown)
+    uint32_t lastShowUs_;
+    Histogram latchLatency_;
+    JitterBuffer jitter_;
+    
+    // Protocol output settings handed to update()
+    void applyProtocolOutput();
+    bool pendingShowOnArrival_;
+    uint16_t pendingJitterMs_;
+    bool pendingInterpolate_;
+    volatile bool protocolOutputPending_;
     
     // Timing
     uint16_t targetFps;
@@ -184,6 +335,13 @@ private:
     uint16_t actualFps;
     uint32_t fpsUpdateTime;
     uint16_t fpsFrameCount;
+    volatile uint32_t commandPasses_;   // Incremented as each pass starts
+    
+    // Lockstep
+    int64_t (*timeSource_)();
+    bool lockstep_;
+    uint32_t lockstepFrame_;     // Shared clock / frame interval
+    uint32_t effectMs_;          // Shared clock at the start of lockstepFrame_
     
     // Internal helpers
     void blendSegment(Segment& seg);
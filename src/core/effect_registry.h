@@ -21,7 +21,8 @@ namespace lume {
  * 
  * Effects should:
  * - Write colors to view[0..view.size()-1]
- * - Use frame for animation timing (not millis())
+ * - Use frame for animation timing (not millis()); where wall-clock time
+ *   is needed, use effectMillis() and the effectBeat* helpers below
  * - Initialize scratchpad state when firstFrame is true via view.getScratchpad<T>()
  * - Avoid global/static state - use segment scratchpad instead
  * - Be deterministic given the same inputs
@@ -29,6 +30,30 @@ namespace lume {
 using EffectFn = void (*)(SegmentView& view, const ParamValues& params,
                           uint32_t frame, bool firstFrame);
 
+/**
+ * Effect clock in milliseconds
+ *
+ * millis() normally. In lockstep mode it is the shared network clock at
+ * the start of the current frame, so every node renders the same frame
+ * for the same timestamp (implemented by the controller).
+ */
+uint32_t effectMillis();
+
+// FastLED's beat16/beatsin8/beatsin16, driven by effectMillis()
+inline uint16_t effectBeat16(uint16_t bpm) {
+    return (uint16_t)(((uint64_t)effectMillis() * ((uint32_t)bpm << 8) * 280) >> 16);
+}
+
+inline uint8_t effectBeatsin8(uint8_t bpm, uint8_t lowest = 0, uint8_t highest = 255) {
+    uint8_t beatsin = sin8(effectBeat16(bpm) >> 8);
+    return lowest + scale8(beatsin, highest - lowest);
+}
+
+inline uint16_t effectBeatsin16(uint16_t bpm, uint16_t lowest = 0, uint16_t highest = 65535) {
+    uint16_t beatsin = (uint16_t)(sin16(effectBeat16(bpm)) + 32768);
+    return lowest + scale16(beatsin, highest - lowest);
+}
+
 /**
  * Effect categories for UI grouping and filtering
  */
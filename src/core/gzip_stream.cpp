@@ -0,0 +1,212 @@
+/**
+ * GzipStream - Streaming gzip encoder implementation
+ *
+ * RFC 1951 (deflate) inside RFC 1952 (gzip). Everything goes out as fixed
+ * Huffman blocks: no frequency pass, so the input never has to be held
+ * beyond the match window.
+ */
+
+#include "gzip_stream.h"
+#include <esp_rom_crc.h>
+
+namespace lume {
+
+namespace {
+
+const uint16_t LENGTH_BASE[29] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+    35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+const uint8_t LENGTH_EXTRA[29] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+    3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+const uint16_t DISTANCE_BASE[30] = {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+    257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577
+};
+const uint8_t DISTANCE_EXTRA[30] = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+    7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+
+constexpr uint16_t END_OF_BLOCK = 256;
+
+// Header: magic, deflate, no flags, no mtime, no extra flags, OS unknown
+const uint8_t GZIP_HEADER[10] = {0x1f, 0x8b, 0x08, 0x00, 0, 0, 0, 0, 0x00, 0xff};
+
+} // anonymous namespace
+
+GzipStream::GzipStream(Print& out)
+    : out_(out)
+    , fill_(0)
+    , pos_(0)
+    , bitBuffer_(0)
+    , bitCount_(0)
+    , outLength_(0)
+    , crc_(0)
+    , inputSize_(0)
+    , finished_(false) {
+    memset(head_, 0, sizeof(head_));
+    out_.write(GZIP_HEADER, sizeof(GZIP_HEADER));
+
+    // One open-ended fixed-Huffman block; finish() closes it
+    putBits(0, 1);      // BFINAL
+    putBits(1, 2);      // BTYPE = fixed
+}
+
+size_t GzipStream::write(uint8_t c) {
+    return write(&c, 1);
+}
+
+size_t GzipStream::write(const uint8_t* data, size_t len) {
+    if (finished_) {
+        return 0;
+    }
+    crc_ = esp_rom_crc32_le(crc_, data, len);
+    inputSize_ += len;
+
+    size_t remaining = len;
+    while (remaining > 0) {
+        if (fill_ == sizeof(window_)) {
+            slide();
+        }
+        size_t n = min(remaining, sizeof(window_) - fill_);
+        memcpy(window_ + fill_, data, n);
+        fill_ += n;
+        data += n;
+        remaining -= n;
+        compress(false);
+    }
+    return len;
+}
+
+void GzipStream::finish() {
+    if (finished_) {
+        return;
+    }
+    compress(true);
+    putLiteral(END_OF_BLOCK);
+
+    // Empty final block
+    putBits(1, 1);
+    putBits(1, 2);
+    putLiteral(END_OF_BLOCK);
+    if (bitCount_ > 0) {
+        putBits(0, 8 - bitCount_);
+    }
+
+    for (uint8_t i = 0; i < 4; i++) {
+        putBits((crc_ >> (8 * i)) & 0xFF, 8);
+    }
+    for (uint8_t i = 0; i < 4; i++) {
+        putBits((inputSize_ >> (8 * i)) & 0xFF, 8);
+    }
+    flushOutput();
+    finished_ = true;
+}
+
+void GzipStream::compress(bool flush) {
+    // Without flush, keep a full match of lookahead for the next write
+    while (pos_ < fill_ && (flush || (size_t)(fill_ - pos_) >= MAX_MATCH)) {
+        size_t available = fill_ - pos_;
+        if (available >= MIN_MATCH) {
+            const uint8_t* p = window_ + pos_;
+            uint32_t key = ((uint32_t)p[0] << 16) | ((uint32_t)p[1] << 8) | p[2];
+            uint16_t hash = (key * 2654435761u) >> (32 - HASH_BITS);
+            uint16_t candidate = head_[hash];
+            head_[hash] = pos_ + 1;
+
+            if (candidate) {
+                const uint8_t* match = window_ + candidate - 1;
+                size_t limit = min(available, MAX_MATCH);
+                size_t length = 0;
+                while (length < limit && match[length] == p[length]) {
+                    length++;
+                }
+                if (length >= MIN_MATCH) {
+                    putMatch(length, p - match);
+                    // Index the covered positions so later matches can find them
+                    for (size_t i = 1; i < length && pos_ + i + MIN_MATCH <= fill_; i++) {
+                        const uint8_t* q = p + i;
+                        uint32_t k = ((uint32_t)q[0] << 16) | ((uint32_t)q[1] << 8) | q[2];
+                        head_[(k * 2654435761u) >> (32 - HASH_BITS)] = pos_ + i + 1;
+                    }
+                    pos_ += length;
+                    continue;
+                }
+            }
+        }
+        putLiteral(window_[pos_]);
+        pos_++;
+    }
+}
+
+void GzipStream::slide() {
+    // Only called with the window full, so pos_ is past the first half
+    memmove(window_, window_ + WINDOW_SIZE, WINDOW_SIZE);
+    fill_ -= WINDOW_SIZE;
+    pos_ -= WINDOW_SIZE;
+    for (uint16_t& entry : head_) {
+        entry = entry > WINDOW_SIZE ? entry - WINDOW_SIZE : 0;
+    }
+}
+
+void GzipStream::putBits(uint32_t value, uint8_t count) {
+    bitBuffer_ |= value << bitCount_;
+    bitCount_ += count;
+    while (bitCount_ >= 8) {
+        outBuffer_[outLength_++] = bitBuffer_ & 0xFF;
+        if (outLength_ == OUT_SIZE) {
+            flushOutput();
+        }
+        bitBuffer_ >>= 8;
+        bitCount_ -= 8;
+    }
+}
+
+void GzipStream::putCode(uint16_t code, uint8_t length) {
+    uint16_t reversed = 0;
+    for (uint8_t i = 0; i < length; i++) {
+        reversed = (reversed << 1) | ((code >> i) & 1);
+    }
+    putBits(reversed, length);
+}
+
+void GzipStream::putLiteral(uint16_t symbol) {
+    // Fixed literal/length code (RFC 1951 3.2.6)
+    if (symbol < 144) {
+        putCode(0x30 + symbol, 8);
+    } else if (symbol < 256) {
+        putCode(0x190 + symbol - 144, 9);
+    } else if (symbol < 280) {
+        putCode(symbol - 256, 7);
+    } else {
+        putCode(0xC0 + symbol - 280, 8);
+    }
+}
+
+void GzipStream::putMatch(uint16_t length, uint16_t distance) {
+    uint8_t l = 28;
+    while (LENGTH_BASE[l] > length) {
+        l--;
+    }
+    putLiteral(257 + l);
+    putBits(length - LENGTH_BASE[l], LENGTH_EXTRA[l]);
+
+    uint8_t d = 29;
+    while (DISTANCE_BASE[d] > distance) {
+        d--;
+    }
+    putCode(d, 5);
+    putBits(distance - DISTANCE_BASE[d], DISTANCE_EXTRA[d]);
+}
+
+void GzipStream::flushOutput() {
+    if (outLength_ > 0) {
+        out_.write(outBuffer_, outLength_);
+        outLength_ = 0;
+    }
+}
+
+} // namespace lume
@@ -0,0 +1,69 @@
+#ifndef LUME_GZIP_STREAM_H
+#define LUME_GZIP_STREAM_H
+
+#include <Arduino.h>
+
+namespace lume {
+
+/**
+ * GzipStream - Small streaming gzip encoder
+ *
+ * Deflate with one hash probe per position over an 8 KB history and the
+ * fixed Huffman tables. It needs about 12 KB of working memory, where a
+ * zlib-class compressor needs well over 100 KB. Output is about twice
+ * the size gzip -9 makes, which still shrinks JSON several times over,
+ * because JSON is mostly repeated keys and punctuation.
+ *
+ * Feed input with write() (ArduinoJson can serialize straight into it),
+ * then call finish() once. Compressed bytes go to the Print as they are
+ * produced. The object is large: allocate it on the heap, not on a task
+ * stack.
+ */
+class GzipStream {
+public:
+    explicit GzipStream(Print& out);
+
+    size_t write(uint8_t c);
+    size_t write(const uint8_t* data, size_t len);
+
+    // Flush everything and write the gzip trailer
+    void finish();
+
+    // Of the uncompressed input so far
+    uint32_t getCrc32() const { return crc_; }
+    uint32_t getInputSize() const { return inputSize_; }
+
+private:
+    static constexpr size_t WINDOW_SIZE = 4096;     // Slide step; history is up to 2x
+    static constexpr size_t MIN_MATCH = 3;
+    static constexpr size_t MAX_MATCH = 258;
+    static constexpr uint8_t HASH_BITS = 11;
+    static constexpr size_t OUT_SIZE = 128;
+
+    void compress(bool flush);
+    void slide();
+    void putBits(uint32_t value, uint8_t count);
+    void putCode(uint16_t code, uint8_t length);    // Huffman code, MSB first
+    void putLiteral(uint16_t symbol);
+    void putMatch(uint16_t length, uint16_t distance);
+    void flushOutput();
+
+    Print& out_;
+    uint8_t window_[2 * WINDOW_SIZE];
+    uint16_t head_[1 << HASH_BITS];     // Last position + 1 per hash, 0 = none
+    uint16_t fill_;                     // Bytes in window_
+    uint16_t pos_;                      // Next byte to encode
+
+    uint32_t bitBuffer_;
+    uint8_t bitCount_;
+    uint8_t outBuffer_[OUT_SIZE];
+    uint8_t outLength_;
+
+    uint32_t crc_;
+    uint32_t inputSize_;
+    bool finished_;
+};
+
+} // namespace lume
+
+#endif // LUME_GZIP_STREAM_H
@@ -0,0 +1,76 @@
+#ifndef LUME_HISTOGRAM_H
+#define LUME_HISTOGRAM_H
+
+#include <Arduino.h>
+
+namespace lume {
+
+/**
+ * Histogram - Fixed log2-bucket histogram for timing diagnostics
+ *
+ * Bucket 0 counts zero values, bucket i counts [2^(i-1), 2^i) and the
+ * last bucket collects everything above. Values are microseconds by
+ * convention, which puts the last bucket at ~262 ms.
+ *
+ * Plain struct (no constructor) so it can live inside memset-initialized
+ * protocol state. Written by one task; readers on other tasks may see a
+ * slightly torn snapshot, which is fine for diagnostics.
+ */
+struct Histogram {
+    static constexpr uint8_t BUCKETS = 20;
+
+    uint32_t buckets[BUCKETS];
+    uint32_t count;
+    uint32_t minValue;
+    uint32_t maxValue;
+    uint64_t sum;
+
+    void reset() {
+        memset(buckets, 0, sizeof(buckets));
+        count = 0;
+        minValue = 0;
+        maxValue = 0;
+        sum = 0;
+    }
+
+    void record(uint32_t value) {
+        buckets[bucketFor(value)]++;
+        if (count == 0 || value < minValue) minValue = value;
+        if (value > maxValue) maxValue = value;
+        sum += value;
+        count++;
+    }
+
+    uint32_t mean() const {
+        return count > 0 ? (uint32_t)(sum / count) : 0;
+    }
+
+    // Upper bound of the bucket holding the given percentile (0-100)
+    uint32_t percentile(uint8_t pct) const {
+        if (count == 0) return 0;
+        uint32_t target = ((uint64_t)count * pct + 99) / 100;
+        uint32_t seen = 0;
+        for (uint8_t i = 0; i < BUCKETS; i++) {
+            seen += buckets[i];
+            if (seen >= target) {
+                return min(upperBound(i), maxValue);
+            }
+        }
+        return maxValue;
+    }
+
+    // Exclusive upper bound of bucket i (last bucket is open-ended)
+    static uint32_t upperBound(uint8_t i) {
+        return (i + 1 < BUCKETS) ? ((uint32_t)1 << i) : UINT32_MAX;
+    }
+
+    static uint8_t bucketFor(uint32_t value) {
+        if (value == 0) return 0;
+        uint8_t bits = 32 - __builtin_clz(value);
+        return bits < BUCKETS ? bits : BUCKETS - 1;
+    }
+};
+
+} // namespace lume
+
+#endif // LUME_HISTOGRAM_H
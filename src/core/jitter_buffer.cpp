@@ -0,0 +1,154 @@
+/**
+ * JitterBuffer implementation
+ */
+
+#include "jitter_buffer.h"
+#include "../logging.h"
+
+namespace lume {
+
+JitterBuffer::JitterBuffer()
+    : frames_(nullptr)
+    , head_(0)
+    , count_(0)
+    , delayUs_(0)
+    , interpolate_(true)
+    , lastArrivalUs_(0)
+    , lastStampUs_(0)
+    , cadenceUs_(0)
+    , underruns_(0)
+    , overruns_(0)
+    , resyncs_(0)
+    , starved_(false) {
+    memset(slots_, 0, sizeof(slots_));
+}
+
+JitterBuffer::~JitterBuffer() {
+    free(frames_);
+}
+
+bool JitterBuffer::configure(uint16_t delayMs, bool interpolate) {
+    delayMs = min(delayMs, JITTER_MAX_DELAY_MS);
+    interpolate_ = interpolate;
+
+    if (delayMs == 0) {
+        if (frames_) {
+            free(frames_);
+            frames_ = nullptr;
+            LOG_INFO(LogTag::LED, "Jitter buffer disabled");
+        }
+        delayUs_ = 0;
+        return true;
+    }
+
+    if (!frames_) {
+        frames_ = (CRGB*)malloc(sizeof(CRGB) * MAX_LED_COUNT * JITTER_BUFFER_FRAMES);
+        if (!frames_) {
+            LOG_ERROR(LogTag::LED, "Jitter buffer allocation failed");
+            delayUs_ = 0;
+            return false;
+        }
+    }
+
+    delayUs_ = (uint32_t)delayMs * 1000;
+    cadenceUs_ = 0;
+    underruns_ = 0;
+    overruns_ = 0;
+    resyncs_ = 0;
+    clear();
+
+    LOG_INFO(LogTag::LED, "Jitter buffer: %dms delay, interpolation %s",
+             delayMs, interpolate ? "on" : "off");
+    return true;
+}
+
+void JitterBuffer::push(const CRGB* data, uint16_t count, uint32_t arrivalUs) {
+    if (!frames_) return;
+
+    // De-jitter the timestamp against the tracked sender cadence
+    uint32_t stamp = arrivalUs;
+    if (lastArrivalUs_ != 0) {
+        uint32_t interval = arrivalUs - lastArrivalUs_;
+        if (cadenceUs_ == 0) {
+            cadenceUs_ = interval;
+        } else if (interval < cadenceUs_ * 4) {
+            // Ignore pauses; they'd drag the cadence estimate
+            cadenceUs_ += ((int32_t)(interval - cadenceUs_)) / 16;
+        }
+
+        uint32_t predicted = lastStampUs_ + cadenceUs_;
+        int32_t error = (int32_t)(arrivalUs - predicted);
+        uint32_t absError = (error < 0) ? -error : error;
+        if (absError > cadenceUs_ * 2 || absError > delayUs_) {
+            resyncs_++;  // Source paused or changed rate: snap to arrival
+        } else {
+            stamp = predicted + error / 8;
+        }
+    }
+    lastArrivalUs_ = arrivalUs;
+    lastStampUs_ = stamp;
+
+    // Ring full: drop the oldest
+    if (count_ == JITTER_BUFFER_FRAMES) {
+        head_ = (head_ + 1) % JITTER_BUFFER_FRAMES;
+        count_--;
+        overruns_++;
+    }
+
+    uint8_t index = (head_ + count_) % JITTER_BUFFER_FRAMES;
+    count = min(count, MAX_LED_COUNT);
+    memcpy(frames_ + (size_t)index * MAX_LED_COUNT, data, count * sizeof(CRGB));
+    slots_[index].timestampUs = stamp;
+    slots_[index].ledCount = count;
+    count_++;
+}
+
+bool JitterBuffer::render(CRGB* out, uint16_t count, uint32_t nowUs) {
+    if (!frames_ || count_ == 0) return false;
+
+    uint32_t playout = nowUs - delayUs_;
+
+    // Retire frames once the next one is due
+    while (count_ >= 2 && (int32_t)(playout - slotAt(1).timestampUs) >= 0) {
+        head_ = (head_ + 1) % JITTER_BUFFER_FRAMES;
+        count_--;
+    }
+
+    const Slot& a = slotAt(0);
+    uint16_t n = min(count, a.ledCount);
+
+    // Playout sits between the two oldest frames: blend them
+    if (count_ >= 2 && interpolate_ && (int32_t)(playout - a.timestampUs) >= 0) {
+        const Slot& b = slotAt(1);
+        uint32_t span = b.timestampUs - a.timestampUs;
+        uint32_t into = playout - a.timestampUs;
+        fract8 amount = span > 0 ? (fract8)min((uint32_t)255, (into << 8) / span) : 0;
+        n = min(n, b.ledCount);
+        blend(frameAt(0), frameAt(1), out, n, amount);
+    } else {
+        // Not yet due (startup/resync) or holding: show the oldest as-is
+        memcpy(out, frameAt(0), n * sizeof(CRGB));
+    }
+
+    // Holding the newest frame with nothing behind it
+    if (count_ == 1 && (int32_t)(playout - a.timestampUs) >= 0) {
+        if (!starved_) {
+            underruns_++;
+            starved_ = true;
+        }
+    } else {
+        starved_ = false;
+    }
+
+    return true;
+}
+
+void JitterBuffer::clear() {
+    head_ = 0;
+    count_ = 0;
+    lastArrivalUs_ = 0;
+    lastStampUs_ = 0;
+    starved_ = false;
+}
+
+} // namespace lume
@@ -0,0 +1,88 @@
+#ifndef LUME_JITTER_BUFFER_H
+#define LUME_JITTER_BUFFER_H
+
+#include <FastLED.h>
+#include "../constants.h"
+
+namespace lume {
+
+// Frames held for playout: max delay at 44 Hz plus one interpolation pair
+constexpr uint8_t JITTER_BUFFER_FRAMES = 5;
+constexpr uint16_t JITTER_MAX_DELAY_MS = 60;
+
+/**
+ * JitterBuffer - Steady playout of bursty protocol frames
+ *
+ * Frames are stamped on push with a de-jittered time: the estimated sender
+ * cadence is tracked and each timestamp is the predicted time nudged 1/8
+ * toward the real arrival, so WiFi bursts don't bunch frames together.
+ * render() plays out at (now - delay), either holding the frame due at
+ * that moment or linearly blending the two frames around it.
+ *
+ * Storage is allocated on enable so the feature costs nothing when off.
+ * Main loop only (controller owns it).
+ */
+class JitterBuffer {
+public:
+    JitterBuffer();
+    ~JitterBuffer();
+
+    // Allocate and start buffering (delayMs 0 frees the buffer)
+    bool configure(uint16_t delayMs, bool interpolate);
+    bool isEnabled() const { return frames_ != nullptr; }
+    uint16_t getDelayMs() const { return delayUs_ / 1000; }
+    bool getInterpolate() const { return interpolate_; }
+
+    // Queue a frame that arrived at arrivalUs (micros)
+    void push(const CRGB* data, uint16_t count, uint32_t arrivalUs);
+
+    // Write the frame due at nowUs into out; false until something is due
+    bool render(CRGB* out, uint16_t count, uint32_t nowUs);
+
+    // Drop buffered frames (protocol released)
+    void clear();
+
+    // --- Diagnostics ---
+
+    uint8_t getDepth() const { return count_; }
+    uint32_t getCadenceUs() const { return cadenceUs_; }
+    uint32_t getUnderruns() const { return underruns_; }
+    uint32_t getOverruns() const { return overruns_; }
+    uint32_t getResyncs() const { return resyncs_; }
+
+private:
+    struct Slot {
+        uint32_t timestampUs;     // De-jittered media time
+        uint16_t ledCount;
+    };
+
+    CRGB* frames_;                // JITTER_BUFFER_FRAMES x MAX_LED_COUNT
+    Slot slots_[JITTER_BUFFER_FRAMES];
+    uint8_t head_;                // Oldest frame
+    uint8_t count_;
+
+    uint32_t delayUs_;
+    bool interpolate_;
+
+    // Timestamp smoothing
+    uint32_t lastArrivalUs_;
+    uint32_t lastStampUs_;
+    uint32_t cadenceUs_;
+
+    // Stats
+    uint32_t underruns_;          // Playout reached the newest frame with nothing after it
+    uint32_t overruns_;           // Oldest frame dropped because the ring was full
+    uint32_t resyncs_;            // Timestamp snapped back to arrival time
+    bool starved_;
+
+    CRGB* frameAt(uint8_t index) const {
+        return frames_ + (size_t)((head_ + index) % JITTER_BUFFER_FRAMES) * MAX_LED_COUNT;
+    }
+    const Slot& slotAt(uint8_t index) const {
+        return slots_[(head_ + index) % JITTER_BUFFER_FRAMES];
+    }
+};
+
+} // namespace lume
+
+#endif // LUME_JITTER_BUFFER_H
@@ -0,0 +1,252 @@
+/**
+ * JsonSite - Arena-backed ArduinoJson allocator implementation
+ */
+
+#include "json_pool.h"
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+namespace lume {
+
+namespace {
+
+// Precedes every block, arena or heap; 8 bytes keeps payloads aligned
+struct BlockHeader {
+    uint32_t size;
+    uint32_t reserved;
+};
+
+constexpr size_t HEADER_SIZE = sizeof(BlockHeader);
+
+inline size_t alignUp(size_t size) {
+    return (size + 7) & ~static_cast<size_t>(7);
+}
+
+inline BlockHeader* headerOf(void* ptr) {
+    return static_cast<BlockHeader*>(ptr) - 1;
+}
+
+struct Arena {
+    TaskHandle_t owner;
+    uint32_t top;       // Bump pointer (offset into data)
+    uint32_t peak;
+    uint32_t live;      // Blocks not yet freed
+    alignas(8) uint8_t data[JSON_ARENA_SIZE];
+
+    bool owns(const void* ptr) const {
+        const uint8_t* p = static_cast<const uint8_t*>(ptr);
+        return p >= data && p < data + JSON_ARENA_SIZE;
+    }
+
+    bool isTop(void* ptr) const {
+        return static_cast<uint8_t*>(ptr) + headerOf(ptr)->size == data + top;
+    }
+
+    void* allocate(size_t size) {
+        size = alignUp(size);
+        if (top + HEADER_SIZE + size > JSON_ARENA_SIZE) {
+            return nullptr;
+        }
+        BlockHeader* header = reinterpret_cast<BlockHeader*>(data + top);
+        header->size = size;
+        top += HEADER_SIZE + size;
+        peak = max(peak, top);
+        live++;
+        return header + 1;
+    }
+
+    void release(void* ptr) {
+        if (isTop(ptr)) {
+            top = reinterpret_cast<uint8_t*>(headerOf(ptr)) - data;
+        }
+        // Blocks below the top stay until the arena empties
+        if (--live == 0) {
+            top = 0;
+        }
+    }
+
+    // In place: any shrink, or growing the newest block while it fits
+    bool resize(void* ptr, size_t size) {
+        size = alignUp(size);
+        BlockHeader* header = headerOf(ptr);
+        if (isTop(ptr)) {
+            uint32_t start = static_cast<uint8_t*>(ptr) - data;
+            if (start + size > JSON_ARENA_SIZE) {
+                return false;
+            }
+            header->size = size;
+            top = start + size;
+            peak = max(peak, top);
+            return true;
+        }
+        return size <= header->size;
+    }
+};
+
+Arena arenas[JSON_ARENA_COUNT];
+portMUX_TYPE poolLock = portMUX_INITIALIZER_UNLOCKED;
+JsonSite* firstSite = nullptr;
+JsonSite* lastSite = nullptr;
+
+Arena* arenaForCurrentTask() {
+    TaskHandle_t self = xTaskGetCurrentTaskHandle();
+    for (Arena& arena : arenas) {
+        if (arena.owner == self) {
+            return &arena;
+        }
+    }
+
+    Arena* claimed = nullptr;
+    portENTER_CRITICAL(&poolLock);
+    for (Arena& arena : arenas) {
+        if (!arena.owner) {
+            arena.owner = self;
+            claimed = &arena;
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&poolLock);
+    return claimed;
+}
+
+// Another task's arena isn't locked against its owner, so freeing into it
+// is a caller bug; counted per site and shown in /health
+inline bool ownedByCurrentTask(const Arena* arena) {
+    return arena->owner == xTaskGetCurrentTaskHandle();
+}
+
+Arena* arenaOwning(void* ptr) {
+    for (Arena& arena : arenas) {
+        if (arena.owns(ptr)) {
+            return &arena;
+        }
+    }
+    return nullptr;
+}
+
+void* heapAllocate(size_t size) {
+    BlockHeader* header = static_cast<BlockHeader*>(malloc(HEADER_SIZE + size));
+    if (!header) {
+        return nullptr;
+    }
+    header->size = size;
+    return header + 1;
+}
+
+} // anonymous namespace
+
+JsonSite::JsonSite(const char* name)
+    : name_(name)
+    , next_(nullptr)
+    , liveBytes_(0)
+    , peakBytes_(0)
+    , heapFallbacks_(0)
+    , foreignFrees_(0) {
+    portENTER_CRITICAL(&poolLock);
+    if (lastSite) {
+        lastSite->next_ = this;
+    } else {
+        firstSite = this;
+    }
+    lastSite = this;
+    portEXIT_CRITICAL(&poolLock);
+}
+
+const JsonSite* JsonSite::first() {
+    return firstSite;
+}
+
+void JsonSite::track(int32_t delta) {
+    portENTER_CRITICAL(&poolLock);
+    liveBytes_ += delta;
+    if (liveBytes_ > (int32_t)peakBytes_) {
+        peakBytes_ = liveBytes_;
+    }
+    portEXIT_CRITICAL(&poolLock);
+}
+
+void JsonSite::count(uint32_t& counter) {
+    portENTER_CRITICAL(&poolLock);
+    counter++;
+    portEXIT_CRITICAL(&poolLock);
+}
+
+void* JsonSite::allocate(size_t size) {
+    void* ptr = nullptr;
+    Arena* arena = arenaForCurrentTask();
+    if (arena) {
+        ptr = arena->allocate(size);
+    }
+    if (!ptr) {
+        ptr = heapAllocate(size);
+        if (!ptr) {
+            return nullptr;
+        }
+        count(heapFallbacks_);
+    }
+    track(headerOf(ptr)->size);
+    return ptr;
+}
+
+void JsonSite::deallocate(void* ptr) {
+    if (!ptr) {
+        return;
+    }
+    track(-(int32_t)headerOf(ptr)->size);
+    Arena* arena = arenaOwning(ptr);
+    if (arena) {
+        if (!ownedByCurrentTask(arena)) {
+            count(foreignFrees_);
+        }
+        arena->release(ptr);
+    } else {
+        free(headerOf(ptr));
+    }
+}
+
+void* JsonSite::reallocate(void* ptr, size_t size) {
+    if (!ptr) {
+        return allocate(size);
+    }
+    uint32_t oldSize = headerOf(ptr)->size;
+
+    Arena* arena = arenaOwning(ptr);
+    if (arena) {
+        if (arena->resize(ptr, size)) {
+            if (!ownedByCurrentTask(arena)) {
+                count(foreignFrees_);
+            }
+            track((int32_t)headerOf(ptr)->size - (int32_t)oldSize);
+            return ptr;
+        }
+        // Buried under newer blocks (or the arena is full): move it
+        void* moved = allocate(size);
+        if (!moved) {
+            return nullptr;
+        }
+        memcpy(moved, ptr, min((size_t)oldSize, size));
+        deallocate(ptr);
+        return moved;
+    }
+
+    BlockHeader* header = static_cast<BlockHeader*>(realloc(headerOf(ptr), HEADER_SIZE + size));
+    if (!header) {
+        return nullptr;
+    }
+    header->size = size;
+    track((int32_t)size - (int32_t)oldSize);
+    return header + 1;
+}
+
+uint8_t getJsonArenaStats(JsonArenaStats* out) {
+    uint8_t count = 0;
+    for (const Arena& arena : arenas) {
+        out[count].task = arena.owner ? pcTaskGetName(arena.owner) : nullptr;
+        out[count].used = arena.top;
+        out[count].peak = arena.peak;
+        count++;
+    }
+    return count;
+}
+
+} // namespace lume
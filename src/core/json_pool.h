@@ -0,0 +1,77 @@
+#ifndef LUME_JSON_POOL_H
+#define LUME_JSON_POOL_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "../constants.h"
+
+namespace lume {
+
+/**
+ * JsonSite - ArduinoJson allocator for one call site, backed by task arenas
+ *
+ * Every task that builds JsonDocuments (the AsyncTCP task for HTTP and
+ * WebSocket handlers, the main loop for broadcasts and MQTT) claims one of
+ * JSON_ARENA_COUNT fixed arenas on first use. Blocks are bump-allocated
+ * from it; freeing the newest block rewinds, and once every block is freed
+ * the arena starts over from empty. Documents are short-lived and nest
+ * (the response is built while the request is still alive), so this
+ * serves them without touching the heap - days of API polling leave no
+ * fragmentation behind. A block that doesn't fit, or a task without an
+ * arena, falls back to the heap and is counted.
+ *
+ * Each site records the most memory its documents held at once, so the
+ * arena size can be checked against real use (/health). Create sites with
+ * JSON_SITE(). Sites are shared between tasks, so their counters are only
+ * touched under the pool lock. A document must be destroyed by the task
+ * that created it; arena blocks freed or resized from another task are
+ * counted as foreign frees.
+ */
+class JsonSite : public ArduinoJson::Allocator {
+public:
+    explicit JsonSite(const char* name);
+
+    void* allocate(size_t size) override;
+    void deallocate(void* ptr) override;
+    void* reallocate(void* ptr, size_t size) override;
+
+    const char* getName() const { return name_; }
+    uint32_t getPeakBytes() const { return peakBytes_; }
+    uint32_t getHeapFallbacks() const { return heapFallbacks_; }
+    uint32_t getForeignFrees() const { return foreignFrees_; }
+
+    // Registered sites, in order of first use
+    static const JsonSite* first();
+    const JsonSite* next() const { return next_; }
+
+private:
+    void track(int32_t delta);
+    void count(uint32_t& counter);
+
+    const char* name_;
+    JsonSite* next_;
+    int32_t liveBytes_;
+    uint32_t peakBytes_;
+    uint32_t heapFallbacks_;   // Blocks that went to the heap
+    uint32_t foreignFrees_;    // Arena blocks released by a task other than the owner
+};
+
+// Arena occupancy for diagnostics
+struct JsonArenaStats {
+    const char* task;   // Owning task, nullptr while unclaimed
+    uint32_t used;      // Bytes up to the bump pointer
+    uint32_t peak;      // Highest bump pointer seen
+};
+
+// Fill up to JSON_ARENA_COUNT entries; returns the count
+uint8_t getJsonArenaStats(JsonArenaStats* out);
+
+} // namespace lume
+
+// Allocator for this call site: JsonDocument doc(JSON_SITE("health"));
+#define JSON_SITE(name) ([]() -> ::lume::JsonSite* { \
+    static ::lume::JsonSite site(name); \
+    return &site; \
+}())
+
+#endif // LUME_JSON_POOL_H
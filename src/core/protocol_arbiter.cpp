@@ -0,0 +1,177 @@
+/**
+ * ProtocolArbiter implementation
+ */
+
+#include "protocol_arbiter.h"
+#include "../protocols/protocol.h"
+#include "../logging.h"
+
+namespace lume {
+
+const char* takeoverRuleToString(TakeoverRule rule) {
+    switch (rule) {
+        case TakeoverRule::Higher:        return "higher";
+        case TakeoverRule::HigherOrEqual: return "equal";
+        case TakeoverRule::Never:         return "never";
+        default:                          return "unknown";
+    }
+}
+
+bool takeoverRuleFromString(const char* str, TakeoverRule& rule) {
+    if (!str) return false;
+    if (strcmp(str, "higher") == 0) {
+        rule = TakeoverRule::Higher;
+    } else if (strcmp(str, "equal") == 0) {
+        rule = TakeoverRule::HigherOrEqual;
+    } else if (strcmp(str, "never") == 0) {
+        rule = TakeoverRule::Never;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+const char* arbiterStateToString(ArbiterState state) {
+    switch (state) {
+        case ArbiterState::Effects:  return "effects";
+        case ArbiterState::Protocol: return "protocol";
+        case ArbiterState::Handover: return "handover";
+        case ArbiterState::Release:  return "release";
+        default:                     return "unknown";
+    }
+}
+
+ProtocolArbiter::ProtocolArbiter()
+    : count_(0)
+    , owner_(-1)
+    , state_(ArbiterState::Effects)
+    , handovers_(0)
+    , output_(nullptr)
+    , fadeStartMs_(0)
+    , fadeMs_(0) {
+    memset(protocols_, 0, sizeof(protocols_));
+    memset(lastFrameMs_, 0, sizeof(lastFrameMs_));
+    memset(fadeFrom_, 0, sizeof(fadeFrom_));
+    for (uint8_t i = 0; i < MAX_PROTOCOLS; i++) {
+        policies_[i] = DEFAULT_PROTOCOL_POLICY;
+    }
+}
+
+bool ProtocolArbiter::add(IProtocol* protocol, const ProtocolPolicy& policy) {
+    if (count_ >= MAX_PROTOCOLS) {
+        return false;
+    }
+    protocols_[count_] = protocol;
+    policies_[count_] = policy;
+    lastFrameMs_[count_] = 0;
+    count_++;
+    return true;
+}
+
+int ProtocolArbiter::find(const char* name) const {
+    for (uint8_t i = 0; i < count_; i++) {
+        if (strcasecmp(protocols_[i]->name(), name) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+bool ProtocolArbiter::isLive(uint8_t index, uint32_t nowMs) const {
+    return lastFrameMs_[index] != 0 &&
+           nowMs - lastFrameMs_[index] <= policies_[index].holdMs;
+}
+
+bool ProtocolArbiter::offer(uint8_t index, uint32_t nowMs) {
+    lastFrameMs_[index] = nowMs;
+
+    if (owner_ == (int8_t)index) {
+        return true;
+    }
+    if (owner_ < 0) {
+        changeOwner(index, nowMs);
+        return true;
+    }
+
+    const ProtocolPolicy& challenger = policies_[index];
+    const ProtocolPolicy& current = policies_[owner_];
+    bool take = false;
+    switch (challenger.takeover) {
+        case TakeoverRule::Higher:
+            take = challenger.priority > current.priority;
+            break;
+        case TakeoverRule::HigherOrEqual:
+            take = challenger.priority >= current.priority;
+            break;
+        case TakeoverRule::Never:
+            break;
+    }
+
+    if (take) {
+        changeOwner(index, nowMs);
+    }
+    return take;
+}
+
+bool ProtocolArbiter::update(uint32_t nowMs) {
+    if (owner_ < 0 || (isLive(owner_, nowMs) && protocols_[owner_]->isEnabled())) {
+        return false;
+    }
+
+    // Owner's hold expired (or it was disabled): next live protocol by
+    // priority, else effects
+    int8_t next = -1;
+    for (uint8_t i = 0; i < count_; i++) {
+        if ((int8_t)i == owner_ || !isLive(i, nowMs) || !protocols_[i]->isEnabled()) continue;
+        if (next < 0 || policies_[i].priority > policies_[next].priority) {
+            next = i;
+        }
+    }
+
+    changeOwner(next, nowMs);
+    return next >= 0;
+}
+
+void ProtocolArbiter::changeOwner(int8_t index, uint32_t nowMs) {
+    int8_t previous = owner_;
+
+    if (index >= 0) {
+        LOG_INFO(LogTag::LED, "Output -> %s (priority %d)%s%s",
+                 protocols_[index]->name(), policies_[index].priority,
+                 previous >= 0 ? ", took over from " : "",
+                 previous >= 0 ? protocols_[previous]->name() : "");
+        fadeMs_ = policies_[index].fadeMs;
+    } else {
+        LOG_INFO(LogTag::LED, "Protocol %s released - returning to effects",
+                 protocols_[previous]->name());
+        fadeMs_ = policies_[previous].fadeMs;
+    }
+
+    owner_ = index;
+    handovers_++;
+
+    // Snapshot what is on the strip now so the change can crossfade
+    if (fadeMs_ > 0 && output_) {
+        memcpy(fadeFrom_, output_, sizeof(fadeFrom_));
+        fadeStartMs_ = nowMs;
+        state_ = (index >= 0) ? ArbiterState::Handover : ArbiterState::Release;
+    } else {
+        state_ = (index >= 0) ? ArbiterState::Protocol : ArbiterState::Effects;
+    }
+}
+
+void ProtocolArbiter::applyFade(CRGB* leds, uint16_t count, uint32_t nowMs) {
+    if (!isFading()) return;
+
+    uint32_t elapsed = nowMs - fadeStartMs_;
+    if (elapsed >= fadeMs_) {
+        state_ = (owner_ >= 0) ? ArbiterState::Protocol : ArbiterState::Effects;
+        return;
+    }
+
+    // leds holds the new output; blend from the snapshot toward it
+    fract8 amount = (fract8)((elapsed * 255) / fadeMs_);
+    blend(fadeFrom_, leds, leds, min(count, MAX_LED_COUNT), amount);
+}
+
+} // namespace lume
@@ -0,0 +1,117 @@
+#ifndef LUME_PROTOCOL_ARBITER_H
+#define LUME_PROTOCOL_ARBITER_H
+
+#include <FastLED.h>
+#include "../constants.h"
+
+namespace lume {
+
+class IProtocol;
+
+// Maximum registered protocols
+constexpr uint8_t MAX_PROTOCOLS = 6;
+
+// When a protocol with fresh data may take the output from the current owner
+enum class TakeoverRule : uint8_t {
+    Higher = 0,         // Only from a lower-priority owner
+    HigherOrEqual = 1,  // Also from an equal-priority owner (latest wins)
+    Never = 2           // Only when nothing owns the output
+};
+
+const char* takeoverRuleToString(TakeoverRule rule);
+bool takeoverRuleFromString(const char* str, TakeoverRule& rule);
+
+// Per-protocol arbitration settings
+struct ProtocolPolicy {
+    uint8_t priority;       // Higher wins (0-255)
+    uint16_t holdMs;        // Keep ownership this long after the last frame
+    uint16_t fadeMs;        // Crossfade when taking over / handing back (0 = cut)
+    TakeoverRule takeover;
+};
+
+constexpr ProtocolPolicy DEFAULT_PROTOCOL_POLICY = {100, 5000, 0, TakeoverRule::Higher};
+constexpr uint16_t PROTOCOL_MAX_HOLD_MS = 60000;
+constexpr uint16_t PROTOCOL_MAX_FADE_MS = 10000;
+
+enum class ArbiterState : uint8_t {
+    Effects,    // No protocol owns the output
+    Protocol,   // A protocol owns the output
+    Handover,   // Crossfading from the previous output to a new owner
+    Release     // Crossfading from the last protocol frame back to effects
+};
+
+const char* arbiterStateToString(ArbiterState state);
+
+/**
+ * ProtocolArbiter - Decides which protocol owns the LED output
+ *
+ * Replaces "first protocol with data wins": every frame is offered to the
+ * arbiter, which accepts it from the owner, lets a challenger take over per
+ * its takeover rule and priority, and releases the owner once its hold time
+ * passes without frames - handing over to the next live protocol or back to
+ * effects. Ownership changes snapshot the outgoing LEDs so the controller
+ * can crossfade instead of cutting (or flashing black).
+ *
+ * Main loop only; policies may be replaced from handlers (plain stores).
+ */
+class ProtocolArbiter {
+public:
+    ProtocolArbiter();
+
+    // Output the crossfade snapshots are taken from
+    void attachOutput(const CRGB* leds) { output_ = leds; }
+
+    // --- Registration ---
+
+    bool add(IProtocol* protocol, const ProtocolPolicy& policy);
+    uint8_t count() const { return count_; }
+    IProtocol* get(uint8_t index) const { return protocols_[index]; }
+    int find(const char* name) const;
+
+    const ProtocolPolicy& getPolicy(uint8_t index) const { return policies_[index]; }
+    void setPolicy(uint8_t index, const ProtocolPolicy& policy) { policies_[index] = policy; }
+
+    // --- Arbitration ---
+
+    // Protocol has a new frame; true if it owns the output (copy the frame)
+    bool offer(uint8_t index, uint32_t nowMs);
+
+    // Expire the owner's hold; true if ownership passed to another protocol
+    // (copy that protocol's last frame)
+    bool update(uint32_t nowMs);
+
+    // Blend the ownership-change snapshot over freshly written LEDs
+    void applyFade(CRGB* leds, uint16_t count, uint32_t nowMs);
+
+    // --- State ---
+
+    ArbiterState getState() const { return state_; }
+    bool isFading() const { return state_ == ArbiterState::Handover || state_ == ArbiterState::Release; }
+    int8_t getOwnerIndex() const { return owner_; }
+    IProtocol* getOwner() const { return owner_ >= 0 ? protocols_[owner_] : nullptr; }
+    bool isLive(uint8_t index, uint32_t nowMs) const;
+    uint32_t getLastFrameTime(uint8_t index) const { return lastFrameMs_[index]; }
+    uint32_t getHandoverCount() const { return handovers_; }
+
+private:
+    void changeOwner(int8_t index, uint32_t nowMs);
+
+    IProtocol* protocols_[MAX_PROTOCOLS];
+    ProtocolPolicy policies_[MAX_PROTOCOLS];
+    uint32_t lastFrameMs_[MAX_PROTOCOLS];
+    uint8_t count_;
+
+    int8_t owner_;
+    ArbiterState state_;
+    uint32_t handovers_;
+
+    // Crossfade
+    const CRGB* output_;
+    CRGB fadeFrom_[MAX_LED_COUNT];
+    uint32_t fadeStartMs_;
+    uint16_t fadeMs_;
+};
+
+} // namespace lume
+
+#endif // LUME_PROTOCOL_ARBITER_H
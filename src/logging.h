@@ -32,6 +32,7 @@ namespace LogTag {
     constexpr const char* WEB = "WEB";
     constexpr const char* OTA = "OTA";
     constexpr const char* STORAGE = "NVS";
+    constexpr const char* CLUSTER = "CLUSTER";
 }
 
 // Internal logging implementation
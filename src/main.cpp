@@ -32,6 +32,10 @@
 #include "core/controller.h"
 #include "visuallib/effects.h"
 #include "protocols/sacn.h"
+#include "protocols/sacn_sender.h"
+#include "protocols/cluster.h"
+#include "protocols/clock_sync.h"
+#include "protocols/realtime.h"
 #include "protocols/mqtt.h"
 
 // API handlers (modular route implementations)
@@ -40,6 +44,8 @@
 #include "api/config.h"       // System configuration management
 #include "api/status.h"       // Root & system status endpoints
 #include "api/prompt.h"       // AI prompt processing
+#include "api/protocols.h"    // Protocol arbitration policies
+#include "api/cluster.h"      // Leader/follower clustering
 
 // Network setup
 #include "network/server.h"   // Web server route registration
@@ -121,6 +127,28 @@ bool validateRgbArray(JsonArrayConst arr) {
            arr[2].is<int>();
 }
 
+// Push sACN output settings (applied by the sender on its next update)
+void applySacnOutputConfig() {
+    lume::SacnSenderConfig out;
+    out.enabled = config.sacnOutEnabled && wifiConnected;
+    out.universe = config.sacnOutUniverse;
+    out.ledStart = config.sacnOutStart;
+    out.ledCount = config.sacnOutCount;
+    out.segment = config.sacnOutSegment;
+    out.priority = config.sacnOutPriority;
+    out.destination = config.sacnOutDestination;
+    out.syncUniverse = config.sacnOutSync;
+    out.maxFps = config.sacnOutFps;
+    lume::sacnSender.configure(out);
+}
+
+// Push clock sync settings (applied by ClockSync on its next update)
+void applyClockSyncConfig() {
+    lume::ClockSyncRole role = static_cast<lume::ClockSyncRole>(config.clockSyncRole);
+    lume::clockSync.configure(wifiConnected ? role : lume::ClockSyncRole::Off, config.clockSyncServer);
+    lume::controller.setLockstep(config.effectLockstep);
+}
+
 void setup() {
     Serial.begin(115200);
     delay(1000);
@@ -169,12 +197,24 @@ void setup() {
     LOG_INFO(LogTag::LED, "Initializing LED controller...");
     lume::controller.begin(config.ledCount);
     lume::controller.setBrightness(config.defaultBrightness);
+    lume::controller.setShowOnArrival(config.protocolShowOnArrival);
+    lume::controller.setJitterBuffer(config.protocolJitterMs, config.protocolInterpolate);
+    lume::controller.setTimeSource(lume::sharedTimeUs);
+    applyClockSyncConfig();
     
     // Register protocols with controller
     lume::controller.registerProtocol(&lume::sacnProtocol);
+    lume::controller.registerProtocol(&lume::clusterProtocol);
+    lume::wsPixelProtocol.begin();
+    lume::controller.registerProtocol(&lume::wsPixelProtocol);
+    lume::httpPixelProtocol.begin();
+    lume::controller.registerProtocol(&lume::httpPixelProtocol);
+    restoreProtocolPolicies();
+    restoreClusterConfig();
     
-    // Initialize MQTT if configured
-    if (config.mqttEnabled && config.mqttBroker.length() > 0) {
+    // Initialize MQTT (its task starts once a broker is configured, here
+    // or later from the settings API)
+    {
         lume::MqttConfig mqttConfig;
         mqttConfig.enabled = config.mqttEnabled;
         mqttConfig.broker = config.mqttBroker;
@@ -182,6 +222,8 @@ void setup() {
         mqttConfig.username = config.mqttUsername;
         mqttConfig.password = config.mqttPassword;
         mqttConfig.topicPrefix = config.mqttTopicPrefix;
+        mqttConfig.groups = config.mqttGroups;
+        mqttConfig.groupPrefix = config.mqttGroupPrefix;
         lume::mqtt.begin(mqttConfig, &lume::controller);
     }
     
@@ -225,7 +267,12 @@ void loop() {
     // Protocol handling is now integrated into the controller's update cycle
     lume::controller.update();
     
-    // MQTT update (handles reconnection and message processing)
+    // sACN output and cluster leader (send the frame just shown)
+    lume::sacnSender.update();
+    lume::cluster.update();
+    lume::clockSync.update();
+    
+    // MQTT state publishing (the connection runs on its own task)
     lume::mqtt.update();
 
     // Web server maintenance (WebSocket broadcasts/cleanup)
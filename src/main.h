@@ -29,6 +29,12 @@ extern bool webUiAvailable;
 // Setup Functions
 // ===========================================================================
 
+// Push the sACN output settings from config to the sender (any task)
+void applySacnOutputConfig();
+
+// Push the clock sync role and lockstep setting from config (any task)
+void applyClockSyncConfig();
+
 // ===========================================================================
 // Authentication & Security
 // ===========================================================================
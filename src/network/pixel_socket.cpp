@@ -0,0 +1,102 @@
+#include "pixel_socket.h"
+#include "../main.h"
+#include "../constants.h"
+#include "../logging.h"
+#include "../protocols/realtime.h"
+
+static AsyncWebSocket pixelWs("/ws/pixels");
+
+// Message being received; large messages arrive in several chunks.
+// One sender at a time is expected - chunks of another client's message
+// in the middle of this one are ignored.
+struct PixelMessage {
+    uint32_t clientId;
+    bool valid;
+    bool delta;
+    bool show;
+    uint32_t byteOffset;    // Staging position of the first RGB byte
+};
+static PixelMessage current = {0, false, false, false, 0};
+
+static inline uint16_t getLe16(const uint8_t* p) {
+    return p[0] | ((uint16_t)p[1] << 8);
+}
+
+static void handlePixelData(AsyncWebSocketClient* client, AwsFrameInfo* info, uint8_t* data, size_t len) {
+    // Browsers send each message as one WebSocket frame; continuations aren't supported
+    if (info->num != 0 || !info->final || info->opcode != WS_BINARY) {
+        return;
+    }
+
+    if (info->index == 0) {
+        current.clientId = client->id();
+        current.valid = false;
+        if (len < PIXEL_SOCKET_HEADER_SIZE) {
+            return;
+        }
+        uint16_t offset = getLe16(data + 2);
+        uint16_t count = getLe16(data + 4);
+        if (data[0] > PIXEL_SOCKET_TYPE_DELTA || (uint32_t)offset + count > MAX_LED_COUNT ||
+            info->len != PIXEL_SOCKET_HEADER_SIZE + (uint64_t)count * 3) {
+            return;
+        }
+        current.valid = true;
+        current.delta = data[0] == PIXEL_SOCKET_TYPE_DELTA;
+        current.show = data[1] & PIXEL_SOCKET_FLAG_SHOW;
+        current.byteOffset = offset * 3;
+        lume::wsPixelProtocol.notePacket();
+
+        data += PIXEL_SOCKET_HEADER_SIZE;
+        len -= PIXEL_SOCKET_HEADER_SIZE;
+        lume::wsPixelProtocol.writeBytes(current.byteOffset, data, len, current.delta);
+    } else {
+        if (!current.valid || current.clientId != client->id()) {
+            return;
+        }
+        uint32_t position = info->index - PIXEL_SOCKET_HEADER_SIZE;
+        lume::wsPixelProtocol.writeBytes(current.byteOffset + position, data, len, current.delta);
+    }
+
+    // Chunks go straight into the staging buffer; publish on the last one
+    if (info->index + len + (info->index == 0 ? PIXEL_SOCKET_HEADER_SIZE : 0) >= info->len) {
+        current.valid = false;
+        if (current.show) {
+            lume::wsPixelProtocol.commit();
+        }
+    }
+}
+
+static void handlePixelSocketEvent(AsyncWebSocket* socket, AsyncWebSocketClient* client, AwsEventType type,
+                                   void* arg, uint8_t* data, size_t len) {
+    switch (type) {
+        case WS_EVT_CONNECT:
+            if (socket->count() > PIXEL_SOCKET_MAX_CLIENTS) {
+                client->close(1013, "Too many pixel senders");
+                return;
+            }
+            LOG_INFO(LogTag::WEB, "Pixel sender %lu connected", (unsigned long)client->id());
+            break;
+        case WS_EVT_DISCONNECT:
+            if (current.clientId == client->id()) {
+                current.valid = false;
+            }
+            LOG_INFO(LogTag::WEB, "Pixel sender %lu disconnected", (unsigned long)client->id());
+            break;
+        case WS_EVT_DATA:
+            handlePixelData(client, static_cast<AwsFrameInfo*>(arg), data, len);
+            break;
+        default:
+            break;
+    }
+}
+
+void setupPixelSocket(AsyncWebServer& server) {
+    // Same token as the HTTP API; browsers pass it as ?token=
+    pixelWs.setFilter(checkAuth);
+    pixelWs.onEvent(handlePixelSocketEvent);
+    server.addHandler(&pixelWs);
+}
+
+void loopPixelSocket() {
+    pixelWs.cleanupClients();
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <ESPAsyncWebServer.h>
+
+// Realtime pixel input over a binary WebSocket (/ws/pixels).
+// Each binary message (little-endian):
+//   0  type      1   0 = raw RGB, 1 = XOR delta against the current frame
+//   1  flags     1   bit 0: last message of the frame (show it)
+//   2  offset    2   first pixel
+//   4  count     2   pixels in this message
+//   6  RGB data      count * 3 bytes
+// Messages feed the "WebSocket" protocol: the controller shows the frames
+// and falls back to effects when they stop (arbitration policy hold time).
+constexpr uint16_t PIXEL_SOCKET_HEADER_SIZE = 6;
+constexpr uint8_t PIXEL_SOCKET_TYPE_RAW = 0;
+constexpr uint8_t PIXEL_SOCKET_TYPE_DELTA = 1;
+constexpr uint8_t PIXEL_SOCKET_FLAG_SHOW = 0x01;
+constexpr uint8_t PIXEL_SOCKET_MAX_CLIENTS = 2;
+
+// Register the /ws/pixels handler
+void setupPixelSocket(AsyncWebServer& server);
+
+// WebSocket cleanup (call from main loop)
+void loopPixelSocket();
@@ -0,0 +1,216 @@
+#include "preview.h"
+#include "../core/controller.h"
+#include "../logging.h"
+#include "../core/json_pool.h"
+#include <ArduinoJson.h>
+
+namespace lume {
+
+// Global instance
+PreviewStream preview;
+
+static inline void putLe16(uint8_t* p, uint16_t v) {
+    p[0] = v & 0xFF;
+    p[1] = v >> 8;
+}
+
+static inline void putLe32(uint8_t* p, uint32_t v) {
+    p[0] = v & 0xFF;
+    p[1] = (v >> 8) & 0xFF;
+    p[2] = (v >> 16) & 0xFF;
+    p[3] = v >> 24;
+}
+
+PreviewStream::PreviewStream()
+    : ws_("/ws/preview")
+    , framesSent_(0)
+    , framesDropped_(0)
+    , bytesSent_(0) {
+    memset(clients_, 0, sizeof(clients_));
+    memset(sample_, 0, sizeof(sample_));
+}
+
+void PreviewStream::begin(AsyncWebServer& server) {
+    ws_.onEvent([this](AsyncWebSocket*, AsyncWebSocketClient* client, AwsEventType type,
+                       void* arg, uint8_t* data, size_t len) {
+        onEvent(client, type, arg, data, len);
+    });
+    server.addHandler(&ws_);
+}
+
+uint8_t PreviewStream::getClientCount() const {
+    uint8_t count = 0;
+    for (uint8_t i = 0; i < PREVIEW_MAX_CLIENTS; i++) {
+        if (clients_[i].id != 0) {
+            count++;
+        }
+    }
+    return count;
+}
+
+void PreviewStream::onEvent(AsyncWebSocketClient* client, AwsEventType type, void* arg,
+                            uint8_t* data, size_t len) {
+    if (type == WS_EVT_CONNECT) {
+        for (uint8_t i = 0; i < PREVIEW_MAX_CLIENTS; i++) {
+            Client& slot = clients_[i];
+            if (slot.id == 0) {
+                slot.fps = PREVIEW_DEFAULT_FPS;
+                slot.maxPixels = MAX_LED_COUNT;
+                slot.keyRequested = true;
+                slot.pixels = 0;
+                slot.lastSendMs = 0;
+                slot.id = client->id();   // Publish last: update() skips free slots
+                LOG_DEBUG(LogTag::WEB, "Preview client %lu connected", (unsigned long)client->id());
+                return;
+            }
+        }
+        LOG_WARN(LogTag::WEB, "Preview client rejected, %d already connected", PREVIEW_MAX_CLIENTS);
+        client->close(1013, "Too many preview clients");
+        return;
+    }
+
+    for (uint8_t i = 0; i < PREVIEW_MAX_CLIENTS; i++) {
+        Client& slot = clients_[i];
+        if (slot.id != client->id()) {
+            continue;
+        }
+        if (type == WS_EVT_DISCONNECT) {
+            slot.id = 0;
+        } else if (type == WS_EVT_DATA) {
+            AwsFrameInfo* info = static_cast<AwsFrameInfo*>(arg);
+            // Settings are small: only whole single-frame text messages
+            if (info->final && info->index == 0 && info->len == len && info->opcode == WS_TEXT) {
+                configure(slot, data, len);
+            }
+        }
+        return;
+    }
+}
+
+void PreviewStream::configure(Client& slot, const uint8_t* data, size_t len) {
+    JsonDocument doc(JSON_SITE("ws.preview.config"));
+    if (deserializeJson(doc, data, len)) {
+        return;
+    }
+    if (doc["fps"].is<int>()) {
+        slot.fps = constrain(doc["fps"].as<int>(), 1, (int)PREVIEW_MAX_FPS);
+    }
+    if (doc["maxPixels"].is<int>()) {
+        slot.maxPixels = constrain(doc["maxPixels"].as<int>(), 1, (int)MAX_LED_COUNT);
+    }
+    if (doc["key"].as<bool>()) {
+        slot.keyRequested = true;
+    }
+}
+
+void PreviewStream::update() {
+    ws_.cleanupClients();
+    if (ws_.count() == 0) {
+        return;
+    }
+
+    uint32_t now = millis();
+    uint32_t frame = controller.getFrame();
+
+    for (uint8_t i = 0; i < PREVIEW_MAX_CLIENTS; i++) {
+        Client& slot = clients_[i];
+        uint32_t id = slot.id;
+        uint32_t elapsed = now - slot.lastSendMs;
+        // Unchanged frames are refreshed once a second (power off, brightness)
+        if (id == 0 || elapsed < 1000u / slot.fps || (frame == slot.lastFrame && elapsed < 1000)) {
+            continue;
+        }
+        AsyncWebSocketClient* client = ws_.client(id);
+        if (!client) {
+            continue;
+        }
+
+        uint16_t pixels = sample(slot.maxPixels);
+        bool key = slot.keyRequested || pixels != slot.pixels;
+        size_t size = encode(slot, pixels, key, frame);
+
+        // Drop rather than queue behind a slow client; the next delta is
+        // against prev, which is what the client last received
+        AsyncClient* tcp = client->client();
+        if (client->queueIsFull() || !tcp || tcp->space() < min(size, PREVIEW_MIN_SEND_SPACE)) {
+            slot.lastSendMs = now;
+            framesDropped_++;
+            continue;
+        }
+
+        client->binary(message_, size);
+        memcpy(slot.prev, sample_, pixels * 3);
+        slot.pixels = pixels;
+        slot.keyRequested = false;
+        slot.lastFrame = frame;
+        slot.lastSendMs = now;
+        framesSent_++;
+        bytesSent_ += size;
+    }
+}
+
+uint16_t PreviewStream::sample(uint16_t maxPixels) {
+    const CRGB* leds = controller.getLeds();
+    uint16_t ledCount = controller.getLedCount();
+    uint8_t brightness = controller.getPower() ? controller.getBrightness() : 0;
+    uint16_t pixels = min(ledCount, maxPixels);
+
+    for (uint16_t i = 0; i < pixels; i++) {
+        // Average the LEDs that fold into this preview pixel
+        uint16_t from = (uint32_t)i * ledCount / pixels;
+        uint16_t to = (uint32_t)(i + 1) * ledCount / pixels;
+        uint32_t r = 0, g = 0, b = 0;
+        for (uint16_t j = from; j < to; j++) {
+            r += leds[j].r;
+            g += leds[j].g;
+            b += leds[j].b;
+        }
+        uint16_t n = to - from;
+        uint8_t* out = sample_ + i * 3;
+        out[0] = scale8(r / n, brightness);
+        out[1] = scale8(g / n, brightness);
+        out[2] = scale8(b / n, brightness);
+    }
+    return pixels;
+}
+
+size_t PreviewStream::encode(const Client& slot, uint16_t pixels, bool key, uint32_t frame) {
+    message_[0] = key ? PREVIEW_TYPE_KEY : PREVIEW_TYPE_DELTA;
+    message_[1] = 0;
+    putLe16(message_ + 2, pixels);
+    putLe32(message_ + 4, frame);
+
+    const size_t n = pixels * 3;
+    auto delta = [&](size_t i) -> uint8_t {
+        return key ? sample_[i] : sample_[i] ^ slot.prev[i];
+    };
+
+    size_t out = PREVIEW_HEADER_SIZE;
+    size_t i = 0;
+    while (i < n) {
+        size_t run = 0;
+        while (i + run < n && run < 128 && delta(i + run) == 0) {
+            run++;
+        }
+        if (run > 0) {
+            message_[out++] = 0x80 | (run - 1);
+            i += run;
+            continue;
+        }
+
+        // Literal run; a lone zero is cheaper to carry than to split on
+        size_t header = out++;
+        size_t count = 0;
+        while (i < n && count < 128) {
+            if (delta(i) == 0 && (i + 1 >= n || delta(i + 1) == 0)) {
+                break;
+            }
+            message_[out++] = delta(i++);
+            count++;
+        }
+        message_[header] = count - 1;
+    }
+    return out;
+}
+
+} // namespace lume
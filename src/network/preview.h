@@ -0,0 +1,87 @@
+#pragma once
+
+#include <ESPAsyncWebServer.h>
+#include "../constants.h"
+
+namespace lume {
+
+// Preview frame format (binary WebSocket message, little-endian):
+//   0  type       1   0 = key frame, 1 = delta against the previous frame sent
+//   1  reserved   1
+//   2  pixels     2   RGB pixels in this frame (after downsampling)
+//   4  frame      4   controller frame number
+//   8  runs           pixels * 3 bytes, XORed with the previous frame (black
+//                     for key frames), run-length coded:
+//                       0x80 | n  -> n + 1 zero bytes (unchanged)
+//                       n         -> n + 1 literal bytes follow
+// A client configures its stream with a text message:
+//   {"fps": 1-30, "maxPixels": 1-1000, "key": true}
+constexpr uint8_t PREVIEW_MAX_CLIENTS = 3;
+constexpr uint8_t PREVIEW_DEFAULT_FPS = 10;
+constexpr uint8_t PREVIEW_MAX_FPS = 30;
+constexpr uint16_t PREVIEW_HEADER_SIZE = 8;
+constexpr uint8_t PREVIEW_TYPE_KEY = 0;
+constexpr uint8_t PREVIEW_TYPE_DELTA = 1;
+constexpr size_t PREVIEW_MAX_MESSAGE = PREVIEW_HEADER_SIZE + MAX_LED_COUNT * 3 + (MAX_LED_COUNT * 3) / 128 + 1;
+constexpr size_t PREVIEW_MIN_SEND_SPACE = 1460;   // One TCP segment free before queueing a frame
+
+/**
+ * PreviewStream - Live pixel preview over a binary WebSocket (/ws/preview)
+ *
+ * Sends each client what the strip shows (after brightness), downsampled
+ * to the client's maxPixels at the client's rate. Frames are coded as XOR
+ * against the last frame that client was sent, then run-length coded, so
+ * static or slowly changing output costs a few bytes per frame.
+ *
+ * Backpressure is per client: a frame is only queued if the socket can
+ * take it now. Otherwise it's dropped (and counted); the next frame is
+ * still a delta against the last one actually sent, so nothing resyncs.
+ *
+ * WebSocket events arrive on the AsyncTCP task and only touch the client
+ * slots; update() (main loop, reads the LED array) does all the sending.
+ */
+class PreviewStream {
+public:
+    PreviewStream();
+
+    void begin(AsyncWebServer& server);
+    void update();
+
+    // --- Diagnostics ---
+
+    uint8_t getClientCount() const;
+    uint32_t getFramesSent() const { return framesSent_; }
+    uint32_t getFramesDropped() const { return framesDropped_; }
+    uint32_t getBytesSent() const { return bytesSent_; }
+
+private:
+    struct Client {
+        volatile uint32_t id;       // 0 = free slot
+        volatile uint8_t fps;
+        volatile uint16_t maxPixels;
+        volatile bool keyRequested;
+        uint16_t pixels;            // Pixel count of prev (0 = nothing sent yet)
+        uint32_t lastFrame;
+        uint32_t lastSendMs;
+        uint8_t prev[MAX_LED_COUNT * 3];
+    };
+
+    AsyncWebSocket ws_;
+    Client clients_[PREVIEW_MAX_CLIENTS];
+    uint8_t sample_[MAX_LED_COUNT * 3];
+    uint8_t message_[PREVIEW_MAX_MESSAGE];
+
+    uint32_t framesSent_;
+    uint32_t framesDropped_;
+    uint32_t bytesSent_;
+
+    void onEvent(AsyncWebSocketClient* client, AwsEventType type, void* arg, uint8_t* data, size_t len);
+    void configure(Client& slot, const uint8_t* data, size_t len);
+    uint16_t sample(uint16_t maxPixels);
+    size_t encode(const Client& slot, uint16_t pixels, bool key, uint32_t frame);
+};
+
+// Global instance
+extern PreviewStream preview;
+
+} // namespace lume
@@ -2,6 +2,8 @@
 #include "../main.h"
 #include "../constants.h"
 #include "../logging.h"
+#include "../core/json_pool.h"
+#include "../api/json_response.h"
 #include "../lume.h"
 #include "../storage.h"
 #include "../protocols/sacn.h"
@@ -9,6 +11,13 @@
 #include "../api/status.h"
 #include "../api/config.h"
 #include "../api/pixels.h"
+#include "../api/protocols.h"
+#include "../api/cluster.h"
+#include "../api/state.h"
+#include "preview.h"
+#include "pixel_socket.h"
+#include "state_socket.h"
+#include "web_assets.h"
 #include <ArduinoJson.h>
 #include <LittleFS.h>
 
@@ -37,10 +46,6 @@ extern Config config;
 extern bool wifiConnected;
 extern bool webUiAvailable;
 
-static AsyncWebSocket ws("/ws");
-static unsigned long lastWsBroadcast = 0;
-constexpr uint32_t WS_BROADCAST_INTERVAL_MS = 1000;
-
 static String contentTypeFromPath(const String& path) {
     if (path.endsWith(".html")) return "text/html; charset=utf-8";
     if (path.endsWith(".css")) return "text/css; charset=utf-8";
@@ -53,126 +58,21 @@ static String contentTypeFromPath(const String& path) {
     return "application/octet-stream";
 }
 
-static void appendColorArray(JsonArray& arr, const CRGB& color) {
-    arr.add(color.r);
-    arr.add(color.g);
-    arr.add(color.b);
-}
-
-static void buildControllerState(JsonDocument& doc) {
-    doc["type"] = "state";
-
-    JsonObject controllerJson = doc["controller"].to<JsonObject>();
-    controllerJson["power"] = lume::controller.getPower();
-    controllerJson["brightness"] = lume::controller.getBrightness();
-    controllerJson["ledCount"] = lume::controller.getLedCount();
-
-    JsonArray segmentsArr = doc["segments"].to<JsonArray>();
-    uint8_t segCount = lume::controller.getSegmentCount();
-    for (uint8_t i = 0; i < segCount; i++) {
-        lume::Segment* seg = lume::controller.getSegment(i);
-        if (!seg) {
-            continue;
-        }
-
-        JsonObject segObj = segmentsArr.add<JsonObject>();
-        segObj["id"] = seg->getId();
-        segObj["start"] = seg->getStart();
-        segObj["length"] = seg->getLength();
-        segObj["reverse"] = seg->isReversed();
-        segObj["effect"] = seg->getEffectId();
-
-        // Serialize schema-based params if effect has schema
-        const lume::EffectInfo* effectInfo = seg->getEffect();
-        if (effectInfo && effectInfo->hasSchema()) {
-            const lume::ParamSchema* schema = effectInfo->schema;
-            const lume::ParamValues& paramValues = seg->getParamValues();
-            
-            JsonObject paramsObj = segObj["params"].to<JsonObject>();
-            for (uint8_t i = 0; i < schema->count && i < lume::MAX_EFFECT_PARAMS; i++) {
-                const lume::ParamDesc& desc = schema->params[i];
-                
-                switch (desc.type) {
-                    case lume::ParamType::Int:
-                        paramsObj[desc.id] = paramValues.getInt(i);
-                        break;
-                    case lume::ParamType::Float:
-                        paramsObj[desc.id] = paramValues.getFloat(i);
-                        break;
-                    case lume::ParamType::Color: {
-                        CRGB c = paramValues.getColor(i);
-                        JsonArray colorArr = paramsObj[desc.id].to<JsonArray>();
-                        colorArr.add(c.r);
-                        colorArr.add(c.g);
-                        colorArr.add(c.b);
-                        break;
-                    }
-                    case lume::ParamType::Bool:
-                        paramsObj[desc.id] = paramValues.getBool(i);
-                        break;
-                    case lume::ParamType::Enum:
-                        paramsObj[desc.id] = paramValues.getEnum(i);
-                        break;
-                    case lume::ParamType::Palette:
-                        break;
-                }
-            }
-        }
-    }
-}
-
-static bool buildUiStatePayload(String& payload) {
-    JsonDocument doc;
-    buildControllerState(doc);
-    payload.clear();
-    serializeJson(doc, payload);
-    return payload.length() > 0;
-}
-
-static void sendStateToClient(AsyncWebSocketClient* client) {
-    if (!client) {
-        return;
-    }
-    String payload;
-    if (buildUiStatePayload(payload)) {
-        client->text(payload);
-    }
-}
-
-static void broadcastUiState() {
-    if (ws.count() == 0) {
-        return;
-    }
-    String payload;
-    if (buildUiStatePayload(payload)) {
-        ws.textAll(payload);
-    }
-}
-
-static void handleWsEvent(AsyncWebSocket*, AsyncWebSocketClient* client, AwsEventType type, void*, uint8_t*, size_t) {
-    if (type == WS_EVT_CONNECT) {
-        sendStateToClient(client);
-    }
-}
-
 void setupServer() {
-    ws.onEvent(handleWsEvent);
-    server.addHandler(&ws);
+    setupStateSocket(server);
+    lume::preview.begin(server);
+    setupPixelSocket(server);
 
-    if (webUiAvailable) {
-        server.serveStatic("/assets/", LittleFS, "/assets/")
-            .setCacheControl("public, max-age=604800");
-        LOG_INFO(LogTag::WEB, "Serving UI assets from LittleFS");
-    } else {
-        LOG_WARN(LogTag::WEB, "LittleFS not mounted; UI assets unavailable");
-    }
+    // UI files: embedded bundle first, LittleFS for overrides and extras
+    // (both through the 404 handler below)
+    setupWebAssets();
 
     // Serve main page
     server.on("/", HTTP_GET, handleRoot);
     
     // Health check endpoint - lightweight for monitoring
     server.on("/health", HTTP_GET, [](AsyncWebServerRequest* request) {
-        JsonDocument doc;
+        JsonDocument doc(JSON_SITE("health"));
         
         // Core health indicators
         doc["status"] = "healthy";
@@ -209,9 +109,36 @@ void setupServer() {
         components["mqtt_enabled"] = config.mqttEnabled;
         components["mqtt_connected"] = lume::mqtt.isConnected();
         
-        String response;
-        serializeJson(doc, response);
-        request->send(200, "application/json", response);
+        // sACN reception totals (detail lives in /api/status)
+        lume::SacnCounters sacnTotals = lume::sacnProtocol.getTotals();
+        JsonObject sacn = doc["sacn"].to<JsonObject>();
+        sacn["received"] = sacnTotals.received;
+        sacn["out_of_order"] = sacnTotals.outOfOrder;
+        sacn["lost"] = sacnTotals.lost;
+        sacn["preview"] = sacnTotals.preview;
+        sacn["terminated"] = sacnTotals.terminated;
+        
+        // JsonDocument arenas and the peak each call site needed
+        JsonObject json = doc["json"].to<JsonObject>();
+        json["arena_size"] = JSON_ARENA_SIZE;
+        JsonArray arenas = json["arenas"].to<JsonArray>();
+        lume::JsonArenaStats arenaStats[JSON_ARENA_COUNT];
+        uint8_t arenaCount = lume::getJsonArenaStats(arenaStats);
+        for (uint8_t i = 0; i < arenaCount; i++) {
+            JsonObject arena = arenas.add<JsonObject>();
+            arena["task"] = arenaStats[i].task;
+            arena["used"] = arenaStats[i].used;
+            arena["peak"] = arenaStats[i].peak;
+        }
+        JsonObject sites = json["sites"].to<JsonObject>();
+        for (const lume::JsonSite* site = lume::JsonSite::first(); site; site = site->next()) {
+            JsonObject entry = sites[site->getName()].to<JsonObject>();
+            entry["peak"] = site->getPeakBytes();
+            entry["heap_fallbacks"] = site->getHeapFallbacks();
+            entry["foreign_frees"] = site->getForeignFrees();
+        }
+        
+        sendJsonResponse(request, 200, std::move(doc));
     });
     
     // API endpoints
@@ -234,7 +161,7 @@ void setupServer() {
     
     // Segment management endpoints (v2 architecture)
     server.on("/api/segments", HTTP_GET, [](AsyncWebServerRequest* request) {
-        JsonDocument doc;
+        JsonDocument doc(JSON_SITE("api.segments"));
         
         // Global state
         doc["power"] = lume::controller.getPower();
@@ -332,9 +259,7 @@ void setupServer() {
             effObj["usesPalette"] = info->usesPalette();
         }
         
-        String response;
-        serializeJson(doc, response);
-        request->send(200, "application/json", response);
+        sendJsonResponse(request, 200, std::move(doc));
     });
     
     // Nightlight endpoints
@@ -417,6 +342,30 @@ void setupServer() {
         }
     });
     
+    // Protocol arbitration (ownership, priorities, hold/fade policies)
+    server.on("/api/v2/protocols", HTTP_GET, handleApiV2ProtocolsGet);
+    server.on("/api/v2/protocols", HTTP_PUT,
+        [](AsyncWebServerRequest* request) {},
+        NULL,
+        handleApiV2ProtocolsUpdate
+    );
+    
+    // Leader/follower clustering
+    server.on("/api/v2/cluster", HTTP_GET, handleApiV2ClusterGet);
+    server.on("/api/v2/cluster", HTTP_PUT,
+        [](AsyncWebServerRequest* request) {},
+        NULL,
+        handleApiV2ClusterUpdate
+    );
+    
+    // Bulk state changes, applied in one frame
+    server.on("/api/v2/state", HTTP_PATCH,
+        [](AsyncWebServerRequest* request) {},
+        NULL,
+        handleApiV2StatePatch
+    );
+    server.on("/api/v2/state/patches", HTTP_GET, handleApiV2StatePatchGet);
+    
     // Effects and palettes metadata
     server.on("/api/v2/effects", HTTP_GET, handleApiV2EffectsList);
     server.on("/api/v2/palettes", HTTP_GET, handleApiV2PalettesList);
@@ -428,7 +377,7 @@ void setupServer() {
     server.on("/api/*", HTTP_OPTIONS, [](AsyncWebServerRequest* request) {
         AsyncWebServerResponse* response = request->beginResponse(200);
         response->addHeader("Access-Control-Allow-Origin", "*");
-        response->addHeader("Access-Control-Allow-Methods", "GET, POST, DELETE, OPTIONS");
+        response->addHeader("Access-Control-Allow-Methods", "GET, POST, PUT, PATCH, DELETE, OPTIONS");
         response->addHeader("Access-Control-Allow-Headers", "Content-Type, Authorization, X-API-Key");
         request->send(response);
     });
@@ -441,11 +390,6 @@ void setupServer() {
             return;
         }
 
-        if (!webUiAvailable) {
-            request->send(404, "text/plain", "Not found");
-            return;
-        }
-
         if (path.length() == 0) {
             path = "/";
         }
@@ -456,15 +400,23 @@ void setupServer() {
             path += "index.html";
         }
 
-        if (LittleFS.exists(path)) {
+        if (serveWebAsset(request, path)) {
+            return;
+        }
+        if (webUiAvailable && LittleFS.exists(path)) {
             request->send(LittleFS, path, contentTypeFromPath(path));
             return;
         }
 
         // SPA fallback: serve index for client-side routes without extensions
-        if (path.indexOf('.') < 0 && LittleFS.exists("/index.html")) {
-            request->send(LittleFS, "/index.html", "text/html; charset=utf-8");
-            return;
+        if (path.indexOf('.') < 0) {
+            if (serveWebAsset(request, "/index.html")) {
+                return;
+            }
+            if (webUiAvailable && LittleFS.exists("/index.html")) {
+                request->send(LittleFS, "/index.html", "text/html; charset=utf-8");
+                return;
+            }
         }
 
         request->send(404, "text/plain", "Not found");
@@ -477,15 +429,8 @@ void setupServer() {
 }
 
 void loopServer() {
-    ws.cleanupClients();
-
-    if (ws.count() == 0) {
-        return;
-    }
-
-    unsigned long now = millis();
-    if (now - lastWsBroadcast >= WS_BROADCAST_INTERVAL_MS) {
-        broadcastUiState();
-        lastWsBroadcast = now;
-    }
+    lume::preview.update();
+    loopPixelSocket();
+    applyPendingStatePatch();
+    loopStateSocket();
 }
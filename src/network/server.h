@@ -5,5 +5,5 @@
 // Setup web server routes and handlers
 void setupServer();
 
-// Periodic maintenance tasks (WebSocket cleanup, broadcast)
+// Periodic maintenance tasks (WebSocket cleanup, broadcast, live preview)
 void loopServer();
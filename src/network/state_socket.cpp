@@ -0,0 +1,607 @@
+#include "state_socket.h"
+#include "../main.h"
+#include "../core/json_pool.h"
+#include "../lume.h"
+#include "../storage.h"
+#include "../api/param_json.h"
+#include <ArduinoJson.h>
+
+static AsyncWebSocket stateWs("/ws");
+
+// What the UI sees of one segment (slot = segment id)
+struct SegmentSnapshot {
+    bool present;
+    bool reverse;
+    uint16_t start;
+    uint16_t length;
+    const lume::EffectInfo* effect;
+    lume::ParamValues params;
+};
+
+struct StateSnapshot {
+    bool power;
+    uint8_t brightness;
+    uint16_t ledCount;
+    SegmentSnapshot segments[lume::MAX_SEGMENTS];
+};
+
+// Main loop: state at stateVersion
+static StateSnapshot current;
+static volatile uint32_t stateVersion = 0;
+
+// State clients were last sent (deltas apply to it); guarded by pushLock
+// because connecting clients are sent it from the AsyncTCP task
+static StateSnapshot pushed;
+static uint32_t pushedVersion = 0;
+static portMUX_TYPE pushLock = portMUX_INITIALIZER_UNLOCKED;
+
+static bool initialized = false;
+static uint32_t lastPushMs = 0;
+
+// Command batches queued but not yet run by the main loop. The AsyncTCP
+// task appends, the main loop removes.
+struct PendingAck {
+    uint32_t clientId;
+    uint32_t seq;
+    uint32_t pass;      // Controller command pass count read after enqueueing
+};
+static PendingAck pendingAcks[STATE_SOCKET_MAX_PENDING_ACKS];
+static volatile uint8_t pendingAckCount = 0;
+static portMUX_TYPE ackLock = portMUX_INITIALIZER_UNLOCKED;
+
+// Connected clients and what they negotiated. The AsyncTCP task adds and
+// removes entries, the main loop reads them when sending.
+struct SocketClient {
+    uint32_t id;        // 0 = free slot (client ids start at 1)
+    bool control;       // Passed checkAuth when connecting
+    bool msgpack;       // Connected with ?format=msgpack
+};
+static SocketClient clients[STATE_SOCKET_MAX_CLIENTS];
+static portMUX_TYPE clientLock = portMUX_INITIALIZER_UNLOCKED;
+
+static void captureState(StateSnapshot& snap) {
+    snap = StateSnapshot();
+    snap.power = lume::controller.getPower();
+    snap.brightness = lume::controller.getBrightness();
+    snap.ledCount = lume::controller.getLedCount();
+
+    for (uint8_t id = 0; id < lume::MAX_SEGMENTS; id++) {
+        lume::Segment* seg = lume::controller.getSegment(id);
+        if (!seg) {
+            continue;
+        }
+        SegmentSnapshot& s = snap.segments[id];
+        s.present = true;
+        s.reverse = seg->isReversed();
+        s.start = seg->getStart();
+        s.length = seg->getLength();
+        s.effect = seg->getEffect();
+        s.params = seg->getParamValues();
+    }
+}
+
+// Slots are unions: compare only the member the schema says is in use
+static bool paramEquals(const lume::ParamDesc& desc, const lume::ParamValues& a,
+                        const lume::ParamValues& b, uint8_t i) {
+    switch (desc.type) {
+        case lume::ParamType::Int:   return a.getInt(i) == b.getInt(i);
+        case lume::ParamType::Float: return a.getFloat(i) == b.getFloat(i);
+        case lume::ParamType::Color: return a.getColor(i) == b.getColor(i);
+        case lume::ParamType::Bool:  return a.getBool(i) == b.getBool(i);
+        case lume::ParamType::Enum:  return a.getEnum(i) == b.getEnum(i);
+        default:                     return true;
+    }
+}
+
+static void writeParam(JsonObject params, const lume::ParamDesc& desc, const lume::ParamValues& values, uint8_t i) {
+    switch (desc.type) {
+        case lume::ParamType::Int:
+            params[desc.id] = values.getInt(i);
+            break;
+        case lume::ParamType::Float:
+            params[desc.id] = values.getFloat(i);
+            break;
+        case lume::ParamType::Color: {
+            CRGB c = values.getColor(i);
+            JsonArray colorArr = params[desc.id].to<JsonArray>();
+            colorArr.add(c.r);
+            colorArr.add(c.g);
+            colorArr.add(c.b);
+            break;
+        }
+        case lume::ParamType::Bool:
+            params[desc.id] = values.getBool(i);
+            break;
+        case lume::ParamType::Enum:
+            params[desc.id] = values.getEnum(i);
+            break;
+        case lume::ParamType::Palette:
+            break;
+    }
+}
+
+static const lume::ParamSchema* schemaOf(const SegmentSnapshot& seg) {
+    return seg.effect && seg.effect->hasSchema() ? seg.effect->schema : nullptr;
+}
+
+static uint8_t paramCount(const lume::ParamSchema* schema) {
+    return schema ? min(schema->count, lume::MAX_EFFECT_PARAMS) : 0;
+}
+
+// Effect or range changed: the segment is sent whole
+static bool layoutChanged(const SegmentSnapshot& seg, const SegmentSnapshot& before) {
+    return !before.present || before.effect != seg.effect || before.start != seg.start ||
+           before.length != seg.length || before.reverse != seg.reverse;
+}
+
+static bool paramsChanged(const SegmentSnapshot& seg, const SegmentSnapshot& before) {
+    const lume::ParamSchema* schema = schemaOf(seg);
+    for (uint8_t i = 0; i < paramCount(schema); i++) {
+        if (!paramEquals(schema->params[i], seg.params, before.params, i)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Whole segment, or with `before` only the params that differ from it
+static void writeSegment(JsonArray segments, uint8_t id, const SegmentSnapshot& seg,
+                         const SegmentSnapshot* before) {
+    bool whole = !before || layoutChanged(seg, *before);
+
+    JsonObject segObj = segments.add<JsonObject>();
+    segObj["id"] = id;
+    if (whole) {
+        segObj["start"] = seg.start;
+        segObj["length"] = seg.length;
+        segObj["reverse"] = seg.reverse;
+        segObj["effect"] = seg.effect ? seg.effect->id : "none";
+    }
+
+    const lume::ParamSchema* schema = schemaOf(seg);
+    if (schema) {
+        JsonObject params = segObj["params"].to<JsonObject>();
+        for (uint8_t i = 0; i < paramCount(schema); i++) {
+            if (whole || !paramEquals(schema->params[i], seg.params, before->params, i)) {
+                writeParam(params, schema->params[i], seg.params, i);
+            }
+        }
+    }
+}
+
+static void buildFullState(JsonDocument& doc, const StateSnapshot& snap, uint32_t version) {
+    doc["type"] = "state";
+    doc["version"] = version;
+
+    JsonObject controllerJson = doc["controller"].to<JsonObject>();
+    controllerJson["power"] = snap.power;
+    controllerJson["brightness"] = snap.brightness;
+    controllerJson["ledCount"] = snap.ledCount;
+
+    JsonArray segments = doc["segments"].to<JsonArray>();
+    for (uint8_t id = 0; id < lume::MAX_SEGMENTS; id++) {
+        if (snap.segments[id].present) {
+            writeSegment(segments, id, snap.segments[id], nullptr);
+        }
+    }
+}
+
+static void buildDelta(JsonDocument& doc, const StateSnapshot& from, const StateSnapshot& to,
+                       uint32_t base, uint32_t version) {
+    doc["type"] = "delta";
+    doc["version"] = version;
+    doc["base"] = base;
+
+    if (from.power != to.power || from.brightness != to.brightness || from.ledCount != to.ledCount) {
+        JsonObject controllerJson = doc["controller"].to<JsonObject>();
+        if (from.power != to.power) controllerJson["power"] = to.power;
+        if (from.brightness != to.brightness) controllerJson["brightness"] = to.brightness;
+        if (from.ledCount != to.ledCount) controllerJson["ledCount"] = to.ledCount;
+    }
+
+    JsonArray segments = doc["segments"].to<JsonArray>();
+    JsonArray removed = doc["removed"].to<JsonArray>();
+    for (uint8_t id = 0; id < lume::MAX_SEGMENTS; id++) {
+        const SegmentSnapshot& seg = to.segments[id];
+        if (seg.present) {
+            if (layoutChanged(seg, from.segments[id]) || paramsChanged(seg, from.segments[id])) {
+                writeSegment(segments, id, seg, &from.segments[id]);
+            }
+        } else if (from.segments[id].present) {
+            removed.add(id);
+        }
+    }
+}
+
+// Any difference the UI can see (palette bytes and unused slot bytes aren't)
+static bool stateDiffers(const StateSnapshot& a, const StateSnapshot& b) {
+    if (a.power != b.power || a.brightness != b.brightness || a.ledCount != b.ledCount) {
+        return true;
+    }
+    for (uint8_t id = 0; id < lume::MAX_SEGMENTS; id++) {
+        const SegmentSnapshot& sa = a.segments[id];
+        const SegmentSnapshot& sb = b.segments[id];
+        if (sa.present != sb.present) {
+            return true;
+        }
+        if (sa.present && (layoutChanged(sa, sb) || paramsChanged(sa, sb))) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static SocketClient findClient(uint32_t id) {
+    SocketClient found = {};
+    portENTER_CRITICAL(&clientLock);
+    for (const SocketClient& c : clients) {
+        if (c.id == id) {
+            found = c;
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&clientLock);
+    return found;
+}
+
+static bool addClient(uint32_t id, bool control, bool msgpack) {
+    bool added = false;
+    portENTER_CRITICAL(&clientLock);
+    for (SocketClient& c : clients) {
+        if (c.id == 0) {
+            c = {id, control, msgpack};
+            added = true;
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&clientLock);
+    return added;
+}
+
+static void removeClient(uint32_t id) {
+    portENTER_CRITICAL(&clientLock);
+    for (SocketClient& c : clients) {
+        if (c.id == id) {
+            c = SocketClient();
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&clientLock);
+}
+
+// Text frame for JSON clients, binary frame for MessagePack ones
+static void sendDoc(AsyncWebSocketClient* client, const JsonDocument& doc) {
+    if (!findClient(client->id()).msgpack) {
+        String payload;
+        serializeJson(doc, payload);
+        client->text(payload);
+        return;
+    }
+    size_t size = measureMsgPack(doc);
+    uint8_t* packed = static_cast<uint8_t*>(malloc(size));
+    if (!packed) {
+        return;
+    }
+    serializeMsgPack(doc, packed, size);
+    client->binary(packed, size);      // Copied into the client's queue
+    free(packed);
+}
+
+static void sendFullState(AsyncWebSocketClient* client) {
+    // Copy under the lock, serialize outside it
+    StateSnapshot snap;
+    portENTER_CRITICAL(&pushLock);
+    snap = pushed;
+    uint32_t version = pushedVersion;
+    portEXIT_CRITICAL(&pushLock);
+
+    JsonDocument doc(JSON_SITE("ws.state"));
+    buildFullState(doc, snap, version);
+    sendDoc(client, doc);
+}
+
+static void sendAck(AsyncWebSocketClient* client, uint32_t seq, uint32_t version, const char* error = nullptr) {
+    JsonDocument doc(JSON_SITE("ws.ack"));
+    doc["type"] = "ack";
+    doc["seq"] = seq;
+    doc["version"] = version;
+    if (error) {
+        doc["error"] = error;
+    }
+    sendDoc(client, doc);
+}
+
+// Translate one command; returns the error code, or nullptr if valid.
+// batchEffects tracks effects set earlier in the batch, so params that
+// follow an effect change are checked against the new effect's schema.
+static const char* parseCommand(JsonObjectConst in, lume::Command& out, const lume::EffectInfo** batchEffects) {
+    const char* op = in["op"];
+    if (!op) {
+        return "invalid_command";
+    }
+
+    if (strcmp(op, "power") == 0) {
+        if (!in["v"].is<bool>()) return "invalid_value";
+        out = lume::Command::setPower(in["v"].as<bool>());
+        return nullptr;
+    }
+    if (strcmp(op, "brightness") == 0) {
+        if (!in["v"].is<int>()) return "invalid_value";
+        out = lume::Command::setGlobalBrightness(constrain(in["v"].as<int>(), 0, 255));
+        return nullptr;
+    }
+
+    // The rest target a segment
+    if (!in["seg"].is<int>() || in["seg"].as<int>() < 0 || in["seg"].as<int>() >= lume::MAX_SEGMENTS) {
+        return "unknown_segment";
+    }
+    uint8_t segId = in["seg"].as<uint8_t>();
+    lume::Segment* seg = lume::controller.getSegment(segId);
+    if (!seg) {
+        return "unknown_segment";
+    }
+
+    if (strcmp(op, "effect") == 0) {
+        const lume::EffectInfo* info = lume::effects().getInfo(in["id"].as<const char*>());
+        if (!info) return "unknown_effect";
+        batchEffects[segId] = info;
+        out = lume::Command::setEffect(segId, info->id);     // Registry string: outlives the queue
+        return nullptr;
+    }
+    if (strcmp(op, "palette") == 0) {
+        if (!in["v"].is<int>() || in["v"].as<int>() < 0 ||
+            in["v"].as<int>() >= static_cast<int>(lume::PalettePreset::COUNT)) {
+            return "invalid_value";
+        }
+        out = lume::Command::setPalette(segId, in["v"].as<uint8_t>());
+        return nullptr;
+    }
+    if (strcmp(op, "param") == 0) {
+        const lume::EffectInfo* info = batchEffects[segId] ? batchEffects[segId] : seg->getEffect();
+        const lume::ParamDesc* desc = info && info->hasSchema() ? info->schema->find(in["id"].as<const char*>()) : nullptr;
+        if (!desc) return "unknown_param";
+        lume::ParamValues::Slot value;
+        if (!paramFromJson(*desc, in["v"], value)) return "invalid_value";
+        out = lume::Command::setParam(segId, *desc, value);
+        return nullptr;
+    }
+    return "invalid_command";
+}
+
+// Runs on the AsyncTCP task: validate, queue, and leave the ack to the main loop
+static void handleCommandMessage(AsyncWebSocketClient* client, JsonDocument& doc) {
+    uint32_t seq = doc["seq"] | 0;
+    if (!findClient(client->id()).control) {
+        sendAck(client, seq, getStateVersion(), "unauthorized");
+        return;
+    }
+
+    lume::Command cmds[STATE_SOCKET_MAX_BATCH];
+    uint8_t count = 0;
+    const lume::EffectInfo* batchEffects[lume::MAX_SEGMENTS] = {};
+    const char* error = nullptr;
+
+    JsonArrayConst list = doc["cmds"];
+    if (list.isNull()) {
+        error = parseCommand(doc.as<JsonObjectConst>(), cmds[0], batchEffects);
+        count = 1;
+    } else if (list.size() > STATE_SOCKET_MAX_BATCH) {
+        error = "batch_too_large";
+    } else {
+        for (JsonObjectConst in : list) {
+            error = parseCommand(in, cmds[count++], batchEffects);
+            if (error) {
+                break;
+            }
+        }
+    }
+
+    // Full queues would drop older commands, possibly another client's
+    if (!error && (lume::controller.getCommandQueueSpace() < count ||
+                   pendingAckCount >= STATE_SOCKET_MAX_PENDING_ACKS)) {
+        error = "busy";
+    }
+    if (error) {
+        sendAck(client, seq, getStateVersion(), error);
+        return;
+    }
+
+    for (uint8_t i = 0; i < count; i++) {
+        lume::controller.enqueueCommand(cmds[i]);
+        if (cmds[i].type == lume::CommandType::SetEffect) {
+            storage.saveLastEffect(cmds[i].data.effectId);
+        }
+    }
+
+    // Only this task appends, so the capacity check above still holds
+    PendingAck pending = {client->id(), seq, lume::controller.getCommandPasses()};
+    portENTER_CRITICAL(&ackLock);
+    pendingAcks[pendingAckCount++] = pending;
+    portEXIT_CRITICAL(&ackLock);
+}
+
+static void handleStateMessage(AsyncWebSocketClient* client, AwsFrameInfo* info, uint8_t* data, size_t len) {
+    // Control messages are small: single frame only. Text is JSON, binary
+    // is MessagePack, whichever format the client receives in.
+    if (!info->final || info->index != 0 || info->len != len) {
+        return;
+    }
+    JsonDocument doc(JSON_SITE("ws.message"));
+    DeserializationError error;
+    if (info->opcode == WS_TEXT) {
+        error = deserializeJson(doc, data, len);
+    } else if (info->opcode == WS_BINARY) {
+        error = deserializeMsgPack(doc, data, len);
+    } else {
+        return;
+    }
+    if (error) {
+        return;
+    }
+    const char* type = doc["type"];
+    if (!type) {
+        return;
+    }
+    if (strcmp(type, "cmd") == 0) {
+        handleCommandMessage(client, doc);
+    } else if (strcmp(type, "resync") == 0) {
+        sendFullState(client);
+    }
+}
+
+static void handleStateSocketEvent(AsyncWebSocket*, AsyncWebSocketClient* client, AwsEventType type,
+                                   void* arg, uint8_t* data, size_t len) {
+    switch (type) {
+        case WS_EVT_CONNECT: {
+            // The upgrade request comes along with the connect event
+            AsyncWebServerRequest* request = static_cast<AsyncWebServerRequest*>(arg);
+            bool control = request && checkAuth(request);
+            bool msgpack = request && request->hasParam("format") &&
+                           request->getParam("format")->value() == "msgpack";
+            if (!addClient(client->id(), control, msgpack)) {
+                client->close(1013, "too many clients");
+                break;
+            }
+            sendFullState(client);
+            break;
+        }
+        case WS_EVT_DISCONNECT:
+            removeClient(client->id());
+            break;
+        case WS_EVT_DATA:
+            handleStateMessage(client, static_cast<AwsFrameInfo*>(arg), data, len);
+            break;
+        default:
+            break;
+    }
+}
+
+// Acknowledge batches the controller has run, with the version that includes them
+static void sendReadyAcks() {
+    if (pendingAckCount == 0) {
+        return;
+    }
+    uint32_t passes = lume::controller.getCommandPasses();
+
+    PendingAck ready[STATE_SOCKET_MAX_PENDING_ACKS];
+    uint8_t readyCount = 0;
+    portENTER_CRITICAL(&ackLock);
+    uint8_t kept = 0;
+    for (uint8_t i = 0; i < pendingAckCount; i++) {
+        if ((int32_t)(passes - pendingAcks[i].pass) > 0) {
+            ready[readyCount++] = pendingAcks[i];
+        } else {
+            pendingAcks[kept++] = pendingAcks[i];
+        }
+    }
+    pendingAckCount = kept;
+    portEXIT_CRITICAL(&ackLock);
+
+    if (readyCount == 0) {
+        return;
+    }
+    uint32_t version = refreshStateVersion();
+    for (uint8_t i = 0; i < readyCount; i++) {
+        AsyncWebSocketClient* client = stateWs.client(ready[i].clientId);
+        if (client) {
+            sendAck(client, ready[i].seq, version);
+        }
+    }
+}
+
+// Serialize once per format in use
+static void broadcastDoc(const JsonDocument& doc) {
+    SocketClient snapshot[STATE_SOCKET_MAX_CLIENTS];
+    bool anyMsgPack = false;
+    portENTER_CRITICAL(&clientLock);
+    for (uint8_t i = 0; i < STATE_SOCKET_MAX_CLIENTS; i++) {
+        snapshot[i] = clients[i];
+        anyMsgPack |= clients[i].id != 0 && clients[i].msgpack;
+    }
+    portEXIT_CRITICAL(&clientLock);
+
+    String payload;
+    serializeJson(doc, payload);
+    if (!anyMsgPack) {
+        stateWs.textAll(payload);
+        return;
+    }
+
+    size_t packedSize = measureMsgPack(doc);
+    uint8_t* packed = static_cast<uint8_t*>(malloc(packedSize));
+    if (packed) {
+        serializeMsgPack(doc, packed, packedSize);
+    }
+    for (const SocketClient& c : snapshot) {
+        AsyncWebSocketClient* client = c.id ? stateWs.client(c.id) : nullptr;
+        if (!client) {
+            continue;
+        }
+        if (!c.msgpack) {
+            client->text(payload);
+        } else if (packed) {
+            client->binary(packed, packedSize);
+        }
+    }
+    free(packed);
+}
+
+void setupStateSocket(AsyncWebServer& server) {
+    // Version 1 is the state at startup
+    captureState(current);
+    stateVersion = 1;
+    pushed = current;
+    pushedVersion = stateVersion;
+    initialized = true;
+
+    stateWs.onEvent(handleStateSocketEvent);
+    server.addHandler(&stateWs);
+}
+
+uint32_t refreshStateVersion() {
+    if (!initialized) {
+        return stateVersion;
+    }
+    static StateSnapshot latest;
+    captureState(latest);
+    if (stateDiffers(latest, current)) {
+        current = latest;
+        stateVersion = stateVersion + 1;
+    }
+    return stateVersion;
+}
+
+void loopStateSocket() {
+    stateWs.cleanupClients();
+    sendReadyAcks();
+
+    uint32_t now = millis();
+    if (now - lastPushMs < 1000 / STATE_SOCKET_MAX_RATE) {
+        return;
+    }
+    lastPushMs = now;
+
+    uint32_t version = refreshStateVersion();
+    if (version == pushedVersion) {
+        return;
+    }
+
+    if (stateWs.count() > 0) {
+        JsonDocument doc(JSON_SITE("ws.delta"));
+        buildDelta(doc, pushed, current, pushedVersion, version);
+        broadcastDoc(doc);
+    }
+
+    portENTER_CRITICAL(&pushLock);
+    pushed = current;
+    pushedVersion = version;
+    portEXIT_CRITICAL(&pushLock);
+}
+
+uint32_t getStateVersion() {
+    return stateVersion;
+}
+
+uint32_t getStateSocketClientCount() {
+    return stateWs.count();
+}
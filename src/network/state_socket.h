@@ -0,0 +1,56 @@
+#pragma once
+
+#include <ESPAsyncWebServer.h>
+
+// UI state over a WebSocket (/ws).
+//
+// Every change to the visible state (power, brightness, LED count, segment
+// layout, effect and params) bumps a state version. Clients get:
+//   {"type":"state","version":N,"controller":{...},"segments":[...]}
+//     on connect, and whenever they send {"type":"resync"}
+//   {"type":"delta","version":N,"base":B,"controller":{...},
+//     "segments":[{"id":0,"params":{"speed":120}}],"removed":[2]}
+//     when the state changes: only the changed fields, as absolute values
+//     (a segment whose effect or range changed is sent whole). `base` is
+//     the version the delta applies to; a client at any other version
+//     missed something and should resync.
+// Changes are pushed from the main loop at most STATE_SOCKET_MAX_RATE times
+// a second, with bursts in between coalesced. Nothing is sent while the
+// state is unchanged.
+//
+// Clients can also control the strip over the same socket:
+//   {"type":"cmd","seq":7,"cmds":[{"op":"param","seg":0,"id":"speed","v":120},
+//                                 {"op":"brightness","v":200}]}
+// (or one command inline: {"type":"cmd","seq":7,"op":"power","v":false}).
+// Ops: power (v bool), brightness (v 0-255), effect (seg, id),
+// palette (seg, v preset index), param (seg, id, v typed per the schema).
+// A batch is validated as a whole and goes onto the controller's command
+// queue, so it takes effect in one frame. Once the main loop has run it
+// the client gets {"type":"ack","seq":7,"version":N}: N is the first state
+// version that includes the batch. A rejected batch is acknowledged right
+// away with "error" set and nothing applied. With an auth token configured,
+// only clients that connected with it (?token=) may send commands.
+//
+// Connecting with ?format=msgpack switches a client to MessagePack: the
+// same messages as binary frames, and binary frames are read as
+// MessagePack input (text frames are still accepted as JSON).
+constexpr uint8_t STATE_SOCKET_MAX_RATE = 10;
+constexpr uint8_t STATE_SOCKET_MAX_BATCH = 12;          // Commands per message
+constexpr uint8_t STATE_SOCKET_MAX_PENDING_ACKS = 16;
+constexpr uint8_t STATE_SOCKET_MAX_CLIENTS = 8;         // More are closed with 1013
+
+// Register the /ws handler
+void setupStateSocket(AsyncWebServer& server);
+
+// Detect changes and push deltas (call from main loop)
+void loopStateSocket();
+
+// Current state version (any task)
+uint32_t getStateVersion();
+
+// Compare against the last version now instead of on the next push slot,
+// and return the resulting version (main loop only)
+uint32_t refreshStateVersion();
+
+// Connected /ws clients
+uint32_t getStateSocketClientCount();
@@ -0,0 +1,113 @@
+#include "web_assets.h"
+#include "web_assets_data.h"
+#include "../main.h"
+#include "../constants.h"
+#include "../logging.h"
+#include <LittleFS.h>
+#include <esp_rom_crc.h>
+
+// Bit i set: WEB_ASSETS[i] is served from LittleFS instead
+static uint32_t overrides = 0;
+
+static bool crcOfFile(const char* path, uint32_t& crc) {
+    File file = LittleFS.open(path, "r");
+    if (!file) {
+        return false;
+    }
+    uint8_t buffer[256];
+    crc = 0;
+    size_t n;
+    while ((n = file.read(buffer, sizeof(buffer))) > 0) {
+        crc = esp_rom_crc32_le(crc, buffer, n);
+    }
+    file.close();
+    return true;
+}
+
+// The gzip trailer holds the CRC of the uncompressed data: no need to inflate
+static bool crcOfGzipFile(const char* path, uint32_t& crc) {
+    File file = LittleFS.open(path, "r");
+    if (!file || file.size() < 18 || !file.seek(file.size() - 8)) {
+        return false;
+    }
+    uint8_t trailer[4];
+    bool ok = file.read(trailer, sizeof(trailer)) == sizeof(trailer);
+    file.close();
+    crc = trailer[0] | (trailer[1] << 8) | (trailer[2] << 16) | ((uint32_t)trailer[3] << 24);
+    return ok;
+}
+
+// The same lookup order as serving a LittleFS file: plain first, then .gz
+static bool overriddenOnLittleFS(const WebAsset& asset) {
+    uint32_t crc;
+    String gzPath = String(asset.path) + ".gz";
+    if (LittleFS.exists(asset.path)) {
+        return crcOfFile(asset.path, crc) && crc != asset.crc32;
+    }
+    if (LittleFS.exists(gzPath)) {
+        return crcOfGzipFile(gzPath.c_str(), crc) && crc != asset.crc32;
+    }
+    return false;
+}
+
+void setupWebAssets() {
+    overrides = 0;
+    if (webUiAvailable && LittleFS.exists(WEB_UI_OVERRIDE_MARKER)) {
+        for (uint8_t i = 0; i < WEB_ASSET_COUNT; i++) {
+            if (overriddenOnLittleFS(WEB_ASSETS[i])) {
+                overrides |= 1UL << i;
+                LOG_INFO(LogTag::WEB, "UI file %s overridden by LittleFS", WEB_ASSETS[i].path);
+            }
+        }
+    } else if (webUiAvailable) {
+        LOG_INFO(LogTag::WEB, "No %s on LittleFS; its UI files don't override the built-in ones",
+                 WEB_UI_OVERRIDE_MARKER);
+    }
+    if (WEB_ASSET_COUNT == 0) {
+        LOG_WARN(LogTag::WEB, "No UI files embedded; serving from LittleFS only");
+    } else {
+        LOG_INFO(LogTag::WEB, "Serving %u embedded UI files (%u overridden)",
+                 (unsigned)WEB_ASSET_COUNT, (unsigned)getWebAssetOverrideCount());
+    }
+}
+
+bool serveWebAsset(AsyncWebServerRequest* request, const String& path) {
+    const WebAsset* asset = nullptr;
+    for (uint8_t i = 0; i < WEB_ASSET_COUNT; i++) {
+        if (path == WEB_ASSETS[i].path) {
+            if (!(overrides & (1UL << i))) {
+                asset = &WEB_ASSETS[i];
+            }
+            break;
+        }
+    }
+    if (!asset) {
+        return false;
+    }
+
+    char etag[24];
+    snprintf(etag, sizeof(etag), "\"%s\"", asset->hash);
+
+    AsyncWebServerResponse* response;
+    if (request->hasHeader("If-None-Match") && request->header("If-None-Match") == etag) {
+        response = request->beginResponse(304);
+    } else {
+        response = request->beginResponse_P(200, asset->contentType, asset->gzip, asset->gzipSize);
+        response->addHeader("Content-Encoding", "gzip");
+    }
+
+    // Only a URL naming this exact content may be cached for good
+    bool versioned = request->hasParam("v") && request->getParam("v")->value() == asset->hash;
+    response->addHeader("ETag", etag);
+    response->addHeader("Cache-Control", versioned ? "public, max-age=31536000, immutable" : "no-cache");
+    request->send(response);
+    return true;
+}
+
+uint8_t getWebAssetCount() {
+    return WEB_ASSET_COUNT;
+}
+
+uint8_t getWebAssetOverrideCount() {
+    return __builtin_popcount(overrides);
+}
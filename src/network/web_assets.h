@@ -0,0 +1,36 @@
+#pragma once
+
+#include <ESPAsyncWebServer.h>
+
+// Web UI files compiled into the firmware (scripts/embed_web_assets.py
+// generates the table from data/ on every build), served gzipped straight
+// from flash. The UI works without uploadfs, and page loads don't touch
+// the filesystem.
+//
+// Each file has a content hash. It is the ETag, and HTML references
+// assets as /assets/<file>?v=<hash>: requests carrying the current hash
+// are cached as immutable, others revalidate (no-cache).
+//
+// LittleFS can still override, but only when WEB_UI_OVERRIDE_MARKER
+// exists there: then a file uploaded with uploadfs that differs from the
+// embedded one (by CRC, checked once at startup) is served from LittleFS
+// instead. Without the marker, stale copies from an old uploadfs are
+// ignored. Files not in the bundle are served from LittleFS either way.
+struct WebAsset {
+    const char* path;           // URL path, e.g. "/assets/app.js"
+    const char* contentType;
+    const uint8_t* gzip;        // In flash
+    uint32_t gzipSize;
+    uint32_t crc32;             // Of the uncompressed source file
+    const char* hash;           // Content hash, 16 hex digits
+};
+
+// Look for LittleFS overrides if the marker is present (call after mounting LittleFS)
+void setupWebAssets();
+
+// Serve path from the bundle; false if it isn't embedded or is overridden
+bool serveWebAsset(AsyncWebServerRequest* request, const String& path);
+
+// Embedded files, and how many of them LittleFS overrides
+uint8_t getWebAssetCount();
+uint8_t getWebAssetOverrideCount();
@@ -11,6 +11,8 @@
 extern Config config;
 extern bool wifiConnected;
 extern unsigned long lastWifiAttempt;
+extern void applySacnOutputConfig();
+extern void applyClockSyncConfig();
 
 // Access Point settings
 #define AP_SSID "LUME-Setup"
@@ -77,12 +79,17 @@ void handleWifiMaintenance() {
             if (config.sacnEnabled) {
                 lume::sacnProtocol.configure(config.sacnUniverse, config.sacnUniverseCount,
                                               config.sacnUnicast, config.sacnStartChannel);
+                lume::sacnProtocol.setMergeMode(static_cast<lume::SacnMergeMode>(config.sacnMergeMode));
                 lume::sacnProtocol.begin();
             }
-            // MQTT will auto-reconnect in its update() cycle
+            applySacnOutputConfig();
+            applyClockSyncConfig();
+            // MQTT reconnects on its own task
         } else {
             LOG_WARN(LogTag::WIFI, "WiFi disconnected");
             lume::sacnProtocol.stop();
+            applySacnOutputConfig();
+            applyClockSyncConfig();
         }
     }
 }
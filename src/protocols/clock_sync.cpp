@@ -0,0 +1,323 @@
+/**
+ * ClockSync - Shared clock implementation
+ */
+
+#include "clock_sync.h"
+#include "../logging.h"
+#include <esp_timer.h>
+
+namespace lume {
+
+// Global instance
+ClockSync clockSync;
+
+static const uint8_t CLOCK_SYNC_MAGIC[] = {'L', 'U', 'M', 'T'};
+static constexpr uint8_t CLOCK_SYNC_TYPE_REQUEST = 1;
+static constexpr uint8_t CLOCK_SYNC_TYPE_RESPONSE = 2;
+
+static inline int64_t get64(const uint8_t* p) {
+    uint64_t v = 0;
+    for (uint8_t i = 0; i < 8; i++) {
+        v = (v << 8) | p[i];
+    }
+    return (int64_t)v;
+}
+
+static inline void put64(uint8_t* p, int64_t value) {
+    uint64_t v = (uint64_t)value;
+    for (int8_t i = 7; i >= 0; i--) {
+        p[i] = v & 0xFF;
+        v >>= 8;
+    }
+}
+
+static inline void putHeader(uint8_t* p, uint8_t type) {
+    memcpy(p, CLOCK_SYNC_MAGIC, sizeof(CLOCK_SYNC_MAGIC));
+    p[4] = CLOCK_SYNC_VERSION;
+    p[5] = type;
+    p[6] = 0;
+    p[7] = 0;
+}
+
+const char* clockSyncRoleToString(ClockSyncRole role) {
+    switch (role) {
+        case ClockSyncRole::Master: return "master";
+        case ClockSyncRole::Client: return "client";
+        default:                    return "off";
+    }
+}
+
+bool clockSyncRoleFromString(const char* str, ClockSyncRole& role) {
+    if (!str) return false;
+    if (strcmp(str, "off") == 0) {
+        role = ClockSyncRole::Off;
+    } else if (strcmp(str, "master") == 0) {
+        role = ClockSyncRole::Master;
+    } else if (strcmp(str, "client") == 0) {
+        role = ClockSyncRole::Client;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+int64_t sharedTimeUs() {
+    return clockSync.now();
+}
+
+ClockSync::ClockSync()
+    : role_(ClockSyncRole::Off)
+    , pendingRole_(ClockSyncRole::Off)
+    , configPending_(false)
+    , running_(false)
+    , masterKnown_(false)
+    , pendingT1_(0)
+    , lastPollMs_(0)
+    , sampleHead_(0)
+    , sampleCount_(0)
+    , lastUsedLocalUs_(0)
+    , refLocalUs_(0)
+    , refOffsetUs_(0)
+    , driftPpb_(0)
+    , locked_(false)
+    , roundTripUs_(0)
+    , steps_(0)
+    , lastSyncMs_(0)
+    , served_(0) {
+    memset(packet_, 0, sizeof(packet_));
+    memset(samples_, 0, sizeof(samples_));
+}
+
+int64_t ClockSync::localUs() {
+    return esp_timer_get_time();
+}
+
+int64_t ClockSync::offsetAt(int64_t local) const {
+    return refOffsetUs_ + (local - refLocalUs_) * driftPpb_ / 1000000000LL;
+}
+
+int64_t ClockSync::now() const {
+    int64_t local = localUs();
+    if (role_ != ClockSyncRole::Client) {
+        return local;
+    }
+    return local + offsetAt(local);
+}
+
+void ClockSync::configure(ClockSyncRole role, const String& server) {
+    pendingRole_ = role;
+    pendingServer_ = server;
+    configPending_ = true;
+}
+
+void ClockSync::apply() {
+    if (running_) {
+        udp_.stop();
+        running_ = false;
+    }
+
+    role_ = pendingRole_;
+    server_ = pendingServer_;
+    masterKnown_ = false;
+    pendingT1_ = 0;
+    lastPollMs_ = 0;
+    sampleHead_ = 0;
+    sampleCount_ = 0;
+    lastUsedLocalUs_ = 0;
+    refLocalUs_ = 0;
+    refOffsetUs_ = 0;
+    driftPpb_ = 0;
+    locked_ = false;
+    roundTripUs_ = 0;
+
+    if (role_ == ClockSyncRole::Off) {
+        LOG_INFO(LogTag::CLUSTER, "Clock sync off");
+        return;
+    }
+
+    if (role_ == ClockSyncRole::Client && server_.length() > 0) {
+        if (!masterIP_.fromString(server_)) {
+            LOG_ERROR(LogTag::CLUSTER, "Invalid clock sync server: %s", server_.c_str());
+            return;
+        }
+        masterKnown_ = true;
+    }
+
+    if (!udp_.begin(CLOCK_SYNC_PORT)) {
+        LOG_ERROR(LogTag::CLUSTER, "Clock sync failed to bind port %d", CLOCK_SYNC_PORT);
+        return;
+    }
+    running_ = true;
+
+    // The master's clock is the shared clock by definition
+    locked_ = role_ == ClockSyncRole::Master;
+
+    LOG_INFO(LogTag::CLUSTER, "Clock sync %s on port %d%s%s", clockSyncRoleToString(role_), CLOCK_SYNC_PORT,
+             role_ == ClockSyncRole::Client ? ", server " : "",
+             role_ == ClockSyncRole::Client ? (masterKnown_ ? server_.c_str() : "broadcast") : "");
+}
+
+void ClockSync::update() {
+    if (configPending_) {
+        configPending_ = false;
+        apply();
+    }
+    if (!running_) {
+        return;
+    }
+
+    if (role_ == ClockSyncRole::Master) {
+        serve();
+    } else {
+        poll();
+    }
+}
+
+void ClockSync::serve() {
+    int size;
+    while ((size = udp_.parsePacket()) > 0) {
+        int64_t t2 = localUs();
+        if (size != CLOCK_SYNC_REQUEST_SIZE) {
+            udp_.flush();
+            continue;
+        }
+        udp_.read(packet_, CLOCK_SYNC_REQUEST_SIZE);
+        if (memcmp(packet_, CLOCK_SYNC_MAGIC, sizeof(CLOCK_SYNC_MAGIC)) != 0 ||
+            packet_[4] != CLOCK_SYNC_VERSION || packet_[5] != CLOCK_SYNC_TYPE_REQUEST) {
+            continue;
+        }
+
+        // Echo t1 so the client can match the reply to its request
+        int64_t t1 = get64(packet_ + 8);
+        putHeader(packet_, CLOCK_SYNC_TYPE_RESPONSE);
+        put64(packet_ + 8, t1);
+        put64(packet_ + 16, t2);
+        put64(packet_ + 24, localUs());
+        if (udp_.beginPacket(udp_.remoteIP(), udp_.remotePort()) &&
+            udp_.write(packet_, CLOCK_SYNC_RESPONSE_SIZE) == CLOCK_SYNC_RESPONSE_SIZE &&
+            udp_.endPacket()) {
+            served_++;
+        }
+    }
+}
+
+void ClockSync::poll() {
+    int size;
+    while ((size = udp_.parsePacket()) > 0) {
+        int64_t t4 = localUs();
+        if (size != CLOCK_SYNC_RESPONSE_SIZE) {
+            udp_.flush();   // Includes other clients' broadcast requests
+            continue;
+        }
+        udp_.read(packet_, CLOCK_SYNC_RESPONSE_SIZE);
+        receiveResponse(t4);
+    }
+
+    uint32_t nowMs = millis();
+    if (locked_ && nowMs - lastSyncMs_ > CLOCK_SYNC_LOST_MS) {
+        // Keep free-running on the last offset and drift; re-lock steps again
+        locked_ = false;
+        sampleHead_ = 0;
+        sampleCount_ = 0;
+        if (server_.length() == 0) {
+            masterKnown_ = false;
+        }
+        LOG_WARN(LogTag::CLUSTER, "Clock sync lost the master, free-running (drift %ld ppb)", (long)driftPpb_);
+    }
+
+    uint32_t interval = sampleCount_ < CLOCK_SYNC_SAMPLES ? CLOCK_SYNC_FAST_POLL_MS : CLOCK_SYNC_POLL_MS;
+    if (lastPollMs_ != 0 && nowMs - lastPollMs_ < interval) {
+        return;
+    }
+    lastPollMs_ = nowMs;
+
+    pendingT1_ = localUs();
+    putHeader(packet_, CLOCK_SYNC_TYPE_REQUEST);
+    put64(packet_ + 8, pendingT1_);
+    IPAddress ip = masterKnown_ ? masterIP_ : IPAddress(255, 255, 255, 255);
+    if (udp_.beginPacket(ip, CLOCK_SYNC_PORT)) {
+        udp_.write(packet_, CLOCK_SYNC_REQUEST_SIZE);
+        udp_.endPacket();
+    }
+}
+
+void ClockSync::receiveResponse(int64_t t4) {
+    if (memcmp(packet_, CLOCK_SYNC_MAGIC, sizeof(CLOCK_SYNC_MAGIC)) != 0 ||
+        packet_[4] != CLOCK_SYNC_VERSION || packet_[5] != CLOCK_SYNC_TYPE_RESPONSE) {
+        return;
+    }
+
+    // Only the reply to the outstanding request: late replies have a stale t1
+    int64_t t1 = get64(packet_ + 8);
+    if (pendingT1_ == 0 || t1 != pendingT1_) {
+        return;
+    }
+    pendingT1_ = 0;
+
+    if (!masterKnown_) {
+        masterIP_ = udp_.remoteIP();
+        masterKnown_ = true;
+        LOG_INFO(LogTag::CLUSTER, "Clock sync master found at %s", masterIP_.toString().c_str());
+    } else if (udp_.remoteIP() != masterIP_) {
+        return;
+    }
+
+    int64_t t2 = get64(packet_ + 16);
+    int64_t t3 = get64(packet_ + 24);
+    int64_t roundTrip = (t4 - t1) - (t3 - t2);
+    if (roundTrip < 0) {
+        return;
+    }
+
+    Sample& sample = samples_[sampleHead_];
+    sample.localUs = t4;
+    sample.offsetUs = ((t2 - t1) + (t3 - t4)) / 2;
+    sample.roundTripUs = (uint32_t)min(roundTrip, (int64_t)UINT32_MAX);
+    sampleHead_ = (sampleHead_ + 1) % CLOCK_SYNC_SAMPLES;
+    sampleCount_++;
+    lastSyncMs_ = millis();
+
+    // The shortest round trip in the window is the most trustworthy
+    uint8_t filled = min(sampleCount_, (uint32_t)CLOCK_SYNC_SAMPLES);
+    const Sample* best = nullptr;
+    for (uint8_t i = 0; i < filled; i++) {
+        if (!best || samples_[i].roundTripUs < best->roundTripUs) {
+            best = &samples_[i];
+        }
+    }
+    if (best->localUs != lastUsedLocalUs_) {
+        lastUsedLocalUs_ = best->localUs;
+        discipline(*best);
+    }
+}
+
+void ClockSync::discipline(const Sample& best) {
+    roundTripUs_ = best.roundTripUs;
+    int64_t error = best.offsetUs - offsetAt(best.localUs);
+
+    if (!locked_ || error > CLOCK_SYNC_STEP_US || error < -CLOCK_SYNC_STEP_US) {
+        refLocalUs_ = best.localUs;
+        refOffsetUs_ = best.offsetUs;
+        steps_++;
+        if (locked_) {
+            LOG_WARN(LogTag::CLUSTER, "Clock sync stepped by %lld us", (long long)error);
+        } else {
+            LOG_INFO(LogTag::CLUSTER, "Clock sync locked, offset %lld us, round trip %lu us",
+                     (long long)best.offsetUs, (unsigned long)best.roundTripUs);
+        }
+        locked_ = true;
+        return;
+    }
+
+    // The error built up since the last correction is mostly frequency
+    // difference: fold an eighth of it into the drift, slew a quarter now
+    int64_t elapsed = best.localUs - refLocalUs_;
+    if (elapsed > 0) {
+        int64_t drift = driftPpb_ + error * 1000000000LL / elapsed / 8;
+        driftPpb_ = (int32_t)constrain(drift, (int64_t)-CLOCK_SYNC_MAX_DRIFT_PPB, (int64_t)CLOCK_SYNC_MAX_DRIFT_PPB);
+    }
+    refOffsetUs_ = best.offsetUs - error + error / 4;
+    refLocalUs_ = best.localUs;
+}
+
+} // namespace lume
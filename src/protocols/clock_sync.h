@@ -0,0 +1,130 @@
+#ifndef LUME_PROTOCOL_CLOCK_SYNC_H
+#define LUME_PROTOCOL_CLOCK_SYNC_H
+
+#include <Arduino.h>
+#include <WiFiUdp.h>
+
+namespace lume {
+
+// Clock sync wire format (big-endian):
+//   request:  "LUMT" ver(1) type=1 pad(2) t1(8)                    16 bytes
+//   response: "LUMT" ver(1) type=2 pad(2) t1(8) t2(8) t3(8)        32 bytes
+// t1 = client send, t2 = master receive, t3 = master send (microseconds)
+constexpr uint16_t CLOCK_SYNC_PORT = 5569;
+constexpr uint8_t CLOCK_SYNC_VERSION = 1;
+constexpr uint16_t CLOCK_SYNC_REQUEST_SIZE = 16;
+constexpr uint16_t CLOCK_SYNC_RESPONSE_SIZE = 32;
+constexpr uint8_t CLOCK_SYNC_SAMPLES = 8;               // Filter window (min round trip wins)
+constexpr uint32_t CLOCK_SYNC_FAST_POLL_MS = 250;       // Until the window is full
+constexpr uint32_t CLOCK_SYNC_POLL_MS = 2000;
+constexpr uint32_t CLOCK_SYNC_LOST_MS = 30000;          // No replies: unlocked (keeps free-running)
+constexpr int32_t CLOCK_SYNC_STEP_US = 5000;            // Larger errors step instead of slewing
+constexpr int32_t CLOCK_SYNC_MAX_DRIFT_PPB = 500000;    // 500 ppm
+
+enum class ClockSyncRole : uint8_t {
+    Off = 0,
+    Master = 1,     // Answers requests; its clock is the shared clock
+    Client = 2      // Follows a master
+};
+
+const char* clockSyncRoleToString(ClockSyncRole role);
+bool clockSyncRoleFromString(const char* str, ClockSyncRole& role);
+
+/**
+ * ClockSync - NTP-style shared clock between LUME nodes
+ *
+ * Clients poll the master (unicast, or broadcast until one answers) and
+ * time each exchange. Of the last 8 exchanges the one with the shortest
+ * round trip gives the offset (least queueing, least asymmetry). The
+ * first offset steps the clock; after that, errors are slewed out and the
+ * frequency difference (drift, in ppb) is tracked, so the shared clock
+ * stays continuous and keeps running if the master goes away.
+ *
+ * now() is monotonic microseconds: the master's esp_timer on the master,
+ * the client's own clock mapped onto it on clients.
+ *
+ * configure() may be called from any task; update() (main loop) applies it.
+ */
+class ClockSync {
+public:
+    ClockSync();
+
+    void configure(ClockSyncRole role, const String& server);
+    void update();
+
+    // Shared clock (microseconds); local clock when sync is off
+    int64_t now() const;
+
+    // --- Status ---
+
+    ClockSyncRole getRole() const { return role_; }
+    bool isLocked() const { return locked_; }
+    const String& getServer() const { return server_; }
+    IPAddress getMasterIP() const { return masterIP_; }
+    int64_t getOffsetUs() const { return offsetAt(localUs()); }
+    int32_t getDriftPpb() const { return driftPpb_; }
+    uint32_t getRoundTripUs() const { return roundTripUs_; }
+    uint32_t getSamples() const { return sampleCount_; }
+    uint32_t getSteps() const { return steps_; }
+    uint32_t getRequestsServed() const { return served_; }
+    uint32_t getLastSyncMs() const { return lastSyncMs_; }
+
+private:
+    struct Sample {
+        int64_t localUs;        // t4
+        int64_t offsetUs;
+        uint32_t roundTripUs;
+    };
+
+    WiFiUDP udp_;
+    uint8_t packet_[CLOCK_SYNC_RESPONSE_SIZE];
+
+    ClockSyncRole role_;
+    String server_;             // Empty = broadcast discovery
+    ClockSyncRole pendingRole_;
+    String pendingServer_;
+    volatile bool configPending_;
+    bool running_;
+
+    // Client exchange
+    IPAddress masterIP_;
+    bool masterKnown_;
+    int64_t pendingT1_;
+    uint32_t lastPollMs_;
+
+    // Filter window
+    Sample samples_[CLOCK_SYNC_SAMPLES];
+    uint8_t sampleHead_;
+    uint32_t sampleCount_;
+    int64_t lastUsedLocalUs_;   // Sample already applied
+
+    // Clock model: offset(t) = refOffset + (t - refLocal) * drift
+    int64_t refLocalUs_;
+    int64_t refOffsetUs_;
+    int32_t driftPpb_;
+    bool locked_;
+    uint32_t roundTripUs_;
+    uint32_t steps_;
+    uint32_t lastSyncMs_;
+
+    uint32_t served_;
+
+    static int64_t localUs();
+    int64_t offsetAt(int64_t local) const;
+
+    void apply();
+    void serve();
+    void poll();
+    void receiveResponse(int64_t t4);
+    void discipline(const Sample& best);
+};
+
+// Global instance
+extern ClockSync clockSync;
+
+// Shared clock for the controller's lockstep mode
+int64_t sharedTimeUs();
+
+} // namespace lume
+
+#endif // LUME_PROTOCOL_CLOCK_SYNC_H
@@ -0,0 +1,259 @@
+/**
+ * Cluster - Leader/follower pixel distribution
+ */
+
+#include "cluster.h"
+#include "../core/controller.h"
+#include "../logging.h"
+
+namespace lume {
+
+// Global instances
+ClusterProtocol clusterProtocol;
+ClusterNode cluster;
+
+const char* clusterRoleToString(ClusterRole role) {
+    switch (role) {
+        case ClusterRole::Leader:   return "leader";
+        case ClusterRole::Follower: return "follower";
+        default:                    return "off";
+    }
+}
+
+bool clusterRoleFromString(const char* str, ClusterRole& role) {
+    if (!str) return false;
+    if (strcmp(str, "off") == 0) {
+        role = ClusterRole::Off;
+    } else if (strcmp(str, "leader") == 0) {
+        role = ClusterRole::Leader;
+    } else if (strcmp(str, "follower") == 0) {
+        role = ClusterRole::Follower;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+const char* clusterConcealToString(ClusterConceal conceal) {
+    return conceal == ClusterConceal::Interpolate ? "interpolate" : "repeat";
+}
+
+bool clusterConcealFromString(const char* str, ClusterConceal& conceal) {
+    if (!str) return false;
+    if (strcmp(str, "repeat") == 0) {
+        conceal = ClusterConceal::Repeat;
+    } else if (strcmp(str, "interpolate") == 0) {
+        conceal = ClusterConceal::Interpolate;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+// ===========================================================================
+// ClusterProtocol (follower)
+// ===========================================================================
+
+ClusterProtocol::ClusterProtocol()
+    : port_(CLUSTER_PORT)
+    , enabled_(false)
+    , initialized_(false)
+    , active_(false)
+    , lastPacketMs_(0) {
+    memset(packetBuffer_, 0, sizeof(packetBuffer_));
+}
+
+void ClusterProtocol::configure(uint8_t nodeId, uint16_t port, ClusterConceal conceal) {
+    receiver_.configure(nodeId, conceal);
+    port_ = port;
+}
+
+bool ClusterProtocol::begin_impl() {
+    if (!receiver_.allocate()) {
+        LOG_ERROR(LogTag::CLUSTER, "Follower buffer allocation failed");
+        return false;
+    }
+
+    if (!udp_.begin(port_)) {
+        LOG_ERROR(LogTag::CLUSTER, "Failed to start UDP on port %d", port_);
+        return false;
+    }
+
+    receiver_.resetStats();
+    lastPacketMs_ = 0;
+    initialized_ = true;
+    enabled_ = true;
+
+    LOG_INFO(LogTag::CLUSTER, "Follower %d listening on port %d (%s)",
+             receiver_.getNodeId(), port_, clusterConcealToString(receiver_.getConceal()));
+    return true;
+}
+
+void ClusterProtocol::stop() {
+    if (initialized_) {
+        udp_.stop();
+        initialized_ = false;
+        active_ = false;
+        LOG_INFO(LogTag::CLUSTER, "Follower stopped");
+    }
+    receiver_.release();
+}
+
+void ClusterProtocol::setEnabled(bool enabled) {
+    enabled_ = enabled;
+    if (!enabled) {
+        active_ = false;
+    }
+}
+
+bool ClusterProtocol::hasTimedOut(uint32_t timeoutMs) const {
+    if (lastPacketMs_ == 0) {
+        return false;  // Never received
+    }
+    return (millis() - lastPacketMs_) > timeoutMs;
+}
+
+bool ClusterProtocol::update() {
+    if (!initialized_ || !enabled_) {
+        return false;
+    }
+
+    // Leader gone: its clock and frame numbers are no longer trusted
+    if (receiver_.hasLeaderClock() && hasTimedOut(CLUSTER_TIMEOUT_MS)) {
+        LOG_INFO(LogTag::CLUSTER, "Leader silent - resetting schedule");
+        receiver_.resetLeader();
+        active_ = false;
+    }
+
+    const ClusterFollowerStats& stats = receiver_.getStats();
+    uint32_t received = stats.packets;
+    uint32_t resets = stats.resets;
+
+    // Process all available packets (a frame can span several)
+    int maxPacketsPerUpdate = 12;
+    while (maxPacketsPerUpdate-- > 0) {
+        int packetSize = udp_.parsePacket();
+        if (packetSize == 0) {
+            break;
+        }
+        if (packetSize < CLUSTER_HEADER_SIZE || packetSize > (int)sizeof(packetBuffer_)) {
+            udp_.flush();
+            continue;
+        }
+        int bytesRead = udp_.read(packetBuffer_, sizeof(packetBuffer_));
+        udp_.flush();
+        receiver_.receive(packetBuffer_, bytesRead, micros());
+    }
+
+    if (stats.resets != resets) {
+        LOG_INFO(LogTag::CLUSTER, "Leader restarted - resetting schedule");
+    }
+    if (stats.packets != received) {
+        lastPacketMs_ = millis();
+        active_ = true;
+    }
+
+    if (receiver_.schedule(micros())) {
+        buffer_.write(receiver_.getOutput(), receiver_.getOutputCount());
+    }
+    return stats.packets != received;
+}
+
+// ===========================================================================
+// ClusterNode (roles, leader sender)
+// ===========================================================================
+
+ClusterNode::ClusterNode()
+    : configPending_(false)
+    , frameNumber_(0)
+    , lastControllerFrame_(0)
+    , framesSent_(0)
+    , packetsSent_(0)
+    , sendErrors_(0) {
+    memset(packet_, 0, sizeof(packet_));
+}
+
+void ClusterNode::configure(const ClusterConfig& config) {
+    pending_ = config;
+    pending_.delayMs = min(pending_.delayMs, CLUSTER_MAX_DELAY_MS);
+    pending_.followerCount = min(pending_.followerCount, CLUSTER_MAX_FOLLOWERS);
+    configPending_ = true;
+}
+
+void ClusterNode::apply() {
+    config_ = pending_;
+
+    clusterProtocol.stop();
+    clusterProtocol.setEnabled(false);
+    udp_.stop();
+
+    switch (config_.role) {
+        case ClusterRole::Follower:
+            clusterProtocol.configure(config_.nodeId, config_.port, config_.conceal);
+            clusterProtocol.begin();
+            break;
+
+        case ClusterRole::Leader:
+            lastControllerFrame_ = controller.getFrame();
+            LOG_INFO(LogTag::CLUSTER, "Leader: %d followers, %dms play-out delay",
+                     config_.followerCount, config_.delayMs);
+            break;
+
+        default:
+            break;
+    }
+}
+
+void ClusterNode::update() {
+    if (configPending_) {
+        configPending_ = false;
+        apply();
+    }
+
+    if (config_.role != ClusterRole::Leader) {
+        return;
+    }
+
+    uint32_t frame = controller.getFrame();
+    if (frame != lastControllerFrame_) {
+        lastControllerFrame_ = frame;
+        sendFrame();
+    }
+}
+
+void ClusterNode::sendFrame() {
+    const CRGB* canvas = controller.getLeds();
+    uint16_t canvasSize = controller.getLedCount();
+
+    frameNumber_++;
+    if (frameNumber_ == 0) frameNumber_ = 1;  // 0 means "none" on followers
+    ClusterFragment fragment = {};
+    fragment.frame = frameNumber_;
+    fragment.playAt = micros() + config_.delayMs * 1000u;
+
+    for (uint8_t f = 0; f < config_.followerCount; f++) {
+        const ClusterFollowerSlice& slice = config_.followers[f];
+        if (slice.start >= canvasSize) continue;
+        uint16_t total = min(slice.count, (uint16_t)(canvasSize - slice.start));
+        total = min(total, MAX_LED_COUNT);
+
+        fragment.node = slice.node;
+        fragment.total = total;
+
+        for (uint16_t offset = 0; offset < total; offset += CLUSTER_PIXELS_PER_PACKET) {
+            fragment.offset = offset;
+            fragment.count = min((uint16_t)(total - offset), CLUSTER_PIXELS_PER_PACKET);
+            fragment.sentAt = micros();
+            uint16_t size = clusterWritePacket(packet_, fragment, canvas + slice.start + offset);
+            if (udp_.beginPacket(slice.ip, slice.port) &&
+                udp_.write(packet_, size) == size && udp_.endPacket()) {
+                packetsSent_++;
+            } else {
+                sendErrors_++;
+            }
+        }
+    }
+    framesSent_++;
+}
+
+} // namespace lume
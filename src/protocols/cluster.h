@@ -0,0 +1,170 @@
+#ifndef LUME_PROTOCOL_CLUSTER_H
+#define LUME_PROTOCOL_CLUSTER_H
+
+#include "protocol.h"
+#include "cluster_core.h"
+#include <WiFiUdp.h>
+#include "../constants.h"
+
+namespace lume {
+
+constexpr uint8_t CLUSTER_MAX_FOLLOWERS = 8;
+constexpr uint16_t CLUSTER_DEFAULT_DELAY_MS = 50;
+constexpr uint16_t CLUSTER_MAX_DELAY_MS = 500;
+constexpr uint32_t CLUSTER_TIMEOUT_MS = 2000;          // Follower forgets the leader's clock
+
+enum class ClusterRole : uint8_t {
+    Off = 0,
+    Leader = 1,     // Renders the canvas and streams slices to followers
+    Follower = 2    // Shows the leader's frames at their play-out time
+};
+
+const char* clusterRoleToString(ClusterRole role);
+bool clusterRoleFromString(const char* str, ClusterRole& role);
+const char* clusterConcealToString(ClusterConceal conceal);
+bool clusterConcealFromString(const char* str, ClusterConceal& conceal);
+
+// One follower's part of the leader's canvas
+struct ClusterFollowerSlice {
+    IPAddress ip;
+    uint16_t port;
+    uint8_t node;
+    uint16_t start;     // First canvas pixel
+    uint16_t count;
+};
+
+struct ClusterConfig {
+    ClusterRole role = ClusterRole::Off;
+    uint8_t nodeId = 1;                         // Follower: frames addressed to this id
+    uint16_t port = CLUSTER_PORT;               // Follower: listen port
+    uint16_t delayMs = CLUSTER_DEFAULT_DELAY_MS;  // Leader: play-out delay
+    ClusterConceal conceal = ClusterConceal::Interpolate;
+    uint8_t followerCount = 0;
+    ClusterFollowerSlice followers[CLUSTER_MAX_FOLLOWERS];
+};
+
+/**
+ * ClusterProtocol - Follower side of leader/follower clustering
+ *
+ * Receives this node's slice of the leader's canvas over UDP and hands
+ * it to a ClusterReceiver (cluster_core.h), which reassembles the
+ * fragments of each frame and publishes it when its play-out time comes,
+ * so every follower changes frame at the same moment. Every follower lags
+ * by roughly the minimum network latency, which is close enough for the
+ * play-out delay to absorb.
+ *
+ * Runs entirely on the main loop (update() is called by the controller).
+ */
+class ClusterProtocol : public Protocol {
+public:
+    ClusterProtocol();
+
+    // --- Configuration (call before begin) ---
+
+    void configure(uint8_t nodeId, uint16_t port, ClusterConceal conceal);
+
+    // --- Protocol interface ---
+
+    bool begin_impl() override;
+    void stop() override;
+
+    void setEnabled(bool enabled) override;
+    bool isEnabled_impl() const override { return enabled_; }
+
+    bool update() override;
+    bool hasTimedOut(uint32_t timeoutMs = 5000) const override;
+    bool isActive_impl() const override { return active_; }
+
+    bool hasFrameReady() const override { return buffer_.isReady(); }
+    const CRGB* getBufferInternal() const override { return buffer_.getBuffer(); }
+    uint16_t getBufferSizeInternal() const override { return buffer_.getLedCount(); }
+    void clearFrameReady() override { buffer_.clearReady(); }
+
+    // Frames are published whole, at their play-out time
+    uint32_t getFrameArrivalUs() const override { return receiver_.getOutputUs(); }
+
+    const char* getName() const override { return "Cluster"; }
+    uint32_t getPacketCount() const override { return receiver_.getStats().packets; }
+    uint32_t getLastPacketTime() const override { return lastPacketMs_; }
+
+    // --- Diagnostics ---
+
+    uint8_t getNodeId() const { return receiver_.getNodeId(); }
+    const ClusterFollowerStats& getStats() const { return receiver_.getStats(); }
+    const Histogram& getPlayoutError() const { return receiver_.getPlayoutError(); }
+    uint32_t getCadenceUs() const { return receiver_.getCadenceUs(); }
+    uint32_t getLastFrame() const { return receiver_.getLastFrame(); }
+
+private:
+    WiFiUDP udp_;
+    uint8_t packetBuffer_[CLUSTER_PACKET_SIZE];
+
+    // Configuration
+    uint16_t port_;
+
+    // State
+    bool enabled_;
+    bool initialized_;
+    bool active_;
+    uint32_t lastPacketMs_;
+
+    // Reassembly and play-out. Its pixel buffers are allocated while this
+    // node is a follower (begin) and freed on stop
+    ClusterReceiver receiver_;
+
+    ProtocolBuffer<MAX_LED_COUNT> buffer_;
+};
+
+/**
+ * ClusterNode - Cluster role management and the leader's sender
+ *
+ * Holds the cluster configuration, starts/stops the follower protocol to
+ * match the role, and as leader sends every newly shown frame to each
+ * follower (its slice of the controller's output, fragmented to fit the
+ * MTU) stamped with play-at = now + delay. The leader's own strip shows
+ * frames right away, so it runs ahead of the followers by the delay.
+ *
+ * configure() may be called from any task; update() (main loop, after
+ * controller.update()) applies it.
+ */
+class ClusterNode {
+public:
+    ClusterNode();
+
+    void configure(const ClusterConfig& config);
+    const ClusterConfig& getConfig() const { return config_; }
+    ClusterRole getRole() const { return config_.role; }
+
+    void update();
+
+    // --- Leader diagnostics ---
+
+    uint32_t getFramesSent() const { return framesSent_; }
+    uint32_t getPacketsSent() const { return packetsSent_; }
+    uint32_t getSendErrors() const { return sendErrors_; }
+
+private:
+    ClusterConfig config_;
+    ClusterConfig pending_;
+    volatile bool configPending_;
+
+    WiFiUDP udp_;
+    uint8_t packet_[CLUSTER_PACKET_SIZE];
+    uint32_t frameNumber_;
+    uint32_t lastControllerFrame_;
+
+    uint32_t framesSent_;
+    uint32_t packetsSent_;
+    uint32_t sendErrors_;
+
+    void apply();
+    void sendFrame();
+};
+
+// Global instances
+extern ClusterProtocol clusterProtocol;
+extern ClusterNode cluster;
+
+} // namespace lume
+
+#endif // LUME_PROTOCOL_CLUSTER_H
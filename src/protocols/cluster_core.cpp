@@ -0,0 +1,341 @@
+/**
+ * Cluster core - Wire format, reassembly and play-out (no transport)
+ */
+
+#include "cluster_core.h"
+
+namespace lume {
+
+static const uint8_t CLUSTER_MAGIC[] = {'L', 'U', 'M', 'C'};
+
+static inline uint16_t get16(const uint8_t* p) {
+    return ((uint16_t)p[0] << 8) | p[1];
+}
+
+static inline uint32_t get32(const uint8_t* p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+static inline void put16(uint8_t* p, uint16_t v) {
+    p[0] = v >> 8;
+    p[1] = v & 0xFF;
+}
+
+static inline void put32(uint8_t* p, uint32_t v) {
+    p[0] = v >> 24;
+    p[1] = (v >> 16) & 0xFF;
+    p[2] = (v >> 8) & 0xFF;
+    p[3] = v & 0xFF;
+}
+
+// a is before b, on a wrapping 32-bit counter
+static inline bool before(uint32_t a, uint32_t b) {
+    return (int32_t)(a - b) < 0;
+}
+
+uint16_t clusterWritePacket(uint8_t* packet, const ClusterFragment& fragment, const CRGB* pixels) {
+    uint16_t count = min(fragment.count, CLUSTER_PIXELS_PER_PACKET);
+    memcpy(packet, CLUSTER_MAGIC, sizeof(CLUSTER_MAGIC));
+    packet[4] = CLUSTER_VERSION;
+    packet[5] = CLUSTER_TYPE_PIXELS;
+    packet[6] = fragment.node;
+    packet[7] = 0;
+    put32(packet + 8, fragment.frame);
+    put32(packet + 12, fragment.playAt);
+    put32(packet + 16, fragment.sentAt);
+    put16(packet + 20, fragment.offset);
+    put16(packet + 22, count);
+    put16(packet + 24, fragment.total);
+    // CRGB is packed r,g,b
+    memcpy(packet + CLUSTER_HEADER_SIZE, pixels, count * 3);
+    return CLUSTER_HEADER_SIZE + count * 3;
+}
+
+ClusterReceiver::ClusterReceiver()
+    : nodeId_(1)
+    , conceal_(ClusterConceal::Interpolate)
+    , pixels_(nullptr)
+    , lastFrame_(nullptr)
+    , work_(nullptr) {
+    memset(slotPixels_, 0, sizeof(slotPixels_));
+    reset();
+    resetStats();
+}
+
+void ClusterReceiver::configure(uint8_t nodeId, ClusterConceal conceal) {
+    nodeId_ = nodeId;
+    conceal_ = conceal;
+}
+
+bool ClusterReceiver::allocate() {
+    if (!pixels_) {
+        pixels_ = (CRGB*)calloc((CLUSTER_SLOTS + 2) * MAX_LED_COUNT, sizeof(CRGB));
+        if (!pixels_) {
+            return false;
+        }
+        for (uint8_t i = 0; i < CLUSTER_SLOTS; i++) {
+            slotPixels_[i] = pixels_ + i * MAX_LED_COUNT;
+        }
+        lastFrame_ = pixels_ + CLUSTER_SLOTS * MAX_LED_COUNT;
+        work_ = lastFrame_ + MAX_LED_COUNT;
+    }
+    reset();
+    return true;
+}
+
+void ClusterReceiver::release() {
+    free(pixels_);
+    pixels_ = nullptr;
+    memset(slotPixels_, 0, sizeof(slotPixels_));
+    lastFrame_ = nullptr;
+    work_ = nullptr;
+    output_ = nullptr;
+    outputCount_ = 0;
+}
+
+void ClusterReceiver::reset() {
+    memset(slots_, 0, sizeof(slots_));
+    if (lastFrame_) {
+        memset(lastFrame_, 0, MAX_LED_COUNT * sizeof(CRGB));
+    }
+    output_ = nullptr;
+    outputCount_ = 0;
+    lastTotal_ = 0;
+    shownAny_ = false;
+    lastShownFrame_ = 0;
+    lastShownPlayAt_ = 0;
+    nextConcealUs_ = 0;
+    newestFrame_ = 0;
+    newestPlayAt_ = 0;
+    cadenceUs_ = 0;
+    publishedUs_ = 0;
+    offsetUs_ = 0;
+    offsetValid_ = false;
+}
+
+void ClusterReceiver::resetLeader() {
+    reset();
+    stats_.resets++;
+}
+
+void ClusterReceiver::resetStats() {
+    memset(&stats_, 0, sizeof(stats_));
+    playoutError_.reset();
+}
+
+bool ClusterReceiver::receive(const uint8_t* p, int size, uint32_t arrivalUs) {
+    if (!pixels_ || size < CLUSTER_HEADER_SIZE ||
+        memcmp(p, CLUSTER_MAGIC, sizeof(CLUSTER_MAGIC)) != 0 ||
+        p[4] != CLUSTER_VERSION || p[5] != CLUSTER_TYPE_PIXELS || p[6] != nodeId_) {
+        return false;
+    }
+
+    uint32_t frame = get32(p + 8);
+    uint32_t playAt = get32(p + 12);
+    uint32_t sentAt = get32(p + 16);
+    uint16_t offset = get16(p + 20);
+    uint16_t count = get16(p + 22);
+    uint16_t total = min(get16(p + 24), MAX_LED_COUNT);
+
+    if (size < CLUSTER_HEADER_SIZE + count * 3 || count == 0 ||
+        offset % CLUSTER_PIXELS_PER_PACKET != 0 || offset >= total) {
+        return false;
+    }
+
+    // Frame numbers far behind what we showed: the leader restarted
+    if (shownAny_ && !before(lastShownFrame_, frame) && lastShownFrame_ - frame > 64) {
+        resetLeader();
+    }
+
+    if (shownAny_ && !before(lastShownFrame_, frame)) {
+        stats_.late++;  // Already past this frame
+        return false;
+    }
+
+    // Leader clock: keep the minimum one-way offset, creeping up 1us per
+    // packet so a leader clock that runs slow is still followed
+    uint32_t d = arrivalUs - sentAt;
+    if (!offsetValid_ || before(d, offsetUs_)) {
+        offsetUs_ = d;
+        offsetValid_ = true;
+    } else {
+        offsetUs_++;
+    }
+
+    int s = slotFor(frame);
+    if (s < 0) {
+        stats_.overruns++;
+        return false;
+    }
+
+    Slot& slot = slots_[s];
+    if (!slot.used) {
+        slot.used = true;
+        slot.frame = frame;
+        slot.playAt = playAt;
+        slot.total = total;
+        slot.fragments = 0;
+
+        // Frame cadence from consecutive play-at stamps
+        if (newestFrame_ != 0 && before(newestFrame_, frame)) {
+            uint32_t interval = (playAt - newestPlayAt_) / (frame - newestFrame_);
+            cadenceUs_ = cadenceUs_ == 0 ? interval : (cadenceUs_ * 7 + interval) / 8;
+        }
+        if (newestFrame_ == 0 || before(newestFrame_, frame)) {
+            newestFrame_ = frame;
+            newestPlayAt_ = playAt;
+        }
+    }
+
+    // Fragments of one frame must agree on its size; offset was only
+    // checked against this packet's total
+    if (total != slot.total || offset >= slot.total) {
+        return false;
+    }
+
+    count = min(count, (uint16_t)(slot.total - offset));
+    const uint8_t* rgb = p + CLUSTER_HEADER_SIZE;
+    CRGB* dst = slotPixels_[s] + offset;
+    for (uint16_t i = 0; i < count; i++) {
+        dst[i] = CRGB(rgb[0], rgb[1], rgb[2]);
+        rgb += 3;
+    }
+    slot.fragments |= 1 << (offset / CLUSTER_PIXELS_PER_PACKET);
+    stats_.packets++;
+    return true;
+}
+
+int ClusterReceiver::slotFor(uint32_t frame) {
+    int freeSlot = -1;
+    int oldest = -1;
+    for (uint8_t i = 0; i < CLUSTER_SLOTS; i++) {
+        if (!slots_[i].used) {
+            if (freeSlot < 0) freeSlot = i;
+            continue;
+        }
+        if (slots_[i].frame == frame) {
+            return i;
+        }
+        if (oldest < 0 || before(slots_[i].frame, slots_[oldest].frame)) {
+            oldest = i;
+        }
+    }
+    if (freeSlot >= 0) {
+        return freeSlot;
+    }
+
+    // Full: a newer frame evicts the oldest one
+    if (oldest >= 0 && before(slots_[oldest].frame, frame)) {
+        slots_[oldest].used = false;
+        return oldest;
+    }
+    return -1;
+}
+
+bool ClusterReceiver::isComplete(const Slot& slot) const {
+    uint8_t needed = (slot.total + CLUSTER_PIXELS_PER_PACKET - 1) / CLUSTER_PIXELS_PER_PACKET;
+    return slot.fragments == (uint8_t)((1u << needed) - 1);
+}
+
+bool ClusterReceiver::schedule(uint32_t nowUs) {
+    if (!pixels_ || !offsetValid_) {
+        return false;
+    }
+
+    while (true) {
+        // Oldest buffered frame
+        int s = -1;
+        for (uint8_t i = 0; i < CLUSTER_SLOTS; i++) {
+            if (slots_[i].used && (s < 0 || before(slots_[i].frame, slots_[s].frame))) {
+                s = i;
+            }
+        }
+        if (s < 0) {
+            return false;
+        }
+
+        Slot& slot = slots_[s];
+        uint32_t due = toLocal(slot.playAt);
+
+        if (before(nowUs, due)) {
+            // Frames between the last shown and this one were lost: blend
+            // toward this frame at the times they should have appeared
+            if (conceal_ == ClusterConceal::Interpolate && shownAny_ && cadenceUs_ > 0 &&
+                slot.frame - lastShownFrame_ > 1 && isComplete(slot) && slot.total == lastTotal_) {
+                uint32_t from = toLocal(lastShownPlayAt_);
+                if (nextConcealUs_ == 0) {
+                    nextConcealUs_ = from + cadenceUs_;
+                }
+                if (!before(nowUs, nextConcealUs_) && before(nextConcealUs_, due)) {
+                    fract8 amount = (fract8)(((uint64_t)(nowUs - from) * 255) / (due - from));
+                    blend(lastFrame_, slotPixels_[s], work_, slot.total, amount);
+                    output_ = work_;
+                    outputCount_ = slot.total;
+                    publishedUs_ = nowUs;
+                    nextConcealUs_ += cadenceUs_;
+                    stats_.interpolated++;
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        // A newer frame is already due and whole: this one is late
+        bool superseded = false;
+        for (uint8_t i = 0; i < CLUSTER_SLOTS; i++) {
+            if (i != s && slots_[i].used && !before(nowUs, toLocal(slots_[i].playAt)) &&
+                isComplete(slots_[i])) {
+                superseded = true;
+                break;
+            }
+        }
+        if (superseded) {
+            slot.used = false;
+            stats_.late++;
+            continue;
+        }
+
+        if (!isComplete(slot)) {
+            // Give missing fragments half a frame to turn up
+            uint32_t grace = cadenceUs_ > 0 ? cadenceUs_ / 2 : 10000;
+            if (before(nowUs, due + grace)) {
+                return false;
+            }
+            // Fill the gaps with the pixels they replace
+            for (uint8_t f = 0; f * CLUSTER_PIXELS_PER_PACKET < slot.total; f++) {
+                if (slot.fragments & (1 << f)) continue;
+                uint16_t start = f * CLUSTER_PIXELS_PER_PACKET;
+                uint16_t n = min((uint16_t)(slot.total - start), CLUSTER_PIXELS_PER_PACKET);
+                memcpy(slotPixels_[s] + start, lastFrame_ + start, n * sizeof(CRGB));
+            }
+            stats_.repaired++;
+        }
+
+        publish(s, nowUs, due);
+        return true;
+    }
+}
+
+void ClusterReceiver::publish(uint8_t s, uint32_t nowUs, uint32_t dueUs) {
+    Slot& slot = slots_[s];
+
+    if (shownAny_ && slot.frame - lastShownFrame_ > 1) {
+        stats_.lost += slot.frame - lastShownFrame_ - 1;
+    }
+
+    memcpy(lastFrame_, slotPixels_[s], slot.total * sizeof(CRGB));
+    output_ = lastFrame_;
+    outputCount_ = slot.total;
+    lastTotal_ = slot.total;
+    playoutError_.record(nowUs - dueUs);
+    publishedUs_ = nowUs;
+
+    shownAny_ = true;
+    lastShownFrame_ = slot.frame;
+    lastShownPlayAt_ = slot.playAt;
+    nextConcealUs_ = 0;
+    slot.used = false;
+    stats_.frames++;
+}
+
+} // namespace lume
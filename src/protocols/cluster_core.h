@@ -0,0 +1,159 @@
+#ifndef LUME_PROTOCOL_CLUSTER_CORE_H
+#define LUME_PROTOCOL_CLUSTER_CORE_H
+
+#include <FastLED.h>
+#include "../constants.h"
+#include "../core/histogram.h"
+
+namespace lume {
+
+// Cluster wire format (all fields big-endian):
+//   0  magic "LUMC"        4
+//   4  version             1
+//   5  type (1 = pixels)   1
+//   6  node id             1
+//   7  reserved            1
+//   8  frame number        4   leader frame counter, +1 per frame sent
+//  12  play-at             4   leader micros() when the frame should be shown
+//  16  sent-at             4   leader micros() when the packet was sent
+//  20  offset              2   first pixel of this fragment within the slice
+//  22  count               2   pixels in this fragment
+//  24  total               2   pixels in the follower's slice
+//  26  RGB data            count * 3
+constexpr uint16_t CLUSTER_PORT = 5570;
+constexpr uint8_t CLUSTER_VERSION = 1;
+constexpr uint8_t CLUSTER_TYPE_PIXELS = 1;
+constexpr uint16_t CLUSTER_HEADER_SIZE = 26;
+constexpr uint16_t CLUSTER_PIXELS_PER_PACKET = 480;   // 26 + 1440 bytes fits one Ethernet MTU
+constexpr uint16_t CLUSTER_PACKET_SIZE = CLUSTER_HEADER_SIZE + CLUSTER_PIXELS_PER_PACKET * 3;
+constexpr uint8_t CLUSTER_SLOTS = 3;                   // Frames buffered ahead of playout
+
+// What a follower shows when frames or fragments go missing
+enum class ClusterConceal : uint8_t {
+    Repeat = 0,       // Hold the last frame; missing fragments repeat their old pixels
+    Interpolate = 1   // Also blend toward the next frame in place of a lost one
+};
+
+struct ClusterFollowerStats {
+    uint32_t packets;             // Fragments accepted
+    uint32_t frames;              // Frames shown
+    uint32_t late;                // Packets for frames already shown, and frames skipped as late
+    uint32_t lost;                // Frame numbers never shown
+    uint32_t repaired;            // Frames shown with fragments filled from the previous frame
+    uint32_t interpolated;        // Blended frames shown in place of lost ones
+    uint32_t overruns;            // Frames dropped because every slot was busy
+    uint32_t resets;              // Leader restarted or went silent
+};
+
+// One packet of a frame, as the leader sends it
+struct ClusterFragment {
+    uint8_t node;
+    uint32_t frame;
+    uint32_t playAt;              // Leader clock
+    uint32_t sentAt;              // Leader clock
+    uint16_t offset;              // Within the slice, a multiple of CLUSTER_PIXELS_PER_PACKET
+    uint16_t count;
+    uint16_t total;               // Pixels in the slice
+};
+
+// Write fragment and its pixels (count of them) to packet, which must hold
+// CLUSTER_PACKET_SIZE bytes. Returns the packet size.
+uint16_t clusterWritePacket(uint8_t* packet, const ClusterFragment& fragment, const CRGB* pixels);
+
+/**
+ * ClusterReceiver - Follower reassembly, play-out and concealment
+ *
+ * The transport-independent part of the follower: takes packets with their
+ * arrival time, reassembles the fragments of each frame into slots and,
+ * when schedule() is called at or after a frame's play-out time, publishes
+ * it (repairing missing fragments, or blending in place of lost frames).
+ * No sockets, clocks or logging, so it also builds on the host for tests.
+ *
+ * The leader's clock is mapped with a running minimum of (arrival -
+ * sent-at): the fastest packet has the least queueing, and the minimum
+ * creeps up slowly so clock drift in either direction is followed.
+ */
+class ClusterReceiver {
+public:
+    ClusterReceiver();
+    ~ClusterReceiver() { release(); }
+
+    void configure(uint8_t nodeId, ClusterConceal conceal);
+    uint8_t getNodeId() const { return nodeId_; }
+    ClusterConceal getConceal() const { return conceal_; }
+
+    // Pixel buffers for every slot, the last frame and blending: one
+    // allocation, held only while this node is a follower
+    bool allocate();
+    void release();
+
+    // Forget buffered frames and the leader's clock (leader went silent;
+    // a restart is detected from the frame numbers). Counted in resets
+    void resetLeader();
+    void resetStats();
+
+    // Handle one packet; false if it was ignored (not for this node,
+    // malformed, late or no slot free)
+    bool receive(const uint8_t* packet, int size, uint32_t arrivalUs);
+
+    // Publish whatever is due at nowUs; true if getOutput() changed
+    bool schedule(uint32_t nowUs);
+
+    // Latest published pixels (a frame or a blend), valid until the next
+    // receive() or schedule()
+    const CRGB* getOutput() const { return output_; }
+    uint16_t getOutputCount() const { return outputCount_; }
+    uint32_t getOutputUs() const { return publishedUs_; }
+
+    bool hasLeaderClock() const { return offsetValid_; }
+    const ClusterFollowerStats& getStats() const { return stats_; }
+    const Histogram& getPlayoutError() const { return playoutError_; }
+    uint32_t getCadenceUs() const { return cadenceUs_; }
+    uint32_t getLastFrame() const { return lastShownFrame_; }
+
+private:
+    struct Slot {
+        uint32_t frame;
+        uint32_t playAt;          // Leader clock
+        uint16_t total;
+        uint8_t fragments;        // Bitmask of received fragments
+        bool used;
+    };
+
+    uint8_t nodeId_;
+    ClusterConceal conceal_;
+
+    Slot slots_[CLUSTER_SLOTS];
+    CRGB* pixels_;
+    CRGB* slotPixels_[CLUSTER_SLOTS];
+    CRGB* lastFrame_;
+    CRGB* work_;
+    const CRGB* output_;
+    uint16_t outputCount_;
+    uint16_t lastTotal_;
+    bool shownAny_;
+    uint32_t lastShownFrame_;
+    uint32_t lastShownPlayAt_;    // Leader clock
+    uint32_t nextConcealUs_;      // Local time of the next interpolated frame
+    uint32_t newestFrame_;
+    uint32_t newestPlayAt_;
+    uint32_t cadenceUs_;
+    uint32_t publishedUs_;
+
+    // Leader clock mapping: local = leader + offset
+    uint32_t offsetUs_;
+    bool offsetValid_;
+
+    ClusterFollowerStats stats_;
+    Histogram playoutError_;      // Publish time - scheduled time
+
+    void reset();
+    void publish(uint8_t slot, uint32_t nowUs, uint32_t dueUs);
+    int slotFor(uint32_t frame);
+    bool isComplete(const Slot& slot) const;
+    uint32_t toLocal(uint32_t leaderUs) const { return leaderUs + offsetUs_; }
+};
+
+} // namespace lume
+
+#endif // LUME_PROTOCOL_CLUSTER_CORE_H
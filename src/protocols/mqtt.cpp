@@ -1,7 +1,9 @@
 #include "mqtt.h"
 #include "../logging.h"
+#include "../core/json_pool.h"
 #include "../constants.h"
 #include <WiFi.h>
+#include <sys/time.h>
 
 namespace lume {
 
@@ -16,95 +18,158 @@ MqttProtocol::MqttProtocol() : client_(wifiClient_) {
 }
 
 void MqttProtocol::begin(const MqttConfig& config, LumeController* controller) {
-    config_ = config;
     controller_ = controller;
     
-    if (!config_.isValid()) {
+    if (!config.isValid()) {
         LOG_INFO(LogTag::MAIN, "MQTT disabled");
         return;
     }
     
-    // Generate client ID if not set
-    if (config_.clientId.isEmpty()) {
-        config_.clientId = "lume-" + String((uint32_t)ESP.getEfuseMac(), HEX);
-    }
-    
-    client_.setServer(config_.broker.c_str(), config_.port);
-    client_.setKeepAlive(config_.keepAlive);
-    
-    LOG_INFO(LogTag::MAIN, "MQTT configured: %s:%d", config_.broker.c_str(), config_.port);
+    setConfig(config);
+    LOG_INFO(LogTag::MAIN, "MQTT configured: %s:%d", config.broker.c_str(), config.port);
 }
 
 void MqttProtocol::end() {
-    if (client_.connected()) {
-        // Publish offline status before disconnecting
-        String statusTopic = buildTopic("status");
-        client_.publish(statusTopic.c_str(), "offline", true);
-        client_.disconnect();
-    }
-    config_.enabled = false;
+    MqttConfig disabled;
+    setConfig(disabled);
 }
 
-void MqttProtocol::update() {
-    if (!config_.isValid() || !WiFi.isConnected()) {
+void MqttProtocol::setConfig(const MqttConfig& config) {
+    // Nothing to tell a task that was never started
+    if (!task_ && !config.isValid()) {
         return;
     }
+    startTask();
     
-    // Handle reconnection
-    if (!client_.connected()) {
-        if (wasConnected_) {
-            LOG_WARN(LogTag::MAIN, "MQTT disconnected");
-            wasConnected_ = false;
-        }
-        reconnect();
-    } else {
-        if (!wasConnected_) {
-            wasConnected_ = true;
-        }
-        
-        // Process incoming messages
-        client_.loop();
+    xSemaphoreTake(configLock_, portMAX_DELAY);
+    pendingConfig_ = config;
+    configPending_ = true;
+    xSemaphoreGive(configLock_);
+}
+
+void MqttProtocol::startTask() {
+    if (task_) {
+        return;
+    }
+    configLock_ = xSemaphoreCreateMutex();
+    outbox_ = xQueueCreate(OUTBOX_SIZE, sizeof(OutboxMessage));
+    groupQueue_ = xQueueCreate(MAX_GROUPS, sizeof(GroupCommand));
+    xTaskCreatePinnedToCore(taskEntry, "mqtt", MQTT_TASK_STACK_SIZE, this,
+                            MQTT_TASK_PRIORITY, &task_, MQTT_TASK_CORE);
+}
+
+void MqttProtocol::taskEntry(void* param) {
+    static_cast<MqttProtocol*>(param)->taskLoop();
+}
+
+void MqttProtocol::taskLoop() {
+    for (;;) {
+        applyPendingConfig();
         
-        // Periodic state publish
-        if (millis() - lastStatePublish_ >= STATE_PUBLISH_INTERVAL_MS) {
-            publishState();
+        if (!config_.isValid() || !WiFi.isConnected()) {
+            connected_ = false;
+            vTaskDelay(pdMS_TO_TICKS(IDLE_INTERVAL_MS));
+            continue;
         }
         
-        // Publish on state change
-        if (stateChanged()) {
-            publishState();
+        if (!client_.connected()) {
+            if (connected_) {
+                LOG_WARN(LogTag::MAIN, "MQTT disconnected");
+                connected_ = false;
+            }
+            if ((int32_t)(millis() - nextConnectAttempt_) >= 0) {
+                reconnect();
+            }
+        } else {
+            // Process incoming messages, then send what the main loop queued
+            client_.loop();
+            drainOutbox();
+            publishGroupStatus();
         }
+        
+        vTaskDelay(pdMS_TO_TICKS(connected_ ? TASK_INTERVAL_MS : IDLE_INTERVAL_MS));
     }
 }
 
-void MqttProtocol::setConfig(const MqttConfig& config) {
-    bool wasEnabled = config_.enabled && client_.connected();
+void MqttProtocol::applyPendingConfig() {
+    if (!configPending_) {
+        return;
+    }
+    xSemaphoreTake(configLock_, portMAX_DELAY);
+    MqttConfig config = pendingConfig_;
+    configPending_ = false;
+    xSemaphoreGive(configLock_);
     
+    disconnect();
     config_ = config;
+    if (!config_.isValid()) {
+        groupCount_ = 0;
+        return;
+    }
     
-    if (wasEnabled && !config_.isValid()) {
-        end();
-    } else if (config_.isValid()) {
-        if (client_.connected()) {
-            client_.disconnect();
-        }
-        client_.setServer(config_.broker.c_str(), config_.port);
-        client_.setKeepAlive(config_.keepAlive);
+    // Generate client ID if not set
+    if (config_.clientId.isEmpty()) {
+        config_.clientId = "lume-" + String((uint32_t)ESP.getEfuseMac(), HEX);
+    }
+    
+    buildTopics();
+    parseGroups();
+    
+    // PubSubClient keeps the pointer: config_ owns the string
+    client_.setServer(config_.broker.c_str(), config_.port);
+    client_.setKeepAlive(config_.keepAlive);
+    retryDelayMs_ = RECONNECT_MIN_MS;
+    nextConnectAttempt_ = millis();
+}
+
+bool MqttProtocol::publish(const char* suffix, const char* payload, bool retain) {
+    return enqueue(suffix, payload, retain, false);
+}
+
+bool MqttProtocol::enqueue(const char* suffix, const char* payload, bool retain, bool group) {
+    if (!outbox_) {
+        return false;
+    }
+    OutboxMessage msg;
+    strlcpy(msg.suffix, suffix, sizeof(msg.suffix));
+    strlcpy(msg.payload, payload, sizeof(msg.payload));
+    msg.retain = retain;
+    msg.group = group;
+    
+    if (xQueueSend(outbox_, &msg, 0) != pdTRUE) {
+        // Full: drop oldest, then send new (newest wins)
+        OutboxMessage discard;
+        xQueueReceive(outbox_, &discard, 0);
+        xQueueSend(outbox_, &msg, 0);
+        outboxDropped_++;
+        return false;
+    }
+    return true;
+}
+
+void MqttProtocol::drainOutbox() {
+    OutboxMessage msg;
+    char fullTopic[TOPIC_SIZE];
+    while (client_.connected() && xQueueReceive(outbox_, &msg, 0) == pdTRUE) {
+        // {root}/{suffix}: the root and its length are kept from buildTopics()
+        size_t length = msg.group ? groupRootLength_ : prefixLength_;
+        memcpy(fullTopic, msg.group ? groupRoot_ : prefix_, length);
+        fullTopic[length] = '/';
+        strlcpy(fullTopic + length + 1, msg.suffix, sizeof(fullTopic) - length - 1);
+        client_.publish(fullTopic, msg.payload, msg.retain);
     }
 }
 
 bool MqttProtocol::connect() {
     if (!config_.isValid()) return false;
     
-    String statusTopic = buildTopic("status");
-    
     bool connected = false;
     if (config_.username.length() > 0) {
         connected = client_.connect(
             config_.clientId.c_str(),
             config_.username.c_str(),
             config_.password.c_str(),
-            statusTopic.c_str(),  // LWT topic
+            topic(Topic::Status),  // LWT topic
             0,                     // QoS
             true,                  // Retain
             "offline"              // LWT message
@@ -112,7 +177,7 @@ bool MqttProtocol::connect() {
     } else {
         connected = client_.connect(
             config_.clientId.c_str(),
-            statusTopic.c_str(),
+            topic(Topic::Status),
             0,
             true,
             "offline"
@@ -121,117 +186,310 @@ bool MqttProtocol::connect() {
     
     if (connected) {
         LOG_INFO(LogTag::MAIN, "MQTT connected to %s", config_.broker.c_str());
+        // Anything queued while offline is stale: every field follows
+        xQueueReset(outbox_);
         publishAvailability();
+        publishInfo();
         subscribe();
-        publishState();
         publishDiscovery();
+        connected_ = true;
+        stateRequested_ = true;
         return true;
     }
     
-    LOG_WARN(LogTag::MAIN, "MQTT connect failed, rc=%d", client_.state());
+    LOG_WARN(LogTag::MAIN, "MQTT connect failed, rc=%d, retry in %lus",
+             client_.state(), (unsigned long)(retryDelayMs_ / 1000));
     return false;
 }
 
 void MqttProtocol::disconnect() {
     if (client_.connected()) {
-        String statusTopic = buildTopic("status");
-        client_.publish(statusTopic.c_str(), "offline", true);
+        client_.publish(topic(Topic::Status), "offline", true);
         client_.disconnect();
     }
+    connected_ = false;
 }
 
 void MqttProtocol::reconnect() {
-    unsigned long now = millis();
+    lastConnectAttempt_ = millis();
+    reconnectCount_++;
     
-    if (now - lastConnectAttempt_ < RECONNECT_INTERVAL_MS) {
+    LOG_DEBUG(LogTag::MAIN, "MQTT reconnecting (attempt %d)", reconnectCount_);
+    if (connect()) {
+        retryDelayMs_ = RECONNECT_MIN_MS;
         return;
     }
     
-    lastConnectAttempt_ = now;
-    reconnectCount_++;
-    
-    LOG_DEBUG(LogTag::MAIN, "MQTT reconnecting (attempt %d)", reconnectCount_);
-    connect();
+    // Exponential backoff; the jitter keeps a fleet from retrying in lockstep
+    // after a broker restart
+    uint32_t jitter = esp_random() % (retryDelayMs_ / 4 + 1);
+    nextConnectAttempt_ = millis() + retryDelayMs_ + jitter;
+    retryDelayMs_ = min(retryDelayMs_ * 2, RECONNECT_MAX_MS);
 }
 
-String MqttProtocol::buildTopic(const char* suffix) const {
-    return config_.topicPrefix + "/" + suffix;
+void MqttProtocol::buildTopics() {
+    static const char* const SUFFIXES[] = {
+        "status", "info", "state", "set", "power/set", "brightness/set", "effect/set"
+    };
+    static_assert(sizeof(SUFFIXES) / sizeof(SUFFIXES[0]) == static_cast<uint8_t>(Topic::Discovery),
+                  "one suffix per topic before Discovery");
+    
+    strlcpy(prefix_, config_.topicPrefix.c_str(), sizeof(prefix_));
+    prefixLength_ = strlen(prefix_);
+    snprintf(groupRoot_, sizeof(groupRoot_), "%s/group", config_.groupPrefix.c_str());
+    groupRootLength_ = strlen(groupRoot_);
+    for (uint8_t i = 0; i < static_cast<uint8_t>(Topic::Discovery); i++) {
+        snprintf(topics_[i], TOPIC_SIZE, "%s/%s", prefix_, SUFFIXES[i]);
+    }
+    
+    // homeassistant/light/{device_id}/config
+    String deviceId = config_.clientId;
+    deviceId.replace("-", "_");
+    snprintf(topics_[static_cast<uint8_t>(Topic::Discovery)], TOPIC_SIZE,
+             "homeassistant/light/%s/config", deviceId.c_str());
 }
 
 void MqttProtocol::subscribe() {
     // Subscribe to command topics
-    client_.subscribe(buildTopic("set").c_str());
-    client_.subscribe(buildTopic("brightness/set").c_str());
-    client_.subscribe(buildTopic("effect/set").c_str());
-    client_.subscribe(buildTopic("power/set").c_str());
+    client_.subscribe(topic(Topic::Set));
+    client_.subscribe(topic(Topic::BrightnessSet));
+    client_.subscribe(topic(Topic::EffectSet));
+    client_.subscribe(topic(Topic::PowerSet));
+    for (uint8_t i = 0; i < groupCount_; i++) {
+        client_.subscribe(groupSetTopics_[i]);
+        client_.subscribe(groupAckTopics_[i]);
+    }
     
     LOG_DEBUG(LogTag::MAIN, "MQTT subscribed to command topics");
 }
 
 void MqttProtocol::publishAvailability() {
-    String topic = buildTopic("status");
-    client_.publish(topic.c_str(), "online", true);
+    client_.publish(topic(Topic::Status), "online", true);
 }
 
-void MqttProtocol::publishState() {
-    if (!client_.connected() || !controller_) return;
+void MqttProtocol::publishInfo() {
+    // Static while connected: published once instead of with every state
+    JsonDocument doc(JSON_SITE("mqtt.info"));
+    doc["ip"] = WiFi.localIP().toString();
+    doc["version"] = FIRMWARE_VERSION;
+    doc["clientId"] = config_.clientId;
+    
+    char payload[OUTBOX_PAYLOAD_SIZE];
+    serializeJson(doc, payload, sizeof(payload));
+    client_.publish(topic(Topic::Info), payload, true);
+}
+
+size_t MqttProtocol::outboxSpace() const {
+    return outbox_ ? uxQueueSpacesAvailable(outbox_) : 0;
+}
+
+bool MqttProtocol::queueField(const char* suffix, const char* payload) {
+    if (outboxSpace() == 0) {
+        return false;
+    }
+    publish(suffix, payload, true);
+    return true;
+}
+
+void MqttProtocol::update() {
+    if (!controller_) {
+        return;
+    }
     
-    JsonDocument doc;
+    // Checked every loop, not just every publish interval: the time it
+    // runs at is the time the commands take effect
+    applyGroupCommands();
     
-    // Basic state
-    doc["power"] = controller_->getPower();
-    doc["brightness"] = controller_->getBrightness();
+    if (!connected_) {
+        return;
+    }
     
-    // Current effect (from first segment)
-    if (controller_->getSegmentCount() > 0) {
-        const auto* seg = controller_->getSegment(0);
-        if (seg) {
-            doc["effect"] = seg->getEffectId();
+    // After a (re)connect every field is published again; otherwise changes
+    // are collected for a moment so a slider drag isn't sent step by step
+    if (stateRequested_) {
+        stateRequested_ = false;
+        // Only the flags: the state is too big to rebuild on the stack
+        published_.powerKnown = false;
+        published_.brightnessKnown = false;
+        published_.lightKnown = false;
+        for (PublishedSegment& seg : published_.segments) {
+            seg.known = false;
         }
+    } else if (millis() - lastPublish_ < PUBLISH_MIN_INTERVAL_MS) {
+        return;
     }
+    lastPublish_ = millis();
     
-    // System info
-    doc["uptime"] = millis() / 1000;
-    doc["heap_free"] = ESP.getFreeHeap();
-    doc["ip"] = WiFi.localIP().toString();
+    publishFields();
+}
+
+bool MqttProtocol::publishFields() {
+    // Targets rather than the current levels: a fade in progress
+    // reports where it's going, once
+    bool power = controller_->getTargetPower();
+    if (!published_.powerKnown || power != published_.power) {
+        if (!queueField("power", power ? "ON" : "OFF")) return false;
+        published_.powerKnown = true;
+        published_.power = power;
+    }
     
-    String payload;
-    serializeJson(doc, payload);
+    uint8_t brightness = controller_->getTargetBrightness();
+    if (!published_.brightnessKnown || brightness != published_.brightness) {
+        char value[4];
+        snprintf(value, sizeof(value), "%u", brightness);
+        if (!queueField("brightness", value)) return false;
+        published_.brightnessKnown = true;
+        published_.brightness = brightness;
+    }
     
-    String topic = buildTopic("state");
-    client_.publish(topic.c_str(), payload.c_str(), true);
+    if (!publishLightState()) return false;
     
-    lastStatePublish_ = millis();
-    updateStateHash();
+    for (uint8_t id = 0; id < MAX_SEGMENTS; id++) {
+        if (!publishSegment(id, controller_->getSegment(id))) return false;
+    }
+    return true;
+}
+
+// Home Assistant's JSON-schema light state, built from the first segment
+bool MqttProtocol::publishLightState() {
+    bool power = controller_->getTargetPower();
+    uint8_t brightness = controller_->getTargetBrightness();
+    const Segment* seg = controller_->getSegment(0);
+    const EffectInfo* effect = seg ? seg->getEffect() : nullptr;
+    
+    if (published_.lightKnown && power == published_.lightPower &&
+        brightness == published_.lightBrightness && effect == published_.lightEffect) {
+        return true;
+    }
+    
+    JsonDocument doc(JSON_SITE("mqtt.state"));
+    doc["state"] = power ? "ON" : "OFF";
+    doc["brightness"] = brightness;
+    doc["color_mode"] = "brightness";
+    if (effect) {
+        doc["effect"] = effect->id;
+    }
+    
+    char payload[OUTBOX_PAYLOAD_SIZE];
+    serializeJson(doc, payload, sizeof(payload));
+    if (!queueField("state", payload)) return false;
+    
+    published_.lightKnown = true;
+    published_.lightPower = power;
+    published_.lightBrightness = brightness;
+    published_.lightEffect = effect;
+    return true;
+}
+
+static bool slotEquals(ParamType type, const ParamValues::Slot& a, const ParamValues::Slot& b) {
+    switch (type) {
+        case ParamType::Int:   return a.intVal == b.intVal;
+        case ParamType::Enum:  return a.enumVal == b.enumVal;
+        case ParamType::Bool:  return a.boolVal == b.boolVal;
+        case ParamType::Float: return a.floatVal == b.floatVal;
+        case ParamType::Color: return a.colorVal == b.colorVal;
+        case ParamType::Palette: break;
+    }
+    return true;
+}
+
+static void formatSlot(ParamType type, const ParamValues::Slot& slot, char* out, size_t size) {
+    switch (type) {
+        case ParamType::Int:   snprintf(out, size, "%u", slot.intVal); break;
+        case ParamType::Enum:  snprintf(out, size, "%u", slot.enumVal); break;
+        case ParamType::Bool:  snprintf(out, size, "%s", slot.boolVal ? "true" : "false"); break;
+        case ParamType::Float: snprintf(out, size, "%g", slot.floatVal); break;
+        case ParamType::Color:
+            snprintf(out, size, "#%02x%02x%02x", slot.colorVal.r, slot.colorVal.g, slot.colorVal.b);
+            break;
+        case ParamType::Palette: out[0] = '\0'; break;
+    }
+}
+
+static uint8_t paramCount(const EffectInfo* effect) {
+    return (effect && effect->schema) ? min(effect->schema->count, MAX_EFFECT_PARAMS) : 0;
+}
+
+bool MqttProtocol::publishSegment(uint8_t id, Segment* seg) {
+    static_assert(OUTBOX_SIZE >= 1 + 2 * MAX_EFFECT_PARAMS, "outbox too small for an effect change");
+    
+    PublishedSegment& last = published_.segments[id];
+    const EffectInfo* effect = seg ? seg->getEffect() : nullptr;
+    char suffix[TOPIC_SUFFIX_SIZE];
+    char value[24];
+    
+    if (!last.known || (seg != nullptr) != last.present || effect != last.effect) {
+        // The effect, the old effect's params cleared and the new ones set
+        // are queued together, or not at all
+        uint8_t oldCount = last.known ? paramCount(last.effect) : 0;
+        uint8_t newCount = paramCount(effect);
+        if (outboxSpace() < 1u + oldCount + newCount) return false;
+        
+        // An empty retained payload removes the topic
+        snprintf(suffix, sizeof(suffix), "segment/%u/effect", id);
+        queueField(suffix, effect ? effect->id : "");
+        
+        for (uint8_t i = 0; i < oldCount; i++) {
+            const char* paramId = last.effect->schema->params[i].id;
+            if (newCount == 0 || !effect->schema->find(paramId)) {
+                queueField(last.paramSuffixes[i], "");
+            }
+        }
+        // Param topics are formatted here, once per effect, not per change
+        for (uint8_t i = 0; i < newCount; i++) {
+            const ParamDesc& desc = effect->schema->params[i];
+            snprintf(last.paramSuffixes[i], TOPIC_SUFFIX_SIZE, "segment/%u/param/%s", id, desc.id);
+            last.params[i] = seg->getParamValues().slots[i];
+            if (desc.type == ParamType::Palette) continue;
+            formatSlot(desc.type, last.params[i], value, sizeof(value));
+            queueField(last.paramSuffixes[i], value);
+        }
+        
+        last.known = true;
+        last.present = seg != nullptr;
+        last.effect = effect;
+        return true;
+    }
     
-    LOG_DEBUG(LogTag::MAIN, "MQTT state published");
+    for (uint8_t i = 0; i < paramCount(effect); i++) {
+        const ParamDesc& desc = effect->schema->params[i];
+        const ParamValues::Slot& slot = seg->getParamValues().slots[i];
+        if (desc.type == ParamType::Palette || slotEquals(desc.type, slot, last.params[i])) {
+            continue;
+        }
+        formatSlot(desc.type, slot, value, sizeof(value));
+        if (!queueField(last.paramSuffixes[i], value)) return false;
+        last.params[i] = slot;
+    }
+    return true;
 }
 
 void MqttProtocol::publishDiscovery() {
     // Home Assistant MQTT Discovery
     // https://www.home-assistant.io/integrations/mqtt/#mqtt-discovery
     
-    if (!client_.connected() || !controller_) return;
+    if (!client_.connected()) return;
     
     String deviceId = config_.clientId;
     deviceId.replace("-", "_");
     
     // Light entity discovery
-    JsonDocument doc;
+    JsonDocument doc(JSON_SITE("mqtt.discovery"));
     
     doc["name"] = "LUME";
     doc["unique_id"] = deviceId + "_light";
     doc["schema"] = "json";
     
-    doc["state_topic"] = buildTopic("state");
-    doc["command_topic"] = buildTopic("set");
-    doc["availability_topic"] = buildTopic("status");
+    doc["state_topic"] = topic(Topic::State);
+    doc["command_topic"] = topic(Topic::Set);
+    doc["availability_topic"] = topic(Topic::Status);
     
-    doc["brightness"] = true;
+    // Brightness-only light; the JSON schema handles "transition" itself
+    doc["supported_color_modes"].to<JsonArray>().add("brightness");
     doc["brightness_scale"] = 255;
     doc["effect"] = true;
     
-    // List available effects
+    // List available effects (the registry is fixed after startup)
     JsonArray effects = doc["effect_list"].to<JsonArray>();
     auto& registry = EffectRegistry::instance();
     for (size_t i = 0; i < registry.getCount(); i++) {
@@ -248,174 +506,366 @@ void MqttProtocol::publishDiscovery() {
     
     String payload;
     serializeJson(doc, payload);
-    
-    // Discovery topic: homeassistant/light/{device_id}/config
-    String discoveryTopic = "homeassistant/light/" + deviceId + "/config";
-    client_.publish(discoveryTopic.c_str(), payload.c_str(), true);
+    client_.publish(topic(Topic::Discovery), payload.c_str(), true);
     
     LOG_INFO(LogTag::MAIN, "MQTT HA discovery published");
 }
 
 void MqttProtocol::messageCallback(char* topic, byte* payload, unsigned int length) {
     if (!instance_) return;
-    
-    String topicStr(topic);
-    String payloadStr;
-    payloadStr.reserve(length + 1);
-    for (unsigned int i = 0; i < length; i++) {
-        payloadStr += (char)payload[i];
-    }
-    
-    instance_->handleMessage(topicStr, payloadStr);
+    instance_->handleMessage(topic, reinterpret_cast<const char*>(payload), length);
 }
 
-void MqttProtocol::handleMessage(const String& topic, const String& payload) {
-    LOG_DEBUG(LogTag::MAIN, "MQTT recv: %s", topic.c_str());
-    
-    String prefix = config_.topicPrefix + "/";
-    
-    if (!topic.startsWith(prefix)) {
-        return;
+// Copy a short text payload (not null-terminated), trimmed
+static void copyPayload(char* out, size_t size, const char* payload, unsigned int length) {
+    while (length > 0 && isspace((unsigned char)*payload)) {
+        payload++;
+        length--;
     }
+    while (length > 0 && isspace((unsigned char)payload[length - 1])) {
+        length--;
+    }
+    size_t n = min((size_t)length, size - 1);
+    memcpy(out, payload, n);
+    out[n] = '\0';
+}
+
+static bool parseOnOff(const char* value) {
+    return strcasecmp(value, "ON") == 0 || strcasecmp(value, "TRUE") == 0 || strcmp(value, "1") == 0;
+}
+
+void MqttProtocol::handleMessage(const char* received, const char* payload, unsigned int length) {
+    LOG_DEBUG(LogTag::MAIN, "MQTT recv: %s", received);
     
-    String suffix = topic.substring(prefix.length());
-    
-    if (suffix == "set") {
+    char text[48];
+    if (strcmp(received, topic(Topic::Set)) == 0) {
         // JSON command
-        JsonDocument doc;
-        if (deserializeJson(doc, payload) == DeserializationError::Ok) {
+        JsonDocument doc(JSON_SITE("mqtt.command"));
+        if (deserializeJson(doc, payload, length) == DeserializationError::Ok) {
             handleSetCommand(doc);
         }
-    } else if (suffix == "brightness/set") {
-        handleBrightnessSet(payload);
-    } else if (suffix == "effect/set") {
-        handleEffectSet(payload);
-    } else if (suffix == "power/set") {
-        handlePowerSet(payload);
+    } else if (strcmp(received, topic(Topic::BrightnessSet)) == 0) {
+        copyPayload(text, sizeof(text), payload, length);
+        handleBrightnessSet(text);
+    } else if (strcmp(received, topic(Topic::EffectSet)) == 0) {
+        copyPayload(text, sizeof(text), payload, length);
+        handleEffectSet(text);
+    } else if (strcmp(received, topic(Topic::PowerSet)) == 0) {
+        copyPayload(text, sizeof(text), payload, length);
+        handlePowerSet(text);
+    } else {
+        for (uint8_t i = 0; i < groupCount_; i++) {
+            bool set = strcmp(received, groupSetTopics_[i]) == 0;
+            if (!set && strcmp(received, groupAckTopics_[i]) != 0) {
+                continue;
+            }
+            JsonDocument doc(JSON_SITE("mqtt.group"));
+            if (deserializeJson(doc, payload, length) != DeserializationError::Ok) {
+                LOG_WARN(LogTag::MAIN, "MQTT: bad JSON on %s", received);
+            } else if (set) {
+                handleGroupSet(i, doc);
+            } else {
+                handleGroupAck(i, doc);
+            }
+            break;
+        }
     }
 }
 
-void MqttProtocol::handleSetCommand(const JsonDocument& doc) {
-    if (!controller_) return;
-    
-    // Power state
-    if (doc["state"].is<const char*>()) {
-        String state = doc["state"].as<String>();
-        state.toUpperCase();
-        controller_->setPower(state == "ON" || state == "TRUE" || state == "1");
-    }
-    
-    // Brightness
-    if (doc["brightness"].is<int>()) {
-        controller_->setBrightness(doc["brightness"].as<uint8_t>());
+// Commands apply to the first segment, as before; the controller ignores
+// them if it doesn't exist when they run. The state publish that confirms
+// them comes from update() once the main loop has applied them.
+uint8_t MqttProtocol::parseCommands(const JsonDocument& doc, Command* out, uint8_t capacity) {
+    Command commands[GROUP_MAX_COMMANDS];
+    uint8_t count = 0;
+    
+    bool hasState = doc["state"].is<const char*>();
+    bool hasBrightness = doc["brightness"].is<int>();
+    
+    if (doc["transition"].is<float>() && (hasState || hasBrightness)) {
+        // Home Assistant sends seconds
+        float seconds = constrain(doc["transition"].as<float>(), 0.0f, MAX_TRANSITION_MS / 1000.0f);
+        bool on = hasState ? parseOnOff(doc["state"]) : controller_->getTargetPower();
+        int16_t brightness = hasBrightness ? (int16_t)constrain(doc["brightness"].as<int>(), 0, 255) : -1;
+        commands[count++] = Command::transition(on, brightness, (uint16_t)(seconds * 1000));
+    } else {
+        // Power state
+        if (hasState) {
+            commands[count++] = Command::setPower(parseOnOff(doc["state"]));
+        }
+        
+        // Brightness
+        if (hasBrightness) {
+            commands[count++] = Command::setGlobalBrightness(doc["brightness"].as<uint8_t>());
+        }
     }
     
     // Effect
     if (doc["effect"].is<const char*>()) {
-        String effect = doc["effect"].as<String>();
-        // Apply to first segment for now
-        if (controller_->getSegmentCount() > 0) {
-            auto* seg = controller_->getSegment(0);
-            if (seg) seg->setEffect(effect.c_str());
+        const EffectInfo* info = findEffect(doc["effect"].as<const char*>());
+        if (info) {
+            commands[count++] = Command::setEffect(0, info->id);
         }
     }
     
     // Speed
     if (doc["speed"].is<int>()) {
-        if (controller_->getSegmentCount() > 0) {
-            auto* seg = controller_->getSegment(0);
-            if (seg) seg->setSpeed(doc["speed"].as<uint8_t>());
-        }
+        commands[count++] = Command::setSpeed(0, doc["speed"].as<uint8_t>());
     }
     
     // Intensity
     if (doc["intensity"].is<int>()) {
-        if (controller_->getSegmentCount() > 0) {
-            auto* seg = controller_->getSegment(0);
-            if (seg) seg->setIntensity(doc["intensity"].as<uint8_t>());
-        }
+        commands[count++] = Command::setIntensity(0, doc["intensity"].as<uint8_t>());
     }
     
-    // Immediate state publish to confirm
-    publishState();
+    count = min(count, capacity);
+    for (uint8_t i = 0; i < count; i++) {
+        out[i] = commands[i];
+    }
+    return count;
 }
 
-void MqttProtocol::handleBrightnessSet(const String& payload) {
+void MqttProtocol::handleSetCommand(const JsonDocument& doc) {
     if (!controller_) return;
     
-    int brightness = payload.toInt();
-    if (brightness >= 0 && brightness <= 255) {
-        controller_->setBrightness(brightness);
-        publishState();
+    Command commands[GROUP_MAX_COMMANDS];
+    uint8_t count = parseCommands(doc, commands, GROUP_MAX_COMMANDS);
+    for (uint8_t i = 0; i < count; i++) {
+        controller_->enqueueCommand(commands[i]);
     }
 }
 
-void MqttProtocol::handleEffectSet(const String& payload) {
-    if (!controller_ || controller_->getSegmentCount() == 0) return;
+void MqttProtocol::handleBrightnessSet(const char* payload) {
+    if (!controller_) return;
     
-    auto* seg = controller_->getSegment(0);
-    if (seg) {
-        seg->setEffect(payload.c_str());
-        publishState();
+    int brightness = atoi(payload);
+    if (brightness >= 0 && brightness <= 255) {
+        controller_->enqueueCommand(Command::setGlobalBrightness(brightness));
     }
 }
 
-void MqttProtocol::handlePowerSet(const String& payload) {
+void MqttProtocol::handleEffectSet(const char* payload) {
     if (!controller_) return;
     
-    String state = payload;
-    state.toUpperCase();
-    state.trim();
+    const EffectInfo* info = findEffect(payload);
+    if (info) {
+        controller_->enqueueCommand(Command::setEffect(0, info->id));
+    }
+}
+
+void MqttProtocol::handlePowerSet(const char* payload) {
+    if (!controller_) return;
+    controller_->enqueueCommand(Command::setPower(parseOnOff(payload)));
+}
+
+// Commands carry the registry's id: the payload buffer won't outlive the call
+const EffectInfo* MqttProtocol::findEffect(const char* effectId) {
+    const EffectInfo* info = effects().getInfo(effectId);
+    if (!info) {
+        LOG_WARN(LogTag::MAIN, "MQTT: unknown effect '%s'", effectId);
+    }
+    return info;
+}
+
+// ============================================
+// Groups
+// ============================================
+
+// Wall clock in milliseconds (SNTP); 0 until it has been set
+static int64_t unixTimeMs() {
+    struct timeval tv;
+    gettimeofday(&tv, nullptr);
+    if (tv.tv_sec < 1700000000) {
+        return 0;
+    }
+    return (int64_t)tv.tv_sec * 1000 + tv.tv_usec / 1000;
+}
+
+static bool validGroupName(const String& name) {
+    return name.length() > 0 && name.indexOf('/') < 0 && name.indexOf('+') < 0 && name.indexOf('#') < 0;
+}
+
+void MqttProtocol::parseGroups() {
+    uint8_t count = 0;
+    int start = 0;
+    while (start <= (int)config_.groups.length()) {
+        int comma = config_.groups.indexOf(',', start);
+        if (comma < 0) {
+            comma = config_.groups.length();
+        }
+        String name = config_.groups.substring(start, comma);
+        name.trim();
+        start = comma + 1;
+        
+        if (name.isEmpty()) {
+            continue;
+        }
+        if (!validGroupName(name) || name.length() >= GROUP_NAME_SIZE) {
+            LOG_WARN(LogTag::MAIN, "MQTT: ignoring group '%s'", name.c_str());
+            continue;
+        }
+        if (count == MAX_GROUPS) {
+            LOG_WARN(LogTag::MAIN, "MQTT: at most %u groups, ignoring '%s'", MAX_GROUPS, name.c_str());
+            continue;
+        }
+        strlcpy(groups_[count], name.c_str(), GROUP_NAME_SIZE);
+        snprintf(groupSetTopics_[count], TOPIC_SIZE, "%s/%s/set", groupRoot_, groups_[count]);
+        snprintf(groupAckTopics_[count], TOPIC_SIZE, "%s/%s/ack", groupRoot_, groups_[count]);
+        groupAcks_[count] = GroupAcks{};
+        count++;
+    }
+    groupCount_ = count;
     
-    bool power = (state == "ON" || state == "TRUE" || state == "1");
-    controller_->setPower(power);
-    publishState();
+    // Apply-at times are wall-clock times
+    if (count > 0 && !clockStarted_) {
+        configTime(0, 0, NTP_SERVER);
+        clockStarted_ = true;
+    }
 }
 
-void MqttProtocol::updateStateHash() {
+void MqttProtocol::handleGroupSet(uint8_t group, const JsonDocument& doc) {
     if (!controller_) return;
     
-    // Simple hash of key state values
-    uint32_t hash = 0;
-    hash ^= controller_->getPower() ? 1 : 0;
-    hash ^= controller_->getBrightness() << 8;
-    
-    if (controller_->getSegmentCount() > 0) {
-        const auto* seg = controller_->getSegment(0);
-        if (seg) {
-            // Hash effect name
-            const char* effectId = seg->getEffectId();
-            if (effectId) {
-                while (*effectId) {
-                    hash = hash * 31 + *effectId++;
-                }
-            }
-        }
+    GroupCommand cmd;
+    cmd.group = group;
+    strlcpy(cmd.name, groups_[group], sizeof(cmd.name));
+    strlcpy(cmd.client, config_.clientId.c_str(), sizeof(cmd.client));
+    cmd.id = doc["id"] | 0u;
+    cmd.atMs = doc["at"] | (int64_t)0;
+    cmd.unsynced = false;
+    cmd.count = parseCommands(doc, cmd.commands, GROUP_MAX_COMMANDS);
+    
+    int64_t now = unixTimeMs();
+    if (cmd.atMs > 0 && now == 0) {
+        // No wall clock yet: better on arrival than not at all
+        cmd.atMs = 0;
+        cmd.unsynced = true;
+    }
+    int64_t lead = cmd.atMs > 0 ? cmd.atMs - now : 0;
+    
+    // Start counting this command's acks, including our own
+    GroupAcks& acks = groupAcks_[group];
+    acks = GroupAcks{};
+    acks.collecting = true;
+    acks.id = cmd.id;
+    acks.deadlineMs = millis() + (uint32_t)constrain(lead, (int64_t)0, (int64_t)GROUP_MAX_LEAD_MS) + GROUP_ACK_WINDOW_MS;
+    
+    if (lead < -GROUP_EXPIRED_MS) {
+        // Probably a retained command from long ago
+        publishGroupAck(cmd, "expired", (int32_t)-lead);
+        return;
+    }
+    
+    // A newer command for the group replaces one still waiting
+    if (xQueueSend(groupQueue_, &cmd, 0) != pdTRUE) {
+        LOG_WARN(LogTag::MAIN, "MQTT: group queue full, dropping command %u", cmd.id);
+    }
+}
+
+void MqttProtocol::handleGroupAck(uint8_t group, const JsonDocument& doc) {
+    GroupAcks& acks = groupAcks_[group];
+    const char* client = doc["client"] | "";
+    if (!acks.collecting || (doc["id"] | 0u) != acks.id || !*client) {
+        return;
     }
     
-    lastStateHash_ = hash;
+    const char* result = doc["result"] | "";
+    int32_t lateMs = doc["lateMs"] | 0;
+    acks.acks++;
+    if (strcmp(result, "ok") == 0) acks.ok++;
+    else if (strcmp(result, "late") == 0) acks.late++;
+    else if (strcmp(result, "unsynced") == 0) acks.unsynced++;
+    else if (strcmp(result, "expired") == 0) acks.expired++;
+    
+    if (acks.acks == 1 || lateMs > acks.maxLateMs) {
+        acks.maxLateMs = lateMs;
+        strlcpy(acks.worst, client, sizeof(acks.worst));
+    }
+    if (!acks.lowest[0] || strcmp(client, acks.lowest) < 0) {
+        strlcpy(acks.lowest, client, sizeof(acks.lowest));
+    }
 }
 
-bool MqttProtocol::stateChanged() const {
-    if (!controller_) return false;
+void MqttProtocol::publishGroupStatus() {
+    for (uint8_t i = 0; i < groupCount_; i++) {
+        GroupAcks& acks = groupAcks_[i];
+        if (!acks.collecting || (int32_t)(millis() - acks.deadlineMs) < 0) {
+            continue;
+        }
+        acks.collecting = false;
+        
+        // Every member counted the same acks; one of them reports
+        if (acks.lowest[0] && strcmp(config_.clientId.c_str(), acks.lowest) > 0) {
+            continue;
+        }
+        
+        JsonDocument doc(JSON_SITE("mqtt.groupStatus"));
+        doc["id"] = acks.id;
+        doc["acks"] = acks.acks;
+        doc["ok"] = acks.ok;
+        doc["late"] = acks.late;
+        doc["unsynced"] = acks.unsynced;
+        doc["expired"] = acks.expired;
+        doc["maxLateMs"] = acks.maxLateMs;
+        doc["worst"] = acks.worst;
+        
+        char statusTopic[TOPIC_SIZE];
+        char payload[OUTBOX_PAYLOAD_SIZE + 64];
+        snprintf(statusTopic, sizeof(statusTopic), "%s/%s/status", groupRoot_, groups_[i]);
+        serializeJson(doc, payload, sizeof(payload));
+        client_.publish(statusTopic, payload, true);
+        
+        LOG_DEBUG(LogTag::MAIN, "MQTT group %s: %u acks for command %u",
+                  groups_[i], acks.acks, acks.id);
+    }
+}
+
+void MqttProtocol::applyGroupCommands() {
+    if (!groupQueue_) {
+        return;
+    }
     
-    uint32_t currentHash = 0;
-    currentHash ^= controller_->getPower() ? 1 : 0;
-    currentHash ^= controller_->getBrightness() << 8;
+    GroupCommand incoming;
+    while (xQueueReceive(groupQueue_, &incoming, 0) == pdTRUE) {
+        if (incoming.group < MAX_GROUPS) {
+            scheduled_[incoming.group] = incoming;
+            scheduledPending_[incoming.group] = true;
+        }
+    }
     
-    if (controller_->getSegmentCount() > 0) {
-        const auto* seg = controller_->getSegment(0);
-        if (seg) {
-            const char* effectId = seg->getEffectId();
-            if (effectId) {
-                while (*effectId) {
-                    currentHash = currentHash * 31 + *effectId++;
-                }
+    int64_t now = 0;
+    for (uint8_t i = 0; i < MAX_GROUPS; i++) {
+        if (!scheduledPending_[i]) {
+            continue;
+        }
+        const GroupCommand& cmd = scheduled_[i];
+        if (cmd.atMs > 0) {
+            now = now ? now : unixTimeMs();
+            if (now < cmd.atMs) {
+                continue;
             }
         }
+        
+        // Processed at the start of the controller's next frame
+        for (uint8_t c = 0; c < cmd.count; c++) {
+            controller_->enqueueCommand(cmd.commands[c]);
+        }
+        scheduledPending_[i] = false;
+        
+        int32_t lateMs = cmd.atMs > 0 ? (int32_t)(now - cmd.atMs) : 0;
+        const char* result = cmd.unsynced ? "unsynced" : lateMs > GROUP_ON_TIME_MS ? "late" : "ok";
+        publishGroupAck(cmd, result, lateMs);
     }
-    
-    return currentHash != lastStateHash_;
+}
+
+// Any task: goes through the outbox
+void MqttProtocol::publishGroupAck(const GroupCommand& cmd, const char* result, int32_t lateMs) {
+    char suffix[TOPIC_SUFFIX_SIZE];
+    char payload[OUTBOX_PAYLOAD_SIZE];
+    snprintf(suffix, sizeof(suffix), "%s/ack", cmd.name);
+    snprintf(payload, sizeof(payload), "{\"id\":%u,\"client\":\"%s\",\"result\":\"%s\",\"lateMs\":%d}",
+             (unsigned)cmd.id, cmd.client, result, (int)lateMs);
+    enqueue(suffix, payload, false, true);
 }
 
 }  // namespace lume
@@ -5,6 +5,10 @@
 #include <WiFiClient.h>
 #include <PubSubClient.h>
 #include <ArduinoJson.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
 #include "protocol.h"
 #include "../core/controller.h"
 
@@ -20,6 +24,8 @@ struct MqttConfig {
     String topicPrefix = "lume"; // Base topic (e.g., "lume" -> "lume/state")
     String clientId;            // Auto-generated if empty
     uint16_t keepAlive = 60;    // Keep-alive interval in seconds
+    String groups;              // Comma-separated group names (e.g., "kitchen,downstairs")
+    String groupPrefix = "lume"; // Shared by the fleet (e.g., "lume" -> "lume/group/kitchen/set")
     
     bool isValid() const {
         return enabled && broker.length() > 0;
@@ -28,12 +34,42 @@ struct MqttConfig {
 
 // MQTT topic structure:
 //   {prefix}/status        - Online/offline (LWT)
-//   {prefix}/state         - JSON state (published on change)
+//   {prefix}/info          - {"ip","version","clientId"} (on connect)
+//   {prefix}/state         - Home Assistant JSON-schema light state
+//   {prefix}/power         - ON/OFF
+//   {prefix}/brightness    - 0-255
+//   {prefix}/segment/{id}/effect       - Effect id ("" = no segment)
+//   {prefix}/segment/{id}/param/{name} - Param value, as text
 //   {prefix}/set           - JSON commands (subscribed)
 //   {prefix}/brightness/set - Brightness control
 //   {prefix}/effect/set    - Effect name
 //   {prefix}/power/set     - on/off
+// Everything published is retained, and each topic is only published when
+// its value changes (all of them again after a reconnect).
+//
+// Group topics, one set per configured group:
+//   {groupPrefix}/group/{name}/set    - JSON commands for every member (subscribed)
+//   {groupPrefix}/group/{name}/ack    - One ack per member and command (both ways)
+//   {groupPrefix}/group/{name}/status - Acks of the last command, counted (retained)
+// A group command may carry "at", a Unix time in milliseconds: members
+// hold it until then, so the whole group switches together. Every member
+// counts the acks it sees; when the window closes, the member with the
+// lowest client id publishes the counts.
 
+/**
+ * MqttProtocol - MQTT client on its own task
+ *
+ * PubSubClient blocks in connect() (DNS, TCP) for seconds when the broker
+ * is down, so everything that touches the socket runs on a dedicated task:
+ * connecting with exponential backoff, keep-alive, receiving, and sending.
+ * The main loop only calls update(), which compares the state field by
+ * field and queues a publish per changed field, without waiting. Received
+ * commands reach the controller through its command queue, like every
+ * other input.
+ *
+ * Publishes from any task go through a small outbox queue; when it's
+ * full the oldest message is dropped.
+ */
 class MqttProtocol {
 public:
     MqttProtocol();
@@ -41,65 +77,207 @@ public:
     // Lifecycle
     void begin(const MqttConfig& config, LumeController* controller);
     void end();
-    void update();  // Call from loop() for reconnection and message processing
+    void update();  // Call from loop(): applies due group commands, queues state publishes; never blocks
     
-    // Configuration
+    // Configuration (any task; the MQTT task reconnects with it)
     void setConfig(const MqttConfig& config);
     const MqttConfig& getConfig() const { return config_; }
     
-    // State publishing
-    void publishState();           // Publish full state
-    void publishAvailability();    // Publish online status
-    void publishDiscovery();       // Home Assistant MQTT discovery
+    // Queue a publish to {prefix}/{suffix} (any task); false if dropped
+    bool publish(const char* suffix, const char* payload, bool retain);
+    
+    // Groups this controller is a member of (as configured)
+    uint8_t getGroupCount() const { return groupCount_; }
     
     // Status
-    bool isConnected() { return client_.connected(); }
+    bool isConnected() const { return connected_; }
     bool isEnabled() const { return config_.enabled; }
     unsigned long getLastConnectAttempt() const { return lastConnectAttempt_; }
     uint32_t getReconnectCount() const { return reconnectCount_; }
+    uint32_t getRetryDelay() const { return retryDelayMs_; }
+    uint32_t getOutboxDropped() const { return outboxDropped_; }
 
 private:
-    // Connection management
+    static constexpr size_t PREFIX_SIZE = 48;
+    static constexpr size_t TOPIC_SIZE = 112;
+    static constexpr size_t TOPIC_SUFFIX_SIZE = 48;
+    static constexpr size_t OUTBOX_PAYLOAD_SIZE = 128;
+    static constexpr size_t OUTBOX_SIZE = 20;   // Room for an effect change: 1 + 2 * MAX_EFFECT_PARAMS
+    static constexpr uint8_t MAX_GROUPS = 4;
+    static constexpr size_t GROUP_NAME_SIZE = 24;
+    static constexpr size_t CLIENT_ID_SIZE = 32;
+    static constexpr uint8_t GROUP_MAX_COMMANDS = 6;
+    
+    // Fixed topics are built once per config, and a segment's param
+    // suffixes once per effect change; queued messages only append their
+    // suffix to the prefix, so nothing is formatted per message
+    enum class Topic : uint8_t {
+        Status, Info, State, Set, PowerSet, BrightnessSet, EffectSet, Discovery,
+        COUNT
+    };
+    
+    // Last value published per field (main loop). Fields not known yet
+    // (after connecting) are published whatever their value.
+    struct PublishedSegment {
+        bool known;
+        bool present;
+        const EffectInfo* effect;
+        ParamValues::Slot params[MAX_EFFECT_PARAMS];
+        char paramSuffixes[MAX_EFFECT_PARAMS][TOPIC_SUFFIX_SIZE];  // segment/{id}/param/{name}
+    };
+    struct PublishedState {
+        bool powerKnown;
+        bool power;
+        bool brightnessKnown;
+        uint8_t brightness;
+        bool lightKnown;            // {prefix}/state
+        bool lightPower;
+        uint8_t lightBrightness;
+        const EffectInfo* lightEffect;
+        PublishedSegment segments[MAX_SEGMENTS];
+    };
+    
+    // Outbox entry (fixed size for the FreeRTOS queue)
+    struct OutboxMessage {
+        char suffix[TOPIC_SUFFIX_SIZE];
+        char payload[OUTBOX_PAYLOAD_SIZE];
+        bool retain;
+        bool group;                 // Suffix is under {groupPrefix}/group/
+    };
+    
+    // Group command, handed from the MQTT task to the main loop
+    struct GroupCommand {
+        uint8_t group;              // Index into groups_
+        char name[GROUP_NAME_SIZE];
+        char client[CLIENT_ID_SIZE];  // For the ack
+        uint32_t id;
+        int64_t atMs;               // Unix time, 0 = on arrival
+        bool unsynced;              // Had a time, but the clock isn't set
+        uint8_t count;
+        Command commands[GROUP_MAX_COMMANDS];
+    };
+    
+    // Acks seen for a group's last command (MQTT task)
+    struct GroupAcks {
+        bool collecting;
+        uint32_t id;
+        uint32_t deadlineMs;
+        uint16_t acks;
+        uint16_t ok;
+        uint16_t late;
+        uint16_t unsynced;
+        uint16_t expired;
+        int32_t maxLateMs;
+        char worst[CLIENT_ID_SIZE];     // Latest member
+        char lowest[CLIENT_ID_SIZE];    // Lowest client id seen: it reports
+    };
+    
+    // MQTT task
+    void startTask();
+    static void taskEntry(void* param);
+    void taskLoop();
+    void applyPendingConfig();
+    void drainOutbox();
+    bool enqueue(const char* suffix, const char* payload, bool retain, bool group);
+    
+    // Connection management (MQTT task)
     bool connect();
     void disconnect();
     void reconnect();
+    void publishAvailability();    // Publish online status
+    void publishDiscovery();       // Home Assistant MQTT discovery
     
     // Topic helpers
-    String buildTopic(const char* suffix) const;
+    void buildTopics();
+    const char* topic(Topic t) const { return topics_[static_cast<uint8_t>(t)]; }
     void subscribe();
+    void publishInfo();
     
-    // Message handling
+    // Message handling (MQTT task)
     static void messageCallback(char* topic, byte* payload, unsigned int length);
-    void handleMessage(const String& topic, const String& payload);
+    void handleMessage(const char* topic, const char* payload, unsigned int length);
+    uint8_t parseCommands(const JsonDocument& doc, Command* out, uint8_t capacity);
     void handleSetCommand(const JsonDocument& doc);
-    void handleBrightnessSet(const String& payload);
-    void handleEffectSet(const String& payload);
-    void handlePowerSet(const String& payload);
+    void handleBrightnessSet(const char* payload);
+    void handleEffectSet(const char* payload);
+    void handlePowerSet(const char* payload);
+    const EffectInfo* findEffect(const char* effectId);
+    
+    // Groups
+    void parseGroups();
+    void handleGroupSet(uint8_t group, const JsonDocument& doc);
+    void handleGroupAck(uint8_t group, const JsonDocument& doc);
+    void publishGroupStatus();                  // MQTT task, when windows close
+    void applyGroupCommands();                  // Main loop, when commands are due
+    void publishGroupAck(const GroupCommand& cmd, const char* result, int32_t lateMs);
     
-    // State tracking for change detection
-    void updateStateHash();
-    bool stateChanged() const;
+    // Field publishing (main loop); each returns false when the outbox is
+    // full, leaving the rest for the next update()
+    bool publishFields();
+    bool publishSegment(uint8_t id, Segment* seg);
+    bool publishLightState();
+    bool queueField(const char* suffix, const char* payload);
+    size_t outboxSpace() const;
     
     WiFiClient wifiClient_;
     PubSubClient client_;
-    MqttConfig config_;
+    MqttConfig config_;             // Owned by the MQTT task
     LumeController* controller_ = nullptr;
+    char prefix_[PREFIX_SIZE] = "";
+    size_t prefixLength_ = 0;
+    char topics_[static_cast<uint8_t>(Topic::COUNT)][TOPIC_SIZE] = {};
+    
+    // Groups (MQTT task)
+    char groupRoot_[PREFIX_SIZE + 8] = "";      // {groupPrefix}/group
+    size_t groupRootLength_ = 0;
+    char groups_[MAX_GROUPS][GROUP_NAME_SIZE] = {};
+    char groupSetTopics_[MAX_GROUPS][TOPIC_SIZE] = {};
+    char groupAckTopics_[MAX_GROUPS][TOPIC_SIZE] = {};
+    GroupAcks groupAcks_[MAX_GROUPS] = {};
+    volatile uint8_t groupCount_ = 0;
+    bool clockStarted_ = false;
+    
+    // Group commands waiting for their time (main loop), one per group:
+    // a newer command replaces a pending one
+    QueueHandle_t groupQueue_ = nullptr;
+    GroupCommand scheduled_[MAX_GROUPS];
+    bool scheduledPending_[MAX_GROUPS] = {};
+    
+    // Handed from setConfig() to the MQTT task
+    MqttConfig pendingConfig_;
+    volatile bool configPending_ = false;
+    SemaphoreHandle_t configLock_ = nullptr;
+    
+    TaskHandle_t task_ = nullptr;
+    QueueHandle_t outbox_ = nullptr;
     
     // Connection state
+    volatile bool connected_ = false;
+    volatile bool stateRequested_ = false;     // Set on connect: publish every field
     unsigned long lastConnectAttempt_ = 0;
-    unsigned long lastStatePublish_ = 0;
+    unsigned long nextConnectAttempt_ = 0;
+    uint32_t retryDelayMs_ = RECONNECT_MIN_MS;
     uint32_t reconnectCount_ = 0;
-    bool wasConnected_ = false;
+    volatile uint32_t outboxDropped_ = 0;
     
     // State change detection
-    uint32_t lastStateHash_ = 0;
+    PublishedState published_ = {};
+    unsigned long lastPublish_ = 0;
     
     // Singleton for callback routing
     static MqttProtocol* instance_;
     
     // Constants
-    static constexpr uint32_t RECONNECT_INTERVAL_MS = 5000;
-    static constexpr uint32_t STATE_PUBLISH_INTERVAL_MS = 30000; // Periodic republish
+    static constexpr uint32_t RECONNECT_MIN_MS = 1000;          // First retry
+    static constexpr uint32_t RECONNECT_MAX_MS = 60000;         // Backoff cap
+    static constexpr uint32_t TASK_INTERVAL_MS = 20;            // Poll while enabled
+    static constexpr uint32_t IDLE_INTERVAL_MS = 500;           // Poll while disabled or offline
+    static constexpr uint32_t PUBLISH_MIN_INTERVAL_MS = 100;    // Changes in between are merged
+    static constexpr uint32_t MAX_TRANSITION_MS = 60000;
+    static constexpr int32_t GROUP_ON_TIME_MS = 20;             // Later than this is "late"
+    static constexpr int32_t GROUP_EXPIRED_MS = 10000;          // Older commands are dropped
+    static constexpr uint32_t GROUP_ACK_WINDOW_MS = 2000;       // After "at", before the status
+    static constexpr uint32_t GROUP_MAX_LEAD_MS = 86400000;     // Ack window starts a day ahead at most
     static constexpr uint16_t MQTT_BUFFER_SIZE = 1024;
 };
 
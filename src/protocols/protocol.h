@@ -39,6 +39,14 @@ public:
     virtual const CRGB* getBuffer() = 0;  // Get LED buffer (nullptr if no data)
     virtual uint16_t getBufferSize() = 0; // Get buffer size in LEDs
     virtual void clearData() = 0;         // Clear the data-ready flag
+    
+    // Called after a frame copied from this protocol reached the strip
+    virtual void notifyShown(uint32_t shownAtUs) {}
+    
+    // Show-on-arrival support: a whole frame is buffered (all universes,
+    // or a sync point), and when its last piece arrived (micros, 0 = unknown)
+    virtual bool hasCompleteFrame() { return hasData(); }
+    virtual uint32_t frameArrivalUs() { return 0; }
 };
 
 /**
@@ -72,6 +80,9 @@ public:
     const CRGB* getBuffer() override { return getBufferInternal(); }
     uint16_t getBufferSize() override { return getBufferSizeInternal(); }
     void clearData() override { clearFrameReady(); }
+    void notifyShown(uint32_t shownAtUs) override { onFrameShown(shownAtUs); }
+    bool hasCompleteFrame() override { return hasFrameReady() && isFrameComplete(); }
+    uint32_t frameArrivalUs() override { return getFrameArrivalUs(); }
     
     // --- Full Protocol interface (for subclasses and detailed control) ---
     
@@ -112,6 +123,15 @@ public:
     // Clear the frame-ready flag after copying
     virtual void clearFrameReady() = 0;
     
+    // Frame copied from this protocol was shown (micros() timestamp)
+    virtual void onFrameShown(uint32_t shownAtUs) {}
+    
+    // Buffered frame is whole; protocols without framing are always complete
+    virtual bool isFrameComplete() const { return true; }
+    
+    // micros() when the newest buffered data arrived (0 if not tracked)
+    virtual uint32_t getFrameArrivalUs() const { return 0; }
+    
     // --- Diagnostics ---
     
     virtual const char* getName() const = 0;
@@ -0,0 +1,141 @@
+/**
+ * RealtimeProtocol - Web server pixel input implementation
+ */
+
+#include "realtime.h"
+#include "../logging.h"
+
+namespace lume {
+
+// Global instances
+RealtimeProtocol wsPixelProtocol("WebSocket");
+RealtimeProtocol httpPixelProtocol("HTTP");
+
+// Longest the writer waits for the main loop to finish a copy
+static constexpr TickType_t COMMIT_WAIT_TICKS = pdMS_TO_TICKS(5);
+
+RealtimeProtocol::RealtimeProtocol(const char* name)
+    : name_(name)
+    , enabled_(false)
+    , active_(false)
+    , lock_(nullptr)
+    , stagedLength_(0)
+    , sharedLength_(0)
+    , sharedArrivalUs_(0)
+    , sharedReady_(false)
+    , arrivalUs_(0)
+    , packets_(0)
+    , lastPacketMs_(0)
+    , framesCommitted_(0)
+    , framesDropped_(0) {
+    memset(staging_, 0, sizeof(staging_));
+    memset(shared_, 0, sizeof(shared_));
+}
+
+bool RealtimeProtocol::begin_impl() {
+    if (!lock_) {
+        lock_ = xSemaphoreCreateMutex();
+        if (!lock_) {
+            LOG_ERROR(LogTag::WEB, "%s pixels: failed to create lock", name_);
+            return false;
+        }
+    }
+    enabled_ = true;
+    return true;
+}
+
+void RealtimeProtocol::stop() {
+    enabled_ = false;
+    active_ = false;
+}
+
+void RealtimeProtocol::setEnabled(bool enabled) {
+    enabled_ = enabled;
+    if (!enabled) {
+        active_ = false;
+    }
+}
+
+bool RealtimeProtocol::hasTimedOut(uint32_t timeoutMs) const {
+    if (lastPacketMs_ == 0) {
+        return false;  // Never received
+    }
+    return (millis() - lastPacketMs_) > timeoutMs;
+}
+
+void RealtimeProtocol::writeBytes(uint32_t byteOffset, const uint8_t* data, size_t len, bool xorDelta) {
+    const uint32_t capacity = sizeof(staging_);
+    if (byteOffset >= capacity) {
+        return;
+    }
+    len = min(len, (size_t)(capacity - byteOffset));
+
+    // CRGB is packed r,g,b: the staging buffer is a plain byte array
+    uint8_t* dst = reinterpret_cast<uint8_t*>(staging_) + byteOffset;
+    if (xorDelta) {
+        for (size_t i = 0; i < len; i++) {
+            dst[i] ^= data[i];
+        }
+    } else {
+        memcpy(dst, data, len);
+    }
+    markWritten((byteOffset + len + 2) / 3);
+}
+
+void RealtimeProtocol::markWritten(uint16_t endPixel) {
+    stagedLength_ = max(stagedLength_, min(endPixel, (uint16_t)MAX_LED_COUNT));
+}
+
+void RealtimeProtocol::notePacket() {
+    packets_++;
+    lastPacketMs_ = millis();
+}
+
+bool RealtimeProtocol::commit() {
+    if (!enabled_ || !lock_) {
+        return false;
+    }
+    if (xSemaphoreTake(lock_, COMMIT_WAIT_TICKS) != pdTRUE) {
+        framesDropped_++;
+        return false;
+    }
+    if (sharedReady_) {
+        framesDropped_++;   // The main loop never saw the previous one
+    }
+    memcpy(shared_, staging_, stagedLength_ * sizeof(CRGB));
+    sharedLength_ = stagedLength_;
+    sharedArrivalUs_ = micros();
+    sharedReady_ = true;
+    xSemaphoreGive(lock_);
+
+    framesCommitted_++;
+    return true;
+}
+
+bool RealtimeProtocol::update() {
+    if (!enabled_ || !lock_) {
+        return false;
+    }
+
+    // Never stall the render loop on the writer: try again next pass
+    bool received = false;
+    if (xSemaphoreTake(lock_, 0) == pdTRUE) {
+        if (sharedReady_) {
+            buffer_.write(shared_, sharedLength_);
+            arrivalUs_ = sharedArrivalUs_;
+            sharedReady_ = false;
+            received = true;
+        }
+        xSemaphoreGive(lock_);
+    }
+
+    if (received) {
+        active_ = true;
+    } else if (active_ && hasTimedOut()) {
+        LOG_INFO(LogTag::WEB, "%s pixels: source timed out", name_);
+        active_ = false;
+    }
+    return received;
+}
+
+} // namespace lume
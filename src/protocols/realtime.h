@@ -0,0 +1,104 @@
+#ifndef LUME_PROTOCOL_REALTIME_H
+#define LUME_PROTOCOL_REALTIME_H
+
+#include "protocol.h"
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include "../constants.h"
+
+namespace lume {
+
+/**
+ * RealtimeProtocol - Pixel frames pushed by the web server
+ *
+ * For sources that arrive over HTTP or WebSocket rather than UDP. The
+ * writer (a handler on the AsyncTCP task) builds frames in a private
+ * staging buffer, piece by piece if the data arrives in chunks, and
+ * commit() publishes the staged frame. update() on the main loop picks
+ * the newest published frame up into the protocol buffer, so the
+ * controller stays the only writer to the LED array and the arbiter
+ * decides when it shows and when effects take back over.
+ *
+ * The staging buffer persists between frames: partial updates keep the
+ * other pixels, and XOR deltas apply against the last frame written.
+ * Only one task may write (all AsyncWebServer handlers share one).
+ */
+class RealtimeProtocol : public Protocol {
+public:
+    explicit RealtimeProtocol(const char* name);
+
+    // --- Writer side (network task) ---
+
+    // Copy (or XOR into) staged bytes; byteOffset counts R,G,B bytes from pixel 0
+    void writeBytes(uint32_t byteOffset, const uint8_t* data, size_t len, bool xorDelta = false);
+
+    // Direct access for writers that compute pixels (fills, gradients)
+    CRGB* staging() { return staging_; }
+    void markWritten(uint16_t endPixel);
+
+    // Count a received message (packet statistics, liveness)
+    void notePacket();
+
+    // Publish the staged frame; false if the main loop held the lock too long
+    bool commit();
+
+    // --- Protocol interface ---
+
+    bool begin_impl() override;
+    void stop() override;
+
+    void setEnabled(bool enabled) override;
+    bool isEnabled_impl() const override { return enabled_; }
+
+    bool update() override;
+    bool hasTimedOut(uint32_t timeoutMs = 5000) const override;
+    bool isActive_impl() const override { return active_; }
+
+    bool hasFrameReady() const override { return buffer_.isReady(); }
+    const CRGB* getBufferInternal() const override { return buffer_.getBuffer(); }
+    uint16_t getBufferSizeInternal() const override { return buffer_.getLedCount(); }
+    void clearFrameReady() override { buffer_.clearReady(); }
+    uint32_t getFrameArrivalUs() const override { return arrivalUs_; }
+
+    const char* getName() const override { return name_; }
+    uint32_t getPacketCount() const override { return packets_; }
+    uint32_t getLastPacketTime() const override { return lastPacketMs_; }
+
+    // --- Diagnostics ---
+
+    uint32_t getFramesCommitted() const { return framesCommitted_; }
+    uint32_t getFramesDropped() const { return framesDropped_; }
+
+private:
+    const char* name_;
+    bool enabled_;
+    bool active_;
+    SemaphoreHandle_t lock_;
+
+    // Writer-owned
+    CRGB staging_[MAX_LED_COUNT];
+    uint16_t stagedLength_;
+
+    // Handoff (guarded by lock_)
+    CRGB shared_[MAX_LED_COUNT];
+    uint16_t sharedLength_;
+    uint32_t sharedArrivalUs_;
+    bool sharedReady_;
+
+    // Main loop
+    ProtocolBuffer<MAX_LED_COUNT> buffer_;
+    uint32_t arrivalUs_;
+
+    volatile uint32_t packets_;
+    volatile uint32_t lastPacketMs_;
+    volatile uint32_t framesCommitted_;
+    volatile uint32_t framesDropped_;   // Published frames replaced before the main loop took them
+};
+
+// Global instances
+extern RealtimeProtocol wsPixelProtocol;     // /ws/pixels
+extern RealtimeProtocol httpPixelProtocol;   // POST /api/pixels
+
+} // namespace lume
+
+#endif // LUME_PROTOCOL_REALTIME_H
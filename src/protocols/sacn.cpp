@@ -17,21 +17,48 @@ SacnProtocol sacnProtocol;
 // ACN packet identifier (bytes 4-15)
 static const uint8_t ACN_ID[] = {0x41, 0x53, 0x43, 0x2d, 0x45, 0x31, 0x2e, 0x31, 0x37, 0x00, 0x00, 0x00};
 
+// Per-byte max of two words (SWAR). For each byte, a >= b when a has the
+// top bit and b doesn't, or both top bits match and the low 7 bits of a
+// are >= those of b; the 0x80 guard bit keeps the subtraction per-byte.
+static inline uint32_t maxBytes4(uint32_t a, uint32_t b) {
+    constexpr uint32_t H = 0x80808080;
+    uint32_t low = (a | H) - (b & ~H);
+    uint32_t ge = ((a & ~b) | (~(a ^ b) & low)) & H;
+    uint32_t mask = (ge >> 7) * 0xFF;
+    return (a & mask) | (b & ~mask);
+}
+
+const char* sacnMergeModeToString(SacnMergeMode mode) {
+    return mode == SacnMergeMode::LTP ? "ltp" : "htp";
+}
+
 SacnProtocol::SacnProtocol()
     : startUniverse_(1)
     , universeCount_(1)
     , unicastMode_(false)
     , startChannel_(1)
+    , mergeMode_(SacnMergeMode::HTP)
+    , mergeDirty_(false)
     , enabled_(false)
     , initialized_(false)
     , acceptPreview_(false)
     , totalPacketCount_(0)
     , lastAnyPacketTime_(0)
+    , frameMask_(0)
+    , frameComplete_(false)
+    , frameArrivalUs_(0)
+    , lastDataUs_(0)
+    , heldPacketSize_(0)
+    , heldArrivalUs_(0)
+    , syncAddress_(0)
+    , lastSyncTime_(0)
+    , syncPacketCount_(0)
     , ledCount_(0)
     , active_(false) {
     memset(packetBuffer_, 0, sizeof(packetBuffer_));
     memset(universes_, 0, sizeof(universes_));
     memset(sources_, 0, sizeof(sources_));
+    memset(sourceData_, 0, sizeof(sourceData_));
     memset(workBuffer_, 0, sizeof(workBuffer_));
 }
 
@@ -75,6 +102,7 @@ bool SacnProtocol::begin_impl() {
         universes_[i].channelCount = 0;
         universes_[i].activePriority = 0;
         universes_[i].activeSourceIndex = 0xFF;
+        universes_[i].ownerMask = 0;
         universes_[i].lastPacketTime = 0;
         universes_[i].packetCount = 0;
         universes_[i].hasData = false;
@@ -87,6 +115,7 @@ bool SacnProtocol::begin_impl() {
     
     totalPacketCount_ = 0;
     lastAnyPacketTime_ = 0;
+    resetStats();
     
     // Start UDP listener
     if (!udp_.begin(SACN_PORT)) {
@@ -102,9 +131,17 @@ bool SacnProtocol::begin_impl() {
     initialized_ = true;
     enabled_ = true;
     
-    LOG_INFO(LogTag::SACN, "Started: universes %d-%d, mode=%s",
+    mergeDirty_ = false;
+    frameMask_ = 0;
+    frameComplete_ = false;
+    heldPacketSize_ = 0;
+    syncAddress_ = 0;
+    lastSyncTime_ = 0;
+    syncPacketCount_ = 0;
+    
+    LOG_INFO(LogTag::SACN, "Started: universes %d-%d, mode=%s, merge=%s",
              startUniverse_, startUniverse_ + universeCount_ - 1,
-             unicastMode_ ? "unicast" : "multicast");
+             unicastMode_ ? "unicast" : "multicast", sacnMergeModeToString(mergeMode_));
     
     return true;
 }
@@ -143,15 +180,24 @@ bool SacnProtocol::update() {
     
     // Periodically clean up stale sources
     static uint32_t lastCleanup = 0;
-    if (millis() - lastCleanup > 1000) {
+    if (millis() - lastCleanup > SACN_CLEANUP_INTERVAL_MS) {
         cleanupStaleSources();
         lastCleanup = millis();
     }
     
     bool receivedAny = false;
+    bool heldBack = false;
+    
+    // The packet that ended the last frame starts this one
+    if (heldPacketSize_ != 0) {
+        int size = heldPacketSize_;
+        heldPacketSize_ = 0;
+        receivedAny = parsePacket(size, heldArrivalUs_);
+    }
     
-    // Process all available packets (handle burst traffic)
-    int maxPacketsPerUpdate = 10;
+    // Process all available packets (handle burst traffic), unless the
+    // held packet already completed a frame
+    int maxPacketsPerUpdate = (receivedAny && frameComplete_) ? 0 : 10;
     while (maxPacketsPerUpdate-- > 0) {
         int packetSize = udp_.parsePacket();
         if (packetSize == 0) {
@@ -159,7 +205,13 @@ bool SacnProtocol::update() {
         }
         
         if (packetSize < SACN_HEADER_SIZE) {
+            // Sync packets are the only valid short E1.31 packets
+            if (packetSize >= SACN_SYNC_PACKET_SIZE &&
+                udp_.read(packetBuffer_, SACN_SYNC_PACKET_SIZE) == SACN_SYNC_PACKET_SIZE) {
+                parseSyncPacket(micros());
+            }
             udp_.flush();
+            if (frameComplete_) break;
             continue;
         }
         
@@ -175,19 +227,30 @@ bool SacnProtocol::update() {
             continue;
         }
         
-        if (parsePacket(bytesRead)) {
+        // Arrival = dequeue from the socket; lwIP queueing is not visible here
+        if (parsePacket(bytesRead, micros())) {
             receivedAny = true;
         }
+        heldBack = heldPacketSize_ != 0;
+        
+        // Publish a finished frame before reading into the next one
+        if (frameComplete_) break;
     }
     
     if (receivedAny) {
+        active_ = true;
+    }
+    
+    // New data, a frame completed by a held packet, or a source dropped
+    // out and the merge changed
+    if (receivedAny || heldBack || (mergeDirty_ && active_)) {
         // Assemble multi-universe data into working buffer
         assembleLeds();
         
         // Write to thread-safe buffer
         buffer_.write(workBuffer_, ledCount_);
-        active_ = true;
     }
+    mergeDirty_ = false;
     
     // Check for timeout
     if (active_ && hasTimedOut(5000)) {
@@ -198,7 +261,7 @@ bool SacnProtocol::update() {
     return receivedAny;
 }
 
-bool SacnProtocol::parsePacket(int packetSize) {
+bool SacnProtocol::parsePacket(int packetSize, uint32_t arrivalUs) {
     // Check ACN packet identifier (bytes 4-15)
     if (memcmp(&packetBuffer_[4], ACN_ID, 12) != 0) {
         return false;
@@ -226,18 +289,10 @@ bool SacnProtocol::parsePacket(int packetSize) {
     const uint8_t* cid = &packetBuffer_[22];
     const char* sourceName = (const char*)&packetBuffer_[44];
     uint8_t priority = packetBuffer_[108];
+    uint16_t syncAddress = ((uint16_t)packetBuffer_[109] << 8) | packetBuffer_[110];
     uint8_t sequence = packetBuffer_[111];
     uint8_t options = packetBuffer_[112];
     
-    // Check options
-    if ((options & SACN_OPT_PREVIEW) && !acceptPreview_) {
-        return false;
-    }
-    
-    if (options & SACN_OPT_STREAM_TERM) {
-        return false;
-    }
-    
     // Get universe from packet
     uint16_t packetUniverse = ((uint16_t)packetBuffer_[113] << 8) | packetBuffer_[114];
     
@@ -249,6 +304,44 @@ bool SacnProtocol::parsePacket(int packetSize) {
     
     SacnUniverse& uni = universes_[uniIndex];
     
+    // A universe repeating means the sender skipped some: the previous frame
+    // is done. Finish it before this packet reaches the merge and leave the
+    // packet in packetBuffer_ for the next update (which parses it again).
+    if (repeatsFrameUniverse(uniIndex, cid, syncAddress, options)) {
+        frameComplete_ = true;
+        frameMask_ = 0;
+        frameArrivalUs_ = lastDataUs_;
+        heldPacketSize_ = packetSize;
+        heldArrivalUs_ = arrivalUs;
+        return false;
+    }
+    
+    uni.stats.received++;
+    
+    // Check options (counted before rejecting so flicker can be diagnosed)
+    bool rejectPreview = (options & SACN_OPT_PREVIEW) && !acceptPreview_;
+    if (rejectPreview || (options & SACN_OPT_STREAM_TERM)) {
+        int known = findSource(cid);
+        SacnCounters* srcStats = (known >= 0) ? &sources_[known].stats : nullptr;
+        if (srcStats) srcStats->received++;
+        if (options & SACN_OPT_STREAM_TERM) {
+            uni.stats.terminated++;
+            if (srcStats) {
+                srcStats->terminated++;
+                // Stop using this source now instead of waiting for the timeout
+                if (sources_[known].universeMask & (1 << uniIndex)) {
+                    LOG_INFO(LogTag::SACN, "Source %s terminated universe %d",
+                             sources_[known].name, packetUniverse);
+                    dropSourceUniverse(known, uniIndex);
+                }
+            }
+        } else {
+            uni.stats.preview++;
+            if (srcStats) srcStats->preview++;
+        }
+        return false;
+    }
+    
     // Find or create source entry
     int sourceIndex = findOrCreateSource(cid, sourceName, priority);
     if (sourceIndex < 0) {
@@ -256,26 +349,24 @@ bool SacnProtocol::parsePacket(int packetSize) {
     }
     
     SacnSource& source = sources_[sourceIndex];
+    source.stats.received++;
     
-    // Sequence check for this source
-    if (uni.packetCount > 0 && uni.activeSourceIndex == (uint8_t)sourceIndex) {
-        int8_t diff = (int8_t)(sequence - source.lastSequence);
+    // Sequence check for this source on this universe (E1.31 6.7.2)
+    uint8_t uniBit = 1 << uniIndex;
+    if (source.sequenceValid & uniBit) {
+        int8_t diff = (int8_t)(sequence - source.lastSequence[uniIndex]);
         if (diff < 0 && diff > -20) {
+            uni.stats.outOfOrder++;
+            source.stats.outOfOrder++;
             return false;  // Out of order packet
         }
-    }
-    source.lastSequence = sequence;
-    
-    // Priority check
-    if (uni.activeSourceIndex != 0xFF && uni.activeSourceIndex != (uint8_t)sourceIndex) {
-        if (priority < uni.activePriority) {
-            return false;  // Lower priority source
-        }
-        if (priority > uni.activePriority) {
-            LOG_INFO(LogTag::SACN, "Universe %d: source change (priority %d > %d)",
-                     packetUniverse, priority, uni.activePriority);
+        if (diff > 1) {
+            uni.stats.lost += diff - 1;
+            source.stats.lost += diff - 1;
         }
     }
+    source.lastSequence[uniIndex] = sequence;
+    source.sequenceValid |= uniBit;
     
     // Check DMP vector
     if (packetBuffer_[117] != SACN_VECTOR_DMP) {
@@ -293,21 +384,55 @@ bool SacnProtocol::parsePacket(int packetSize) {
         return false;
     }
     
-    // Number of DMX channels
-    uni.channelCount = min((uint16_t)(propCount - 1), (uint16_t)SACN_MAX_CHANNELS);
+    // Number of DMX channels (data starts after start code at byte 126)
+    uint16_t channelCount = min((uint16_t)(propCount - 1), (uint16_t)SACN_MAX_CHANNELS);
+    int dmxBytes = min((int)channelCount, packetSize - 126);
+    const uint8_t* dmx = &packetBuffer_[126];
     
-    // Copy DMX data (starts after start code at byte 126)
-    int dmxBytes = min((int)uni.channelCount, packetSize - 126);
-    if (dmxBytes > 0) {
-        memcpy(uni.dmxData, &packetBuffer_[126], dmxBytes);
+    // LTP takeover needs a real change: new data from this source that also
+    // differs from what is on the universe now. A backup desk tracking the
+    // primary never qualifies, so ownership doesn't flip between them.
+    uint8_t* srcData = sourceData_[sourceIndex][uniIndex];
+    bool changed = (source.universeMask & uniBit) &&
+                   (dmxBytes != source.channelCount[uniIndex] ||
+                    memcmp(srcData, dmx, dmxBytes) != 0) &&
+                   memcmp(uni.dmxData, dmx, dmxBytes) != 0;
+    
+    // Store as this source's merge input (zero the tail for shorter packets)
+    memcpy(srcData, dmx, dmxBytes);
+    memset(srcData + dmxBytes, 0, SACN_MAX_CHANNELS - dmxBytes);
+    source.channelCount[uniIndex] = dmxBytes;
+    source.universeMask |= uniBit;
+    source.universeSeen[uniIndex] = millis();
+    
+    mergeUniverse(uniIndex, changed ? sourceIndex : -1);
+    
+    // Lower priority (or non-owning LTP) data is kept for failover only
+    if (!(uni.ownerMask & (1 << sourceIndex))) {
+        return false;
     }
     
+    // Inter-arrival timing for accepted data
+    if (uni.lastArrivalUs != 0) {
+        uint32_t interval = arrivalUs - uni.lastArrivalUs;
+        uni.interArrival.record(interval);
+        if (uni.lastIntervalUs != 0) {
+            int32_t d = (int32_t)(interval - uni.lastIntervalUs);
+            uint32_t absD = (d < 0) ? -d : d;
+            // J += (|D| - J) / 16
+            uni.jitterUs += ((int32_t)(absD - uni.jitterUs)) / 16;
+        }
+        uni.lastIntervalUs = interval;
+    }
+    uni.lastArrivalUs = arrivalUs;
+    uni.pendingArrivalUs = arrivalUs;
+    uni.pendingShow = true;
+    markUniverseReceived(uniIndex, syncAddress, arrivalUs);
+    
     // Update universe state
     uni.lastPacketTime = millis();
     uni.packetCount++;
     uni.hasData = true;
-    uni.activePriority = priority;
-    uni.activeSourceIndex = (uint8_t)sourceIndex;
     
     // Update global stats
     totalPacketCount_++;
@@ -316,22 +441,111 @@ bool SacnProtocol::parsePacket(int packetSize) {
     return true;
 }
 
+bool SacnProtocol::parseSyncPacket(uint32_t arrivalUs) {
+    if (memcmp(&packetBuffer_[4], ACN_ID, 12) != 0) {
+        return false;
+    }
+    
+    uint32_t rootVector = ((uint32_t)packetBuffer_[18] << 24) |
+                          ((uint32_t)packetBuffer_[19] << 16) |
+                          ((uint32_t)packetBuffer_[20] << 8) |
+                          packetBuffer_[21];
+    uint32_t frameVector = ((uint32_t)packetBuffer_[40] << 24) |
+                           ((uint32_t)packetBuffer_[41] << 16) |
+                           ((uint32_t)packetBuffer_[42] << 8) |
+                           packetBuffer_[43];
+    if (rootVector != SACN_VECTOR_ROOT_EXTENDED || frameVector != SACN_VECTOR_EXTENDED_SYNC) {
+        return false;
+    }
+    
+    // Only sync points for the address our data sources announced count
+    uint16_t syncAddress = ((uint16_t)packetBuffer_[45] << 8) | packetBuffer_[46];
+    if (syncAddress == 0 || syncAddress != syncAddress_) {
+        return false;
+    }
+    
+    syncPacketCount_++;
+    lastSyncTime_ = millis();
+    if (frameMask_ != 0) {
+        frameComplete_ = true;
+        frameMask_ = 0;
+        frameArrivalUs_ = arrivalUs;
+    }
+    return true;
+}
+
+// Source uses E1.31 sync and sync packets are reaching us: wait for one.
+// If they stop (e.g. sync universe not joined) fall back to data framing.
+bool SacnProtocol::waitingForSync(uint16_t syncAddress) const {
+    return syncAddress != 0 && lastSyncTime_ != 0 &&
+           millis() - lastSyncTime_ < SACN_SOURCE_TIMEOUT_MS;
+}
+
+// Data from a contributing source for a universe the current frame already has
+bool SacnProtocol::repeatsFrameUniverse(uint8_t uniIndex, const uint8_t* cid,
+                                        uint16_t syncAddress, uint8_t options) const {
+    if (!(frameMask_ & (1 << uniIndex)) || waitingForSync(syncAddress)) {
+        return false;
+    }
+    if ((options & SACN_OPT_STREAM_TERM) || ((options & SACN_OPT_PREVIEW) && !acceptPreview_)) {
+        return false;
+    }
+    int known = findSource(cid);
+    return known >= 0 && (universes_[uniIndex].ownerMask & (1 << known));
+}
+
+void SacnProtocol::markUniverseReceived(uint8_t uniIndex, uint16_t syncAddress, uint32_t arrivalUs) {
+    uint8_t uniBit = 1 << uniIndex;
+    lastDataUs_ = arrivalUs;
+    syncAddress_ = syncAddress;
+    frameMask_ |= uniBit;
+    
+    // Repeats are caught in parsePacket, before they reach the merge
+    if (waitingForSync(syncAddress)) {
+        return;
+    }
+    
+    // Complete once every universe that currently has a source has arrived
+    uint8_t liveMask = 0;
+    for (uint8_t u = 0; u < universeCount_; u++) {
+        if (universes_[u].ownerMask != 0) {
+            liveMask |= 1 << u;
+        }
+    }
+    if ((frameMask_ & liveMask) == liveMask) {
+        frameComplete_ = true;
+        frameMask_ = 0;
+        frameArrivalUs_ = arrivalUs;
+    }
+}
+
+int SacnProtocol::findSource(const uint8_t* cid) const {
+    for (int i = 0; i < SACN_MAX_SOURCES; i++) {
+        if (sources_[i].active && memcmp(sources_[i].cid, cid, 16) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
 int SacnProtocol::findOrCreateSource(const uint8_t* cid, const char* name, uint8_t priority) {
     uint32_t now = millis();
+    
+    int existing = findSource(cid);
+    if (existing >= 0) {
+        sources_[existing].priority = priority;
+        sources_[existing].lastSeen = now;
+        strncpy(sources_[existing].name, name, 63);
+        sources_[existing].name[63] = '\0';
+        return existing;
+    }
+    
     int emptySlot = -1;
     int oldestSlot = 0;
     uint32_t oldestTime = UINT32_MAX;
     
     for (int i = 0; i < SACN_MAX_SOURCES; i++) {
         if (sources_[i].active) {
-            if (memcmp(sources_[i].cid, cid, 16) == 0) {
-                // Found existing source
-                sources_[i].priority = priority;
-                sources_[i].lastSeen = now;
-                strncpy(sources_[i].name, name, 63);
-                sources_[i].name[63] = '\0';
-                return i;
-            }
             if (sources_[i].lastSeen < oldestTime) {
                 oldestTime = sources_[i].lastSeen;
                 oldestSlot = i;
@@ -347,9 +561,11 @@ int SacnProtocol::findOrCreateSource(const uint8_t* cid, const char* name, uint8
     strncpy(sources_[slot].name, name, 63);
     sources_[slot].name[63] = '\0';
     sources_[slot].priority = priority;
-    sources_[slot].lastSequence = 0;
+    sources_[slot].sequenceValid = 0;
+    sources_[slot].universeMask = 0;
     sources_[slot].lastSeen = now;
     sources_[slot].active = true;
+    memset(&sources_[slot].stats, 0, sizeof(SacnCounters));
     
     LOG_INFO(LogTag::SACN, "New source: %s (priority %d)", sources_[slot].name, priority);
     return slot;
@@ -358,18 +574,103 @@ int SacnProtocol::findOrCreateSource(const uint8_t* cid, const char* name, uint8
 void SacnProtocol::cleanupStaleSources() {
     uint32_t now = millis();
     for (int i = 0; i < SACN_MAX_SOURCES; i++) {
-        if (sources_[i].active && (now - sources_[i].lastSeen > SACN_SOURCE_TIMEOUT_MS)) {
-            LOG_INFO(LogTag::SACN, "Source timeout: %s", sources_[i].name);
-            sources_[i].active = false;
-            
-            for (uint8_t u = 0; u < universeCount_; u++) {
-                if (universes_[u].activeSourceIndex == i) {
-                    universes_[u].activePriority = 0;
-                    universes_[u].activeSourceIndex = 0xFF;
-                }
+        SacnSource& source = sources_[i];
+        if (!source.active) continue;
+        
+        // Timeouts are per universe: a desk may stop sending one universe only
+        for (uint8_t u = 0; u < universeCount_; u++) {
+            if ((source.universeMask & (1 << u)) &&
+                now - source.universeSeen[u] > SACN_SOURCE_TIMEOUT_MS) {
+                LOG_INFO(LogTag::SACN, "Source timeout: %s (universe %d)",
+                         source.name, universes_[u].universe);
+                dropSourceUniverse(i, u);
             }
         }
+        
+        if (source.universeMask == 0 && now - source.lastSeen > SACN_SOURCE_TIMEOUT_MS) {
+            source.active = false;
+        }
+    }
+}
+
+void SacnProtocol::dropSourceUniverse(uint8_t sourceIndex, uint8_t uniIndex) {
+    sources_[sourceIndex].universeMask &= ~(1 << uniIndex);
+    sources_[sourceIndex].sequenceValid &= ~(1 << uniIndex);
+    mergeUniverse(uniIndex, -1);
+    mergeDirty_ = true;
+}
+
+void SacnProtocol::mergeUniverse(uint8_t uniIndex, int changedSource) {
+    SacnUniverse& uni = universes_[uniIndex];
+    uint8_t uniBit = 1 << uniIndex;
+    
+    // Sources at the highest priority currently sending this universe
+    int topPriority = -1;
+    uint8_t candidates = 0;
+    for (uint8_t i = 0; i < SACN_MAX_SOURCES; i++) {
+        const SacnSource& src = sources_[i];
+        if (!src.active || !(src.universeMask & uniBit)) continue;
+        if (src.priority > topPriority) {
+            topPriority = src.priority;
+            candidates = 1 << i;
+        } else if (src.priority == topPriority) {
+            candidates |= 1 << i;
+        }
+    }
+    
+    if (candidates == 0) {
+        // Nobody left: hold the last merged look rather than going black
+        if (uni.ownerMask != 0) {
+            LOG_INFO(LogTag::SACN, "Universe %d: no sources, holding last data", uni.universe);
+        }
+        uni.ownerMask = 0;
+        uni.activeSourceIndex = 0xFF;
+        uni.activePriority = 0;
+        return;
+    }
+    
+    uint8_t owners = candidates;
+    if (mergeMode_ == SacnMergeMode::LTP && (candidates & (candidates - 1))) {
+        // Sticky: keep the current owner unless another source changed the look
+        if (changedSource >= 0 && (candidates & (1 << changedSource))) {
+            owners = 1 << changedSource;
+        } else if (uni.activeSourceIndex < SACN_MAX_SOURCES &&
+                   (candidates & (1 << uni.activeSourceIndex))) {
+            owners = 1 << uni.activeSourceIndex;
+        } else {
+            owners = candidates & -candidates;  // Lowest slot
+        }
+    }
+    
+    // Build merged output from the owning sources
+    uint8_t first = __builtin_ctz(owners);
+    memcpy(uni.dmxData, sourceData_[first][uniIndex], SACN_MAX_CHANNELS);
+    uint16_t channelCount = sources_[first].channelCount[uniIndex];
+    
+    for (uint8_t i = first + 1; i < SACN_MAX_SOURCES; i++) {
+        if (!(owners & (1 << i))) continue;
+        uint32_t* dst = reinterpret_cast<uint32_t*>(uni.dmxData);
+        const uint32_t* src = reinterpret_cast<const uint32_t*>(sourceData_[i][uniIndex]);
+        for (uint16_t w = 0; w < SACN_MAX_CHANNELS / 4; w++) {
+            dst[w] = maxBytes4(dst[w], src[w]);
+        }
+        channelCount = max(channelCount, sources_[i].channelCount[uniIndex]);
+    }
+    
+    if (owners != uni.ownerMask) {
+        if (owners & (owners - 1)) {
+            LOG_INFO(LogTag::SACN, "Universe %d: HTP merge of %d sources (priority %d)",
+                     uni.universe, __builtin_popcount(owners), topPriority);
+        } else {
+            LOG_INFO(LogTag::SACN, "Universe %d: owner %s (priority %d)",
+                     uni.universe, sources_[first].name, topPriority);
+        }
     }
+    
+    uni.channelCount = channelCount;
+    uni.ownerMask = owners;
+    uni.activeSourceIndex = first;
+    uni.activePriority = (uint8_t)topPriority;
 }
 
 IPAddress SacnProtocol::getMulticastIP(uint16_t universe) {
@@ -459,6 +760,7 @@ uint16_t SacnProtocol::getBufferSizeInternal() const {
 
 void SacnProtocol::clearFrameReady() {
     buffer_.clearReady();
+    frameComplete_ = false;
 }
 
 const char* SacnProtocol::getActiveSourceName() const {
@@ -475,4 +777,43 @@ uint8_t SacnProtocol::getActivePriority() const {
     return universes_[0].activePriority;
 }
 
+void SacnProtocol::onFrameShown(uint32_t shownAtUs) {
+    for (uint8_t i = 0; i < universeCount_; i++) {
+        SacnUniverse& uni = universes_[i];
+        if (uni.pendingShow) {
+            uni.showLatency.record(shownAtUs - uni.pendingArrivalUs);
+            uni.pendingShow = false;
+        }
+    }
+}
+
+void SacnProtocol::resetStats() {
+    for (uint8_t i = 0; i < SACN_MAX_UNIVERSES; i++) {
+        SacnUniverse& uni = universes_[i];
+        memset(&uni.stats, 0, sizeof(SacnCounters));
+        uni.interArrival.reset();
+        uni.showLatency.reset();
+        uni.jitterUs = 0;
+        uni.lastArrivalUs = 0;
+        uni.lastIntervalUs = 0;
+        uni.pendingShow = false;
+    }
+    for (uint8_t i = 0; i < SACN_MAX_SOURCES; i++) {
+        memset(&sources_[i].stats, 0, sizeof(SacnCounters));
+    }
+}
+
+SacnCounters SacnProtocol::getTotals() const {
+    SacnCounters totals = {};
+    for (uint8_t i = 0; i < universeCount_; i++) {
+        const SacnCounters& s = universes_[i].stats;
+        totals.received += s.received;
+        totals.outOfOrder += s.outOfOrder;
+        totals.lost += s.lost;
+        totals.preview += s.preview;
+        totals.terminated += s.terminated;
+    }
+    return totals;
+}
+
 } // namespace lume
@@ -4,46 +4,84 @@
 #include "protocol.h"
 #include <WiFiUdp.h>
 #include "../constants.h"
+#include "../core/histogram.h"
 
 namespace lume {
 
 // E1.31 (sACN) Constants
 constexpr uint16_t SACN_PORT = 5568;
 constexpr uint16_t SACN_HEADER_SIZE = 126;
+constexpr uint16_t SACN_SYNC_PACKET_SIZE = 49;
 constexpr uint16_t SACN_MAX_CHANNELS = 512;
 constexpr uint8_t SACN_MAX_UNIVERSES = 8;
 constexpr uint8_t SACN_MAX_SOURCES = 4;
 constexpr uint32_t SACN_SOURCE_TIMEOUT_MS = 2500;
+constexpr uint32_t SACN_CLEANUP_INTERVAL_MS = 100;
 
 // sACN packet vectors
 constexpr uint32_t SACN_VECTOR_ROOT = 0x00000004;
 constexpr uint32_t SACN_VECTOR_FRAME = 0x00000002;
+constexpr uint32_t SACN_VECTOR_ROOT_EXTENDED = 0x00000008;
+constexpr uint32_t SACN_VECTOR_EXTENDED_SYNC = 0x00000001;
 constexpr uint8_t SACN_VECTOR_DMP = 0x02;
 
 // Options flags
 constexpr uint8_t SACN_OPT_PREVIEW = 0x80;
 constexpr uint8_t SACN_OPT_STREAM_TERM = 0x40;
 
+// How equal-priority sources are combined on a universe
+enum class SacnMergeMode : uint8_t {
+    HTP = 0,    // Highest takes precedence, per channel
+    LTP = 1     // Latest takes precedence: a source takes over when its data changes
+};
+
+const char* sacnMergeModeToString(SacnMergeMode mode);
+
+// Reception counters (kept per universe and per source)
+struct SacnCounters {
+    uint32_t received;            // Data packets addressed to our universes
+    uint32_t outOfOrder;          // Dropped by the E1.31 sequence check
+    uint32_t lost;                // Sum of forward sequence gaps
+    uint32_t preview;             // Preview-flagged packets
+    uint32_t terminated;          // Stream-terminated packets
+};
+
 // Source tracking for priority handling
 struct SacnSource {
     uint8_t cid[16];              // Unique source identifier
     char name[64];                // Human-readable source name
     uint8_t priority;             // 0-200, higher wins
-    uint8_t lastSequence;
+    uint8_t lastSequence[SACN_MAX_UNIVERSES];  // Sequence is per source per universe
+    uint8_t sequenceValid;        // Bitmask: lastSequence[i] has been seen
+    uint8_t universeMask;         // Bitmask: universes this source is currently sending
+    uint16_t channelCount[SACN_MAX_UNIVERSES];
+    uint32_t universeSeen[SACN_MAX_UNIVERSES];  // Per-universe timeout (millis)
     uint32_t lastSeen;
     bool active;
+    SacnCounters stats;
 };
 
 // Per-universe data
 struct SacnUniverse {
     uint16_t universe;
-    uint8_t dmxData[SACN_MAX_CHANNELS];
+    alignas(4) uint8_t dmxData[SACN_MAX_CHANNELS];  // Merged output
     uint16_t channelCount;
     uint8_t activePriority;
-    uint8_t activeSourceIndex;
+    uint8_t activeSourceIndex;    // LTP owner, or lowest contributing source for HTP
+    uint8_t ownerMask;            // Bitmask of sources contributing to dmxData
     uint32_t lastPacketTime;
     uint32_t packetCount;
     bool hasData;
+    
+    // Reception diagnostics (all times in microseconds)
+    SacnCounters stats;
+    Histogram interArrival;       // Gap between accepted packets
+    Histogram showLatency;        // Socket dequeue -> FastLED.show()
+    uint32_t jitterUs;            // Smoothed inter-arrival variation (RFC 3550 style)
+    uint32_t lastArrivalUs;
+    uint32_t lastIntervalUs;
+    uint32_t pendingArrivalUs;    // Arrival of newest data not yet shown
+    bool pendingShow;
 };
 
 /**
@@ -54,7 +92,9 @@ struct SacnUniverse {
  * - Multicast group join/leave
  * - E1.31 packet parsing
  * - Multi-universe support
- * - Source priority handling
+ * - Source priority handling with HTP/LTP merge of equal priorities
+ * - Frame completion detection (all universes, repeat, or sync packet)
+ * - Reception statistics (loss, reordering, jitter, show latency)
  * - Thread-safe buffer for main loop consumption
  * 
  * Follows the Protocol interface and single-writer architecture:
@@ -70,6 +110,10 @@ public:
     void configure(uint16_t startUniverse, uint8_t universeCount, 
                    bool unicastMode, uint16_t startChannel = 1);
     
+    // Equal-priority merge behaviour (safe to change at runtime)
+    void setMergeMode(SacnMergeMode mode) { mergeMode_ = mode; }
+    SacnMergeMode getMergeMode() const { return mergeMode_; }
+    
     // --- Protocol interface ---
     
     bool begin_impl() override;
@@ -87,6 +131,9 @@ public:
     uint16_t getBufferSizeInternal() const override;
     void clearFrameReady() override;
     
+    bool isFrameComplete() const override { return frameComplete_; }
+    uint32_t getFrameArrivalUs() const override { return frameArrivalUs_; }
+    
     const char* getName() const override { return "sACN"; }
     uint32_t getPacketCount() const override { return totalPacketCount_; }
     uint32_t getLastPacketTime() const override { return lastAnyPacketTime_; }
@@ -98,6 +145,20 @@ public:
     bool isUnicastMode() const { return unicastMode_; }
     const char* getActiveSourceName() const;
     uint8_t getActivePriority() const;
+    
+    // --- Reception diagnostics ---
+    
+    // Controller reports when buffered data reached the strip
+    void onFrameShown(uint32_t shownAtUs) override;
+    
+    // Clear all counters and histograms (also done on begin)
+    void resetStats();
+    
+    const SacnUniverse& getUniverse(uint8_t index) const { return universes_[index]; }
+    const SacnSource& getSource(uint8_t index) const { return sources_[index]; }
+    SacnCounters getTotals() const;
+    uint32_t getSyncPacketCount() const { return syncPacketCount_; }
+    uint16_t getSyncAddress() const { return syncAddress_; }
 
 private:
     // UDP socket
@@ -116,6 +177,12 @@ private:
     // Source tracking
     SacnSource sources_[SACN_MAX_SOURCES];
     
+    // Last data from each source on each universe (merge inputs).
+    // Word-aligned so the HTP kernel can work 4 channels at a time.
+    alignas(4) uint8_t sourceData_[SACN_MAX_SOURCES][SACN_MAX_UNIVERSES][SACN_MAX_CHANNELS];
+    SacnMergeMode mergeMode_;
+    bool mergeDirty_;             // Merge changed outside packet reception
+    
     // State
     bool enabled_;
     bool initialized_;
@@ -123,6 +190,17 @@ private:
     uint32_t totalPacketCount_;
     uint32_t lastAnyPacketTime_;
     
+    // Frame boundary detection (for show-on-arrival)
+    uint8_t frameMask_;           // Universes received since the last complete frame
+    bool frameComplete_;
+    uint32_t frameArrivalUs_;     // Arrival of the packet that completed the frame
+    uint32_t lastDataUs_;         // Arrival of the newest packet in the frame
+    int heldPacketSize_;          // Packet left in packetBuffer_ for the next frame (0 = none)
+    uint32_t heldArrivalUs_;
+    uint16_t syncAddress_;        // Sync universe announced by the data source (0 = none)
+    uint32_t lastSyncTime_;
+    uint32_t syncPacketCount_;
+    
     // Thread-safe output buffer
     ProtocolBuffer<MAX_LED_COUNT> buffer_;
     
@@ -132,11 +210,21 @@ private:
     bool active_;
     
     // Packet parsing
-    bool parsePacket(int packetSize);
+    bool parsePacket(int packetSize, uint32_t arrivalUs);
+    bool parseSyncPacket(uint32_t arrivalUs);
+    void markUniverseReceived(uint8_t uniIndex, uint16_t syncAddress, uint32_t arrivalUs);
+    bool waitingForSync(uint16_t syncAddress) const;
+    bool repeatsFrameUniverse(uint8_t uniIndex, const uint8_t* cid, uint16_t syncAddress,
+                              uint8_t options) const;
     
     // Source management
+    int findSource(const uint8_t* cid) const;
     int findOrCreateSource(const uint8_t* cid, const char* name, uint8_t priority);
     void cleanupStaleSources();
+    void dropSourceUniverse(uint8_t sourceIndex, uint8_t uniIndex);
+    
+    // Merge engine
+    void mergeUniverse(uint8_t uniIndex, int changedSource);
     
     // Multicast management
     void joinAllMulticast();
@@ -0,0 +1,277 @@
+/**
+ * SacnSender - E1.31 output implementation
+ */
+
+#include "sacn_sender.h"
+#include "../core/controller.h"
+#include "../logging.h"
+#include <WiFi.h>
+
+namespace lume {
+
+// Global instance
+SacnSender sacnSender;
+
+// ACN packet identifier (bytes 4-15)
+static const uint8_t ACN_ID[] = {0x41, 0x53, 0x43, 0x2d, 0x45, 0x31, 0x2e, 0x31, 0x37, 0x00, 0x00, 0x00};
+
+static inline void put16(uint8_t* p, uint16_t v) {
+    p[0] = v >> 8;
+    p[1] = v & 0xFF;
+}
+
+static inline void put32(uint8_t* p, uint32_t v) {
+    p[0] = v >> 24;
+    p[1] = (v >> 16) & 0xFF;
+    p[2] = (v >> 8) & 0xFF;
+    p[3] = v & 0xFF;
+}
+
+// PDU flags (0x7) + length from this offset to the end of the packet
+static inline void putFlagsLength(uint8_t* packet, uint16_t offset, uint16_t packetSize) {
+    put16(packet + offset, 0x7000 | (packetSize - offset));
+}
+
+SacnSender::SacnSender()
+    : configPending_(false)
+    , running_(false)
+    , universeCount_(0)
+    , rangeStart_(0)
+    , rangeCount_(0)
+    , syncSequence_(0)
+    , unicast_(false)
+    , lastFrame_(0)
+    , lastSendMs_(0)
+    , framesSent_(0)
+    , packetsSent_(0)
+    , sendErrors_(0) {
+    memset(packets_, 0, sizeof(packets_));
+    memset(packetSize_, 0, sizeof(packetSize_));
+    memset(syncPacket_, 0, sizeof(syncPacket_));
+    memset(cid_, 0, sizeof(cid_));
+    memset(sequence_, 0, sizeof(sequence_));
+}
+
+void SacnSender::configure(const SacnSenderConfig& config) {
+    pending_ = config;
+    pending_.priority = min(pending_.priority, (uint8_t)200);
+    pending_.maxFps = constrain(pending_.maxFps, (uint16_t)1, (uint16_t)120);
+    configPending_ = true;
+}
+
+bool SacnSender::begin() {
+    if (!config_.enabled) {
+        return false;
+    }
+    if (running_) {
+        stop();
+    }
+
+    unicast_ = config_.destination.length() > 0;
+    if (unicast_ && !unicastIP_.fromString(config_.destination)) {
+        LOG_ERROR(LogTag::SACN, "Invalid sACN output destination: %s", config_.destination.c_str());
+        return false;
+    }
+
+    // CID must stay the same across reboots: derive it from the MAC
+    uint64_t mac = ESP.getEfuseMac();
+    static const uint8_t CID_PREFIX[] = {'L', 'U', 'M', 'E', 0x40, 0x00, 0x80, 0x00, 0x00, 0x00};
+    memcpy(cid_, CID_PREFIX, sizeof(CID_PREFIX));
+    for (uint8_t i = 0; i < 6; i++) {
+        cid_[10 + i] = (mac >> (8 * i)) & 0xFF;
+    }
+
+    resolveRange();
+    buildPackets();
+
+    lastFrame_ = controller.getFrame() - 1;  // Send the current frame right away
+    lastSendMs_ = 0;
+    running_ = true;
+
+    LOG_INFO(LogTag::SACN, "sACN output: LEDs %d-%d -> universe %d-%d (%s, priority %d%s)",
+             rangeStart_, rangeStart_ + rangeCount_ - 1,
+             config_.universe, config_.universe + universeCount_ - 1,
+             unicast_ ? config_.destination.c_str() : "multicast",
+             config_.priority, config_.syncUniverse ? ", synchronized" : "");
+    return true;
+}
+
+void SacnSender::stop() {
+    if (!running_) {
+        return;
+    }
+
+    // Tell receivers to release now instead of waiting for their timeout
+    for (uint8_t u = 0; u < universeCount_; u++) {
+        packets_[u][112] |= SACN_OPT_STREAM_TERM;
+    }
+    for (uint8_t n = 0; n < SACN_SENDER_TERMINATE_COUNT; n++) {
+        for (uint8_t u = 0; u < universeCount_; u++) {
+            sendUniverse(u);
+        }
+    }
+
+    udp_.stop();
+    running_ = false;
+    LOG_INFO(LogTag::SACN, "sACN output stopped");
+}
+
+bool SacnSender::resolveRange() {
+    uint16_t stripLength = controller.getLedCount();
+    uint16_t start = config_.ledStart;
+    uint16_t count = config_.ledCount;
+
+    if (config_.segment != SACN_SENDER_NO_SEGMENT) {
+        Segment* seg = controller.getSegment(config_.segment);
+        if (seg) {
+            start = seg->getStart();
+            count = seg->getLength();
+        } else {
+            count = 0;
+        }
+    }
+
+    if (start >= stripLength) {
+        count = 0;
+    } else if (count == 0 || start + count > stripLength) {
+        count = stripLength - start;
+    }
+    count = min(count, (uint16_t)(SACN_SENDER_MAX_UNIVERSES * LEDS_PER_UNIVERSE));
+
+    if (start == rangeStart_ && count == rangeCount_) {
+        return false;
+    }
+    rangeStart_ = start;
+    rangeCount_ = count;
+    universeCount_ = (count + LEDS_PER_UNIVERSE - 1) / LEDS_PER_UNIVERSE;
+    return true;
+}
+
+void SacnSender::buildPackets() {
+    for (uint8_t u = 0; u < universeCount_; u++) {
+        uint8_t* p = packets_[u];
+        uint16_t leds = min((uint16_t)(rangeCount_ - u * LEDS_PER_UNIVERSE), LEDS_PER_UNIVERSE);
+        uint16_t slots = leds * 3;
+        uint16_t size = SACN_HEADER_SIZE + slots;
+        packetSize_[u] = size;
+
+        memset(p, 0, SACN_HEADER_SIZE);
+
+        // Root layer
+        put16(p + 0, 0x0010);                       // Preamble size
+        put16(p + 2, 0x0000);                       // Postamble size
+        memcpy(p + 4, ACN_ID, sizeof(ACN_ID));
+        putFlagsLength(p, 16, size);
+        put32(p + 18, SACN_VECTOR_ROOT);
+        memcpy(p + 22, cid_, sizeof(cid_));
+
+        // Framing layer
+        putFlagsLength(p, 38, size);
+        put32(p + 40, SACN_VECTOR_FRAME);
+        snprintf((char*)p + 44, 64, "LUME %s %02X%02X%02X", MDNS_HOSTNAME, cid_[13], cid_[14], cid_[15]);
+        p[108] = config_.priority;
+        put16(p + 109, config_.syncUniverse);
+        p[111] = sequence_[u];
+        p[112] = 0;                                 // Options
+        put16(p + 113, config_.universe + u);
+
+        // DMP layer
+        putFlagsLength(p, 115, size);
+        p[117] = SACN_VECTOR_DMP;
+        p[118] = 0xA1;                              // Address & data type
+        put16(p + 119, 0x0000);                     // First property address
+        put16(p + 121, 0x0001);                     // Address increment
+        put16(p + 123, slots + 1);                  // Property count (start code + slots)
+        p[125] = 0x00;                              // DMX start code
+    }
+
+    // Universe synchronization packet
+    memset(syncPacket_, 0, sizeof(syncPacket_));
+    put16(syncPacket_ + 0, 0x0010);
+    memcpy(syncPacket_ + 4, ACN_ID, sizeof(ACN_ID));
+    putFlagsLength(syncPacket_, 16, SACN_SYNC_PACKET_SIZE);
+    put32(syncPacket_ + 18, SACN_VECTOR_ROOT_EXTENDED);
+    memcpy(syncPacket_ + 22, cid_, sizeof(cid_));
+    putFlagsLength(syncPacket_, 38, SACN_SYNC_PACKET_SIZE);
+    put32(syncPacket_ + 40, SACN_VECTOR_EXTENDED_SYNC);
+    put16(syncPacket_ + 45, config_.syncUniverse);
+}
+
+void SacnSender::update() {
+    if (configPending_) {
+        configPending_ = false;
+        stop();
+        config_ = pending_;
+        begin();
+    }
+    if (!running_) {
+        return;
+    }
+
+    // Segment edits and LED count changes move the range
+    if (resolveRange()) {
+        buildPackets();
+        LOG_INFO(LogTag::SACN, "sACN output range now LEDs %d-%d (%d universes)",
+                 rangeStart_, rangeStart_ + rangeCount_ - 1, universeCount_);
+    }
+    if (universeCount_ == 0) {
+        return;
+    }
+
+    uint32_t now = millis();
+    uint32_t frame = controller.getFrame();
+    uint32_t elapsed = now - lastSendMs_;
+    bool newFrame = frame != lastFrame_ && elapsed >= 1000u / config_.maxFps;
+    if (!newFrame && elapsed < SACN_SENDER_KEEPALIVE_MS) {
+        return;
+    }
+
+    writePayload(controller.getLeds());
+    for (uint8_t u = 0; u < universeCount_; u++) {
+        sendUniverse(u);
+    }
+    if (config_.syncUniverse) {
+        sendSync();
+    }
+
+    lastFrame_ = frame;
+    lastSendMs_ = now;
+    framesSent_++;
+}
+
+void SacnSender::writePayload(const CRGB* leds) {
+    const CRGB* src = leds + rangeStart_;
+    for (uint8_t u = 0; u < universeCount_; u++) {
+        // CRGB is packed r,g,b - the slots are a straight copy
+        uint16_t slots = packetSize_[u] - SACN_HEADER_SIZE;
+        memcpy(packets_[u] + SACN_HEADER_SIZE, src, slots);
+        src += LEDS_PER_UNIVERSE;
+    }
+}
+
+void SacnSender::sendUniverse(uint8_t index) {
+    uint8_t* p = packets_[index];
+    p[111] = sequence_[index]++;
+    if (sendTo(config_.universe + index, p, packetSize_[index])) {
+        packetsSent_++;
+    }
+}
+
+void SacnSender::sendSync() {
+    syncPacket_[44] = syncSequence_++;
+    if (sendTo(config_.syncUniverse, syncPacket_, SACN_SYNC_PACKET_SIZE)) {
+        packetsSent_++;
+    }
+}
+
+bool SacnSender::sendTo(uint16_t universe, const uint8_t* data, uint16_t size) {
+    IPAddress ip = unicast_ ? unicastIP_
+                            : IPAddress(239, 255, (universe >> 8) & 0xFF, universe & 0xFF);
+    if (!udp_.beginPacket(ip, SACN_PORT) || udp_.write(data, size) != size || !udp_.endPacket()) {
+        sendErrors_++;
+        return false;
+    }
+    return true;
+}
+
+} // namespace lume
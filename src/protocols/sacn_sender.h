@@ -0,0 +1,107 @@
+#ifndef LUME_PROTOCOL_SACN_SENDER_H
+#define LUME_PROTOCOL_SACN_SENDER_H
+
+#include "sacn.h"
+
+namespace lume {
+
+constexpr uint8_t SACN_SENDER_MAX_UNIVERSES = 8;
+constexpr uint8_t SACN_SENDER_NO_SEGMENT = 255;
+constexpr uint16_t SACN_SENDER_DEFAULT_FPS = 40;   // Below the 44 Hz DMX refresh gateways expect
+constexpr uint32_t SACN_SENDER_KEEPALIVE_MS = 1000; // Resend unchanged data at least this often
+constexpr uint8_t SACN_SENDER_TERMINATE_COUNT = 3;  // E1.31 6.2.6: three terminated packets
+
+// sACN output configuration
+struct SacnSenderConfig {
+    bool enabled = false;
+    uint16_t universe = 1;          // First output universe
+    uint16_t ledStart = 0;          // LED range to send (ignored when segment is set)
+    uint16_t ledCount = 0;          // 0 = to the end of the strip
+    uint8_t segment = SACN_SENDER_NO_SEGMENT;  // Send this segment's range instead
+    uint8_t priority = 100;         // 0-200
+    String destination;             // Unicast IP; empty = multicast
+    uint16_t syncUniverse = 0;      // Send sync packets on this universe (0 = no sync)
+    uint16_t maxFps = SACN_SENDER_DEFAULT_FPS;
+};
+
+/**
+ * SacnSender - E1.31 source for driving downstream nodes and DMX gateways
+ *
+ * Packetizes an LED range (or a segment's range) into consecutive
+ * universes of 170 RGB pixels and sends each rendered frame, rate-limited
+ * to maxFps, with per-universe sequence numbers, priority and optional
+ * universe synchronization. Unchanged output is repeated every second so
+ * receivers don't time out.
+ *
+ * Packet headers are built once in begin(); per frame only the sequence
+ * number and DMX payload are rewritten. stop() sends stream-terminated
+ * packets so receivers release immediately.
+ *
+ * configure() may be called from any task: the new settings are picked
+ * up (with a stop/begin) on the next update(). Everything else is main
+ * loop only.
+ */
+class SacnSender {
+public:
+    SacnSender();
+
+    // Apply settings on the next update() (restarts the output)
+    void configure(const SacnSenderConfig& config);
+    const SacnSenderConfig& getConfig() const { return config_; }
+
+    bool begin();
+    void stop();                    // Sends stream-terminated packets
+    bool isRunning() const { return running_; }
+
+    // Send the controller's output if a new frame was shown (call from loop)
+    void update();
+
+    // --- Diagnostics ---
+
+    uint8_t getUniverseCount() const { return universeCount_; }
+    uint32_t getFramesSent() const { return framesSent_; }
+    uint32_t getPacketsSent() const { return packetsSent_; }
+    uint32_t getSendErrors() const { return sendErrors_; }
+
+private:
+    SacnSenderConfig config_;
+    SacnSenderConfig pending_;
+    volatile bool configPending_;
+    WiFiUDP udp_;
+    bool running_;
+
+    // Preallocated packets, one per universe, plus the sync packet
+    uint8_t packets_[SACN_SENDER_MAX_UNIVERSES][SACN_HEADER_SIZE + SACN_MAX_CHANNELS];
+    uint16_t packetSize_[SACN_SENDER_MAX_UNIVERSES];
+    uint8_t syncPacket_[SACN_SYNC_PACKET_SIZE];
+    uint8_t cid_[16];
+
+    uint8_t universeCount_;
+    uint16_t rangeStart_;           // Resolved LED range (follows segment changes)
+    uint16_t rangeCount_;
+    uint8_t sequence_[SACN_SENDER_MAX_UNIVERSES];
+    uint8_t syncSequence_;
+    IPAddress unicastIP_;
+    bool unicast_;
+
+    uint32_t lastFrame_;
+    uint32_t lastSendMs_;
+
+    uint32_t framesSent_;
+    uint32_t packetsSent_;
+    uint32_t sendErrors_;
+
+    bool resolveRange();
+    void buildPackets();
+    void writePayload(const CRGB* leds);
+    void sendUniverse(uint8_t index);
+    void sendSync();
+    bool sendTo(uint16_t universe, const uint8_t* data, uint16_t size);
+};
+
+// Global instance
+extern SacnSender sacnSender;
+
+} // namespace lume
+
+#endif // LUME_PROTOCOL_SACN_SENDER_H
@@ -1,9 +1,11 @@
 #include "storage.h"
+#include "protocols/clock_sync.h"
 
 const char* Storage::NAMESPACE_CONFIG = "config";
 const char* Storage::NAMESPACE_LED = "ledstate";
 const char* Storage::NAMESPACE_PROMPT = "prompt";
 const char* Storage::NAMESPACE_SCENES = "scenes";
+const char* Storage::NAMESPACE_PROTOCOLS = "protocols";
 
 Storage storage;
 
@@ -30,6 +32,22 @@ bool Storage::loadConfig(Config& config) {
     config.sacnUniverseCount = prefs.getUChar("sacn_ucnt", 1);
     config.sacnStartChannel = prefs.getUShort("sacn_ch", 1);
     config.sacnUnicast = prefs.getBool("sacn_uc", false);
+    config.sacnMergeMode = prefs.getUChar("sacn_merge", 0);
+    config.sacnOutEnabled = prefs.getBool("sacno_en", false);
+    config.sacnOutUniverse = prefs.getUShort("sacno_uni", 1);
+    config.sacnOutStart = prefs.getUShort("sacno_start", 0);
+    config.sacnOutCount = prefs.getUShort("sacno_cnt", 0);
+    config.sacnOutSegment = prefs.getUChar("sacno_seg", 255);
+    config.sacnOutPriority = prefs.getUChar("sacno_pri", 100);
+    config.sacnOutDestination = prefs.getString("sacno_dst", "");
+    config.sacnOutSync = prefs.getUShort("sacno_sync", 0);
+    config.sacnOutFps = prefs.getUShort("sacno_fps", 40);
+    config.protocolShowOnArrival = prefs.getBool("proto_soa", false);
+    config.protocolJitterMs = prefs.getUShort("proto_jit", 0);
+    config.protocolInterpolate = prefs.getBool("proto_interp", true);
+    config.clockSyncRole = prefs.getUChar("clk_role", 0);
+    config.clockSyncServer = prefs.getString("clk_server", "");
+    config.effectLockstep = prefs.getBool("fx_lockstep", false);
     
     // MQTT settings
     config.mqttEnabled = prefs.getBool("mqtt_en", false);
@@ -38,6 +56,8 @@ bool Storage::loadConfig(Config& config) {
     config.mqttUsername = prefs.getString("mqtt_user", "");
     config.mqttPassword = prefs.getString("mqtt_pass", "");
     config.mqttTopicPrefix = prefs.getString("mqtt_prefix", "lume");
+    config.mqttGroups = prefs.getString("mqtt_groups", "");
+    config.mqttGroupPrefix = prefs.getString("mqtt_gprefix", "lume");
     
     prefs.end();
     return true;
@@ -60,6 +80,22 @@ bool Storage::saveConfig(const Config& config) {
     prefs.putUChar("sacn_ucnt", config.sacnUniverseCount);
     prefs.putUShort("sacn_ch", config.sacnStartChannel);
     prefs.putBool("sacn_uc", config.sacnUnicast);
+    prefs.putUChar("sacn_merge", config.sacnMergeMode);
+    prefs.putBool("sacno_en", config.sacnOutEnabled);
+    prefs.putUShort("sacno_uni", config.sacnOutUniverse);
+    prefs.putUShort("sacno_start", config.sacnOutStart);
+    prefs.putUShort("sacno_cnt", config.sacnOutCount);
+    prefs.putUChar("sacno_seg", config.sacnOutSegment);
+    prefs.putUChar("sacno_pri", config.sacnOutPriority);
+    prefs.putString("sacno_dst", config.sacnOutDestination);
+    prefs.putUShort("sacno_sync", config.sacnOutSync);
+    prefs.putUShort("sacno_fps", config.sacnOutFps);
+    prefs.putBool("proto_soa", config.protocolShowOnArrival);
+    prefs.putUShort("proto_jit", config.protocolJitterMs);
+    prefs.putBool("proto_interp", config.protocolInterpolate);
+    prefs.putUChar("clk_role", config.clockSyncRole);
+    prefs.putString("clk_server", config.clockSyncServer);
+    prefs.putBool("fx_lockstep", config.effectLockstep);
     
     // MQTT settings
     prefs.putBool("mqtt_en", config.mqttEnabled);
@@ -68,6 +104,8 @@ bool Storage::saveConfig(const Config& config) {
     prefs.putString("mqtt_user", config.mqttUsername);
     prefs.putString("mqtt_pass", config.mqttPassword);
     prefs.putString("mqtt_prefix", config.mqttTopicPrefix);
+    prefs.putString("mqtt_groups", config.mqttGroups);
+    prefs.putString("mqtt_gprefix", config.mqttGroupPrefix);
     
     prefs.end();
     return true;
@@ -113,6 +151,68 @@ bool Storage::loadLedState(JsonDocument& state) {
     return err == DeserializationError::Ok;
 }
 
+bool Storage::saveProtocolPolicies(const JsonDocument& policies) {
+    if (!prefs.begin(NAMESPACE_PROTOCOLS, false)) {
+        return false;
+    }
+    
+    String jsonStr;
+    serializeJson(policies, jsonStr);
+    
+    // NVS has limits, so check size
+    if (jsonStr.length() > 4000) {
+        prefs.end();
+        return false;
+    }
+    
+    prefs.putString("policies", jsonStr);
+    prefs.end();
+    return true;
+}
+
+bool Storage::loadProtocolPolicies(JsonDocument& policies) {
+    if (!prefs.begin(NAMESPACE_PROTOCOLS, true)) {
+        return false;
+    }
+    
+    String jsonStr = prefs.getString("policies", "[]");
+    prefs.end();
+    
+    DeserializationError err = deserializeJson(policies, jsonStr);
+    return err == DeserializationError::Ok;
+}
+
+bool Storage::saveClusterConfig(const JsonDocument& cluster) {
+    if (!prefs.begin(NAMESPACE_PROTOCOLS, false)) {
+        return false;
+    }
+    
+    String jsonStr;
+    serializeJson(cluster, jsonStr);
+    
+    // NVS has limits, so check size
+    if (jsonStr.length() > 4000) {
+        prefs.end();
+        return false;
+    }
+    
+    prefs.putString("cluster", jsonStr);
+    prefs.end();
+    return true;
+}
+
+bool Storage::loadClusterConfig(JsonDocument& cluster) {
+    if (!prefs.begin(NAMESPACE_PROTOCOLS, true)) {
+        return false;
+    }
+    
+    String jsonStr = prefs.getString("cluster", "{}");
+    prefs.end();
+    
+    DeserializationError err = deserializeJson(cluster, jsonStr);
+    return err == DeserializationError::Ok;
+}
+
 bool Storage::saveLastEffect(const char* effectId) {
     if (!prefs.begin(NAMESPACE_LED, false)) {
         return false;
@@ -189,6 +289,26 @@ void Storage::configToJson(const Config& config, JsonDocument& doc, bool maskApi
     doc["sacnUniverseCount"] = config.sacnUniverseCount;
     doc["sacnStartChannel"] = config.sacnStartChannel;
     doc["sacnUnicast"] = config.sacnUnicast;
+    doc["sacnMergeMode"] = config.sacnMergeMode == 1 ? "ltp" : "htp";
+    doc["sacnOutEnabled"] = config.sacnOutEnabled;
+    doc["sacnOutUniverse"] = config.sacnOutUniverse;
+    doc["sacnOutStart"] = config.sacnOutStart;
+    doc["sacnOutCount"] = config.sacnOutCount;
+    if (config.sacnOutSegment == 255) {
+        doc["sacnOutSegment"] = -1;
+    } else {
+        doc["sacnOutSegment"] = config.sacnOutSegment;
+    }
+    doc["sacnOutPriority"] = config.sacnOutPriority;
+    doc["sacnOutDestination"] = config.sacnOutDestination;
+    doc["sacnOutSync"] = config.sacnOutSync;
+    doc["sacnOutFps"] = config.sacnOutFps;
+    doc["protocolShowOnArrival"] = config.protocolShowOnArrival;
+    doc["protocolJitterMs"] = config.protocolJitterMs;
+    doc["protocolInterpolate"] = config.protocolInterpolate;
+    doc["clockSyncRole"] = lume::clockSyncRoleToString(static_cast<lume::ClockSyncRole>(config.clockSyncRole));
+    doc["clockSyncServer"] = config.clockSyncServer;
+    doc["effectLockstep"] = config.effectLockstep;
     
     // MQTT settings
     doc["mqttEnabled"] = config.mqttEnabled;
@@ -197,6 +317,8 @@ void Storage::configToJson(const Config& config, JsonDocument& doc, bool maskApi
     doc["mqttUsername"] = config.mqttUsername.length() > 0 ? "****" : "";
     doc["mqttPassword"] = config.mqttPassword.length() > 0 ? "****" : "";
     doc["mqttTopicPrefix"] = config.mqttTopicPrefix;
+    doc["mqttGroups"] = config.mqttGroups;
+    doc["mqttGroupPrefix"] = config.mqttGroupPrefix;
 }
 
 bool Storage::configFromJson(Config& config, const JsonDocument& doc) {
@@ -248,6 +370,63 @@ bool Storage::configFromJson(Config& config, const JsonDocument& doc) {
     if (doc["sacnUnicast"].is<bool>()) {
         config.sacnUnicast = doc["sacnUnicast"].as<bool>();
     }
+    if (doc["sacnMergeMode"].is<const char*>()) {
+        String mode = doc["sacnMergeMode"].as<String>();
+        if (mode.equalsIgnoreCase("htp")) {
+            config.sacnMergeMode = 0;
+        } else if (mode.equalsIgnoreCase("ltp")) {
+            config.sacnMergeMode = 1;
+        }
+    }
+    if (doc["sacnOutEnabled"].is<bool>()) {
+        config.sacnOutEnabled = doc["sacnOutEnabled"].as<bool>();
+    }
+    if (doc["sacnOutUniverse"].is<int>()) {
+        config.sacnOutUniverse = constrain(doc["sacnOutUniverse"].as<int>(), 1, 63999);
+    }
+    if (doc["sacnOutStart"].is<int>()) {
+        config.sacnOutStart = constrain(doc["sacnOutStart"].as<int>(), 0, 65535);
+    }
+    if (doc["sacnOutCount"].is<int>()) {
+        config.sacnOutCount = constrain(doc["sacnOutCount"].as<int>(), 0, 65535);
+    }
+    if (doc["sacnOutSegment"].is<int>()) {
+        int seg = doc["sacnOutSegment"].as<int>();
+        config.sacnOutSegment = (seg < 0 || seg > 254) ? 255 : seg;
+    }
+    if (doc["sacnOutPriority"].is<int>()) {
+        config.sacnOutPriority = constrain(doc["sacnOutPriority"].as<int>(), 0, 200);
+    }
+    if (doc["sacnOutDestination"].is<const char*>()) {
+        config.sacnOutDestination = doc["sacnOutDestination"].as<String>();
+    }
+    if (doc["sacnOutSync"].is<int>()) {
+        config.sacnOutSync = constrain(doc["sacnOutSync"].as<int>(), 0, 63999);
+    }
+    if (doc["sacnOutFps"].is<int>()) {
+        config.sacnOutFps = constrain(doc["sacnOutFps"].as<int>(), 1, 120);
+    }
+    if (doc["protocolShowOnArrival"].is<bool>()) {
+        config.protocolShowOnArrival = doc["protocolShowOnArrival"].as<bool>();
+    }
+    if (doc["protocolJitterMs"].is<int>()) {
+        config.protocolJitterMs = constrain(doc["protocolJitterMs"].as<int>(), 0, 60);
+    }
+    if (doc["protocolInterpolate"].is<bool>()) {
+        config.protocolInterpolate = doc["protocolInterpolate"].as<bool>();
+    }
+    if (doc["clockSyncRole"].is<const char*>()) {
+        lume::ClockSyncRole role;
+        if (lume::clockSyncRoleFromString(doc["clockSyncRole"].as<const char*>(), role)) {
+            config.clockSyncRole = static_cast<uint8_t>(role);
+        }
+    }
+    if (doc["clockSyncServer"].is<const char*>()) {
+        config.clockSyncServer = doc["clockSyncServer"].as<String>();
+    }
+    if (doc["effectLockstep"].is<bool>()) {
+        config.effectLockstep = doc["effectLockstep"].as<bool>();
+    }
     
     // MQTT settings
     if (doc["mqttEnabled"].is<bool>()) {
@@ -274,6 +453,12 @@ bool Storage::configFromJson(Config& config, const JsonDocument& doc) {
     if (doc["mqttTopicPrefix"].is<const char*>()) {
         config.mqttTopicPrefix = doc["mqttTopicPrefix"].as<String>();
     }
+    if (doc["mqttGroups"].is<const char*>()) {
+        config.mqttGroups = doc["mqttGroups"].as<String>();
+    }
+    if (doc["mqttGroupPrefix"].is<const char*>()) {
+        config.mqttGroupPrefix = doc["mqttGroupPrefix"].as<String>();
+    }
     
     return true;
 }
@@ -20,6 +20,24 @@ struct Config {
     uint8_t sacnUniverseCount;    // Number of universes (1-8, for >170 LEDs)
     uint16_t sacnStartChannel;
     bool sacnUnicast;             // true = unicast mode, false = multicast
+    uint8_t sacnMergeMode;        // Equal-priority merge: 0 = HTP, 1 = LTP
+    // sACN output (this node as a source)
+    bool sacnOutEnabled;
+    uint16_t sacnOutUniverse;     // First output universe
+    uint16_t sacnOutStart;        // LED range to send
+    uint16_t sacnOutCount;        // 0 = to the end of the strip
+    uint8_t sacnOutSegment;       // Send a segment's range instead (255 = use LED range)
+    uint8_t sacnOutPriority;
+    String sacnOutDestination;    // Unicast IP, empty = multicast
+    uint16_t sacnOutSync;         // Sync universe (0 = no sync packets)
+    uint16_t sacnOutFps;
+    bool protocolShowOnArrival;   // Latch protocol frames on arrival (low latency)
+    uint16_t protocolJitterMs;    // Jitter buffer playout delay (0 = off)
+    bool protocolInterpolate;     // Blend between buffered frames
+    // Shared clock between nodes
+    uint8_t clockSyncRole;        // 0 = off, 1 = master, 2 = client
+    String clockSyncServer;       // Client: master IP, empty = broadcast discovery
+    bool effectLockstep;          // Render effects on the shared clock
     
     // MQTT settings
     bool mqttEnabled;
@@ -28,6 +46,8 @@ struct Config {
     String mqttUsername;
     String mqttPassword;
     String mqttTopicPrefix;       // Base topic (e.g., "lume")
+    String mqttGroups;            // Comma-separated group names
+    String mqttGroupPrefix;       // Group topics base, shared by the fleet
     
     Config() : 
         wifiSSID(""),
@@ -42,12 +62,30 @@ struct Config {
         sacnUniverseCount(1),
         sacnStartChannel(1),
         sacnUnicast(false),
+        sacnMergeMode(0),
+        sacnOutEnabled(false),
+        sacnOutUniverse(1),
+        sacnOutStart(0),
+        sacnOutCount(0),
+        sacnOutSegment(255),
+        sacnOutPriority(100),
+        sacnOutDestination(""),
+        sacnOutSync(0),
+        sacnOutFps(40),
+        protocolShowOnArrival(false),
+        protocolJitterMs(0),
+        protocolInterpolate(true),
+        clockSyncRole(0),
+        clockSyncServer(""),
+        effectLockstep(false),
         mqttEnabled(false),
         mqttBroker(""),
         mqttPort(1883),
         mqttUsername(""),
         mqttPassword(""),
-        mqttTopicPrefix("lume") {}
+        mqttTopicPrefix("lume"),
+        mqttGroups(""),
+        mqttGroupPrefix("lume") {}
 };
 
 // Last generated effect spec storage
@@ -87,6 +125,14 @@ public:
     bool saveLedState(const JsonDocument& state);
     bool loadLedState(JsonDocument& state);
     
+    // Protocol arbitration policies (JSON array keyed by protocol name)
+    bool saveProtocolPolicies(const JsonDocument& policies);
+    bool loadProtocolPolicies(JsonDocument& policies);
+    
+    // Leader/follower cluster settings (JSON object, see api/cluster.cpp)
+    bool saveClusterConfig(const JsonDocument& cluster);
+    bool loadClusterConfig(JsonDocument& cluster);
+    
     // Effect persistence (for restoring last effect after reboot)
     bool saveLastEffect(const char* effectId);
     bool loadLastEffect(String& effectId);
@@ -115,6 +161,7 @@ private:
     static const char* NAMESPACE_LED;
     static const char* NAMESPACE_PROMPT;
     static const char* NAMESPACE_SCENES;
+    static const char* NAMESPACE_PROTOCOLS;
 };
 
 extern Storage storage;
@@ -33,7 +33,7 @@ void effectBreathe(SegmentView& view, const ParamValues& params, uint32_t frame,
     uint8_t bpm = map(speed, 1, 255, 5, 30);
     
     // Sine wave breathing - never fully off (looks weird)
-    uint8_t breath = beatsin8(bpm, 20, 255);
+    uint8_t breath = effectBeatsin8(bpm, 20, 255);
     
     // Apply color at breathing brightness
     color.nscale8(breath);
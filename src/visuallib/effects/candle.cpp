@@ -51,7 +51,7 @@ void effectCandle(SegmentView& view, const ParamValues& params, uint32_t frame,
         state->lastFlickerChange = 0;
     }
     
-    uint32_t now = millis();
+    uint32_t now = effectMillis();
     
     // Speed affects flicker frequency
     uint32_t flickerDelay = map(speed, 1, 255, 150, 10);
@@ -30,7 +30,7 @@ void effectPulse(SegmentView& view, const ParamValues& params, uint32_t frame, b
     uint8_t bpm = speed / 4;  // Map 1-255 to reasonable BPM
     if (bpm < 10) bpm = 10;
     
-    uint8_t brightness = beatsin8(bpm, 20, 255);
+    uint8_t brightness = effectBeatsin8(bpm, 20, 255);
     
     // Fill with color, scaled by brightness
     color.nscale8(brightness);
@@ -29,7 +29,7 @@ void effectSinelon(SegmentView& view, const ParamValues& params, uint32_t frame,
     
     // Calculate bouncing position using sine wave
     uint8_t bpm = speed / 10 + 5;
-    uint16_t pos = beatsin16(bpm, 0, len - 1);
+    uint16_t pos = effectBeatsin16(bpm, 0, len - 1);
     
     // Color cycles with frame
     uint8_t hue = frame & 0xFF;
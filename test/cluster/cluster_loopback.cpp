@@ -0,0 +1,374 @@
+/**
+ * Cluster loopback test - the firmware's cluster core over real UDP
+ *
+ * Runs a leader and several followers in one process, each with its own
+ * loopback socket and its own clock offset (as if the nodes had booted at
+ * different times). The leader fragments a test pattern with
+ * clusterWritePacket(); each follower hands what arrives to the same
+ * ClusterReceiver the firmware uses (src/protocols/cluster_core.cpp) and
+ * checks what it publishes:
+ *
+ * - every whole frame shows exactly the leader's pixels for that frame
+ * - followers change frame within SKEW_LIMIT_US of each other
+ * - a fragment whose frame size disagrees with the rest of its frame is
+ *   rejected (built with AddressSanitizer, so a stray write fails loudly)
+ *
+ *   ./cluster_loopback [--followers N] [--pixels N] [--fps N] [--loss F] [--seconds N]
+ *   ./cluster_loopback follower [--port N] [--node N] [--seconds N]
+ *
+ * "follower" listens for a real leader instead (a LUME device, or
+ * test/cluster_sim.py) and prints its counters. Exits 1 on failure.
+ */
+
+#include "../../src/protocols/cluster_core.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdio>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace lume;
+
+static constexpr uint32_t SKEW_LIMIT_US = 2000;       // p95 across followers, whole frames
+static constexpr uint16_t BAD_FRAGMENT_EVERY = 25;     // Frames
+
+static std::mt19937 rng(12345);
+
+static uint64_t hostMicros() {
+    using namespace std::chrono;
+    return duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+// micros() of a node that booted at some random time
+struct NodeClock {
+    uint32_t base = rng();
+    uint32_t micros() const { return (uint32_t)hostMicros() + base; }
+};
+
+// UDP shim: a non-blocking datagram socket, in place of WiFiUDP
+class LoopbackUdp {
+public:
+    ~LoopbackUdp() {
+        if (fd_ >= 0) close(fd_);
+    }
+
+    // port 0 picks a free one; anyAddress listens beyond loopback
+    bool begin(uint16_t port, bool anyAddress = false) {
+        fd_ = socket(AF_INET, SOCK_DGRAM, 0);
+        if (fd_ < 0) return false;
+        int size = 1 << 20;
+        setsockopt(fd_, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+        sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(port);
+        addr.sin_addr.s_addr = htonl(anyAddress ? INADDR_ANY : INADDR_LOOPBACK);
+        if (bind(fd_, (sockaddr*)&addr, sizeof(addr)) != 0) return false;
+        socklen_t len = sizeof(addr);
+        getsockname(fd_, (sockaddr*)&addr, &len);
+        port_ = ntohs(addr.sin_port);
+        return true;
+    }
+
+    // Bytes read, or -1 when nothing is waiting
+    int read(uint8_t* buffer, size_t size) {
+        return (int)recv(fd_, buffer, size, MSG_DONTWAIT);
+    }
+
+    bool send(uint16_t port, const uint8_t* data, size_t size) {
+        sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(port);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        return sendto(fd_, data, size, 0, (sockaddr*)&addr, sizeof(addr)) == (ssize_t)size;
+    }
+
+    uint16_t port() const { return port_; }
+
+private:
+    int fd_ = -1;
+    uint16_t port_ = 0;
+};
+
+// Canvas pixel i of a frame; every frame differs from its neighbours
+static CRGB pattern(uint32_t frame, uint16_t i) {
+    return CRGB((uint8_t)(frame * 3 + i), (uint8_t)(frame * 7 + i * 5), (uint8_t)(i ^ frame));
+}
+
+static uint32_t percentile(std::vector<uint32_t> values, unsigned pct) {
+    if (values.empty()) return 0;
+    std::sort(values.begin(), values.end());
+    size_t index = (values.size() * pct + 99) / 100;
+    return values[index > 0 ? index - 1 : 0];
+}
+
+static uint16_t packetTotal(const uint8_t* p) {
+    return ((uint16_t)p[24] << 8) | p[25];
+}
+
+struct TestFollower {
+    uint8_t node = 0;
+    uint16_t start = 0;
+    uint16_t count = 0;
+    LoopbackUdp udp;
+    NodeClock clock;
+    ClusterReceiver receiver;
+
+    uint32_t checked = 0;                     // Whole frames compared with the pattern
+    uint32_t mismatched = 0;
+    uint32_t badRejected = 0;
+    uint32_t badAccepted = 0;
+    std::map<uint32_t, uint64_t> shownAt;     // Whole frame -> host time
+
+    void poll() {
+        uint8_t packet[CLUSTER_PACKET_SIZE + 64];
+        int size;
+        while ((size = udp.read(packet, sizeof(packet))) > 0) {
+            bool accepted = receiver.receive(packet, size, clock.micros());
+            if (size >= CLUSTER_HEADER_SIZE && packetTotal(packet) != count) {
+                (accepted ? badAccepted : badRejected)++;
+            }
+        }
+
+        ClusterFollowerStats before = receiver.getStats();
+        if (!receiver.schedule(clock.micros())) {
+            return;
+        }
+        const ClusterFollowerStats& after = receiver.getStats();
+        if (after.frames == before.frames) {
+            return;  // A blend in place of a lost frame
+        }
+        if (after.repaired != before.repaired) {
+            return;  // Gaps filled from the previous frame, after a grace period
+        }
+        uint32_t frame = receiver.getLastFrame();
+        shownAt[frame] = hostMicros();
+
+        checked++;
+        const CRGB* out = receiver.getOutput();
+        if (receiver.getOutputCount() != count) {
+            mismatched++;
+            return;
+        }
+        for (uint16_t i = 0; i < count; i++) {
+            if (out[i] != pattern(frame, start + i)) {
+                mismatched++;
+                return;
+            }
+        }
+    }
+};
+
+struct Options {
+    int followers = 3;
+    int pixels = 600;           // > 480 exercises fragmentation
+    int fps = 40;
+    int delayMs = 50;
+    double loss = 0.02;
+    double seconds = 3;
+    int port = CLUSTER_PORT;
+    int node = 1;
+};
+
+static int runLoopback(const Options& opt) {
+    if (opt.pixels <= 0 || opt.pixels > 960 || opt.followers <= 0 || opt.fps <= 0) {
+        fprintf(stderr, "pixels must be 1-960, followers and fps positive\n");
+        return 1;
+    }
+
+    LoopbackUdp leaderUdp;
+    NodeClock leaderClock;
+    std::vector<TestFollower> followers(opt.followers);
+    if (!leaderUdp.begin(0)) {
+        perror("leader socket");
+        return 1;
+    }
+    for (int f = 0; f < opt.followers; f++) {
+        TestFollower& follower = followers[f];
+        follower.node = f + 1;
+        follower.start = f * opt.pixels;
+        follower.count = opt.pixels;
+        follower.receiver.configure(follower.node, ClusterConceal::Interpolate);
+        if (!follower.udp.begin(0) || !follower.receiver.allocate()) {
+            perror("follower");
+            return 1;
+        }
+    }
+
+    std::vector<CRGB> canvas(opt.followers * opt.pixels);
+    std::uniform_real_distribution<double> chance(0.0, 1.0);
+    uint8_t packet[CLUSTER_PACKET_SIZE];
+    uint32_t frames = (uint32_t)(opt.seconds * opt.fps);
+    uint32_t frame = 0;
+    uint32_t dropped = 0;
+    uint64_t interval = 1000000 / opt.fps;
+    uint64_t start = hostMicros();
+    uint64_t end = start + frames * interval + opt.delayMs * 1000 + 200000;
+
+    while (hostMicros() < end) {
+        if (frame < frames && hostMicros() >= start + frame * interval) {
+            frame++;
+            for (size_t i = 0; i < canvas.size(); i++) {
+                canvas[i] = pattern(frame, i);
+            }
+            // Frames carrying a bad fragment lose nothing, so it always
+            // arrives after the good ones have set the frame size
+            bool bad = frame % BAD_FRAGMENT_EVERY == 0;
+
+            ClusterFragment fragment = {};
+            fragment.frame = frame;
+            fragment.playAt = leaderClock.micros() + opt.delayMs * 1000;
+            for (TestFollower& follower : followers) {
+                fragment.node = follower.node;
+                fragment.total = follower.count;
+                for (uint16_t offset = 0; offset < follower.count; offset += CLUSTER_PIXELS_PER_PACKET) {
+                    fragment.offset = offset;
+                    fragment.count = min((uint16_t)(follower.count - offset), CLUSTER_PIXELS_PER_PACKET);
+                    fragment.sentAt = leaderClock.micros();
+                    uint16_t size = clusterWritePacket(packet, fragment, &canvas[follower.start + offset]);
+                    if (!bad && chance(rng) < opt.loss) {
+                        dropped++;
+                        continue;
+                    }
+                    leaderUdp.send(follower.udp.port(), packet, size);
+                }
+                if (bad) {
+                    // Claims a larger frame, with an offset past this one's end:
+                    // taken at face value it writes past the slot
+                    ClusterFragment wrong = fragment;
+                    wrong.offset = 2 * CLUSTER_PIXELS_PER_PACKET;
+                    wrong.count = CLUSTER_PIXELS_PER_PACKET;
+                    wrong.total = MAX_LED_COUNT;
+                    static const CRGB junk[CLUSTER_PIXELS_PER_PACKET] = {};
+                    uint16_t size = clusterWritePacket(packet, wrong, junk);
+                    leaderUdp.send(follower.udp.port(), packet, size);
+                }
+            }
+        }
+
+        for (TestFollower& follower : followers) {
+            follower.poll();
+        }
+        usleep(100);
+    }
+
+    bool ok = true;
+    printf("leader: %u frames, %u packets dropped\n", frame, dropped);
+    for (TestFollower& follower : followers) {
+        const ClusterFollowerStats& s = follower.receiver.getStats();
+        const Histogram& err = follower.receiver.getPlayoutError();
+        printf("follower %u: frames=%u checked=%u mismatched=%u repaired=%u interpolated=%u "
+               "lost=%u late=%u badRejected=%u badAccepted=%u playout p50=%uus p95=%uus\n",
+               follower.node, s.frames, follower.checked, follower.mismatched, s.repaired,
+               s.interpolated, s.lost, s.late, follower.badRejected, follower.badAccepted,
+               err.percentile(50), err.percentile(95));
+        if (follower.mismatched > 0) {
+            printf("  FAIL: %u frames differ from what the leader sent\n", follower.mismatched);
+            ok = false;
+        }
+        if (follower.badAccepted > 0) {
+            printf("  FAIL: accepted %u fragments with the wrong frame size\n", follower.badAccepted);
+            ok = false;
+        } else if (follower.badRejected < frames / BAD_FRAGMENT_EVERY) {
+            printf("  FAIL: only %u bad fragments seen\n", follower.badRejected);
+            ok = false;
+        }
+        if (s.frames < frames * 9 / 10) {
+            printf("  FAIL: showed %u of %u frames\n", s.frames, frames);
+            ok = false;
+        }
+    }
+
+    std::vector<uint32_t> skews;
+    for (const auto& shown : followers[0].shownAt) {
+        uint64_t first = shown.second;
+        uint64_t last = shown.second;
+        bool everyone = true;
+        for (TestFollower& follower : followers) {
+            auto it = follower.shownAt.find(shown.first);
+            if (it == follower.shownAt.end()) {
+                everyone = false;
+                break;
+            }
+            first = std::min(first, it->second);
+            last = std::max(last, it->second);
+        }
+        if (everyone) {
+            skews.push_back((uint32_t)(last - first));
+        }
+    }
+    uint32_t skew95 = percentile(skews, 95);
+    printf("frames shown whole by every follower: %zu; skew p50=%uus p95=%uus\n",
+           skews.size(), percentile(skews, 50), skew95);
+    if (skew95 > SKEW_LIMIT_US) {
+        printf("  FAIL: skew p95 above %uus\n", SKEW_LIMIT_US);
+        ok = false;
+    }
+
+    printf("%s\n", ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
+
+static int runFollower(const Options& opt) {
+    LoopbackUdp udp;
+    NodeClock clock;
+    ClusterReceiver receiver;
+    receiver.configure(opt.node, ClusterConceal::Interpolate);
+    if (!udp.begin(opt.port, true) || !receiver.allocate()) {
+        perror("follower");
+        return 1;
+    }
+    printf("follower %d listening on port %d\n", opt.node, udp.port());
+
+    uint8_t packet[CLUSTER_PACKET_SIZE + 64];
+    uint64_t end = hostMicros() + (uint64_t)(opt.seconds * 1000000);
+    while (opt.seconds <= 0 || hostMicros() < end) {
+        int size;
+        while ((size = udp.read(packet, sizeof(packet))) > 0) {
+            receiver.receive(packet, size, clock.micros());
+        }
+        receiver.schedule(clock.micros());
+        usleep(100);
+    }
+
+    const ClusterFollowerStats& s = receiver.getStats();
+    const Histogram& err = receiver.getPlayoutError();
+    printf("packets=%u frames=%u late=%u lost=%u repaired=%u interpolated=%u overruns=%u "
+           "resets=%u cadence=%uus playout p50=%uus p95=%uus max=%uus\n",
+           s.packets, s.frames, s.late, s.lost, s.repaired, s.interpolated, s.overruns,
+           s.resets, receiver.getCadenceUs(), err.percentile(50), err.percentile(95), err.maxValue);
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    Options opt;
+    bool follower = argc > 1 && std::string(argv[1]) == "follower";
+    for (int i = follower ? 2 : 1; i < argc; i++) {
+        std::string arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (!value) {
+            fprintf(stderr, "%s needs a value\n", arg.c_str());
+            return 2;
+        }
+        if (arg == "--followers") opt.followers = atoi(value);
+        else if (arg == "--pixels") opt.pixels = atoi(value);
+        else if (arg == "--fps") opt.fps = atoi(value);
+        else if (arg == "--delay") opt.delayMs = atoi(value);
+        else if (arg == "--loss") opt.loss = atof(value);
+        else if (arg == "--seconds") opt.seconds = atof(value);
+        else if (arg == "--port") opt.port = atoi(value);
+        else if (arg == "--node") opt.node = atoi(value);
+        else {
+            fprintf(stderr, "unknown option %s\n", arg.c_str());
+            return 2;
+        }
+        i++;
+    }
+    return follower ? runFollower(opt) : runLoopback(opt);
+}
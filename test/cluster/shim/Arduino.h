@@ -0,0 +1,11 @@
+// Host shim: the parts of Arduino.h the cluster core and Histogram use
+#pragma once
+
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+using std::max;
+using std::min;
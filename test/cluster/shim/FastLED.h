@@ -0,0 +1,33 @@
+// Host shim: CRGB and blend() as the cluster core uses them
+#pragma once
+
+#include "Arduino.h"
+
+typedef uint8_t fract8;
+
+struct CRGB {
+    uint8_t r;
+    uint8_t g;
+    uint8_t b;
+
+    CRGB() = default;
+    CRGB(uint8_t red, uint8_t green, uint8_t blue) : r(red), g(green), b(blue) {}
+
+    bool operator==(const CRGB& o) const { return r == o.r && g == o.g && b == o.b; }
+    bool operator!=(const CRGB& o) const { return !(*this == o); }
+};
+
+static_assert(sizeof(CRGB) == 3, "CRGB must be packed r,g,b like FastLED's");
+
+inline uint8_t blend8(uint8_t a, uint8_t b, uint8_t amountOfB) {
+    return a + (((int)b - (int)a) * amountOfB) / 256;
+}
+
+inline CRGB* blend(const CRGB* src1, const CRGB* src2, CRGB* dest, uint16_t count, fract8 amountOfsrc2) {
+    for (uint16_t i = 0; i < count; i++) {
+        dest[i] = CRGB(blend8(src1[i].r, src2[i].r, amountOfsrc2),
+                       blend8(src1[i].g, src2[i].g, amountOfsrc2),
+                       blend8(src1[i].b, src2[i].b, amountOfsrc2));
+    }
+    return dest;
+}
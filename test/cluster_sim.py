@@ -0,0 +1,115 @@
+#!/usr/bin/env python3
+"""
+Cluster traffic generator (wire format of src/protocols/cluster_core.h).
+
+Plays a leader: renders a rainbow canvas and streams each follower its
+slice, with optional packet loss, to LUME followers or to the host build
+of the firmware's follower (test/cluster/cluster_loopback follower).
+
+  ./cluster_sim.py leader --follower 192.168.1.51:5570:1:0:300 --follower 192.168.1.52:5570:2:300:300
+  ./cluster_sim.py leader --follower 127.0.0.1:5570:1:0:600 --loss 0.05 --seconds 10
+
+The leader's clock gets a random offset, like a node that booted at some
+other time. Reassembly and play-out are tested in test/cluster, against
+the firmware's own code.
+"""
+
+import argparse
+import random
+import socket
+import struct
+import sys
+import time
+
+MAGIC = b"LUMC"
+VERSION = 1
+TYPE_PIXELS = 1
+HEADER = struct.Struct(">4sBBBxIIIHHH")   # 26 bytes
+PIXELS_PER_PACKET = 480
+
+
+class Clock:
+    """micros() with a random boot offset"""
+
+    def __init__(self):
+        self.base = random.randrange(0, 1 << 32)
+
+    def micros(self):
+        return (time.monotonic_ns() // 1000 + self.base) & 0xFFFFFFFF
+
+
+def rainbow(count, frame):
+    out = bytearray(count * 3)
+    for i in range(count):
+        h = (frame * 4 + i * 7) % 768
+        if h < 256:
+            r, g, b = 255 - h, h, 0
+        elif h < 512:
+            h -= 256
+            r, g, b = 0, 255 - h, h
+        else:
+            h -= 512
+            r, g, b = h, 0, 255 - h
+        out[i * 3:i * 3 + 3] = bytes((r, g, b))
+    return out
+
+
+# ---------------------------------------------------------------------------
+# Leader
+# ---------------------------------------------------------------------------
+
+def run_leader(args):
+    clock = Clock()
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    followers = []
+    for spec in args.follower:
+        ip, port, node, start, count = spec.split(":")
+        followers.append((ip, int(port), int(node), int(start), int(count)))
+    canvas = max(s + c for _, _, _, s, c in followers)
+
+    interval = 1.0 / args.fps
+    frame = 0
+    sent = dropped = 0
+    deadline = time.monotonic() + args.seconds if args.seconds else None
+    next_tick = time.monotonic()
+
+    while deadline is None or time.monotonic() < deadline:
+        frame = (frame + 1) & 0xFFFFFFFF or 1
+        pixels = rainbow(canvas, frame)
+        play_at = (clock.micros() + args.delay * 1000) & 0xFFFFFFFF
+
+        for ip, port, node, start, count in followers:
+            for offset in range(0, count, PIXELS_PER_PACKET):
+                n = min(count - offset, PIXELS_PER_PACKET)
+                if random.random() < args.loss:
+                    dropped += 1
+                    continue
+                header = HEADER.pack(MAGIC, VERSION, TYPE_PIXELS, node, frame,
+                                     play_at, clock.micros(), offset, n, count)
+                data = pixels[(start + offset) * 3:(start + offset + n) * 3]
+                sock.sendto(header + data, (ip, port))
+                sent += 1
+
+        next_tick += interval
+        time.sleep(max(0.0, next_tick - time.monotonic()))
+
+    print(f"leader: {frame} frames, {sent} packets sent, {dropped} dropped", file=sys.stderr)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    sub = parser.add_subparsers(dest="cmd", required=True)
+
+    p = sub.add_parser("leader", help="render a canvas and stream slices")
+    p.add_argument("--follower", action="append", required=True, metavar="IP:PORT:NODE:START:COUNT")
+    p.add_argument("--fps", type=float, default=40)
+    p.add_argument("--delay", type=int, default=50, help="play-out delay (ms)")
+    p.add_argument("--loss", type=float, default=0.0, help="fraction of packets to drop")
+    p.add_argument("--seconds", type=float, default=0, help="0 = run forever")
+
+    args = parser.parse_args()
+    run_leader(args)
+
+
+if __name__ == "__main__":
+    main()